@@ -40,7 +40,9 @@ enum ConfigErrors {
 
 class Config;
 class ConfigSection;
+class StrHashTable;
 struct ConfigEntry;
+struct ConfigArena;
 
 #ifndef SKIP_DOCS
 typedef list<ConfigEntry*> EntryList;
@@ -115,6 +117,8 @@ private:
 	ConfigSection* cached;
 
 	SectionList section_list;
+	StrHashTable* section_hash;
+	ConfigArena* arena;
 
 	ConfigSection* add_section(const char* section);
 	ConfigSection* find_section(const char* section);
@@ -130,6 +134,9 @@ public:
 	/**
 	 * Load file. Config's internal content will be cleared.
 	 *
+	 * File is read at once and parsed in place, so loaded keys and values are not
+	 * allocated separately; that memory is released with clear() or the next load().
+	 *
 	 * \return true if file reading was ok, otherwise false.
 	 * \param fname path to config file.
 	 */
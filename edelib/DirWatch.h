@@ -33,7 +33,8 @@ enum DirWatchFlags {
 	DW_ACCESS = (1 << 3),       ///< In directory item is accessed (read, ...)
 	DW_RENAME = (1 << 4),       ///< In directory item renamed
 	DW_ATTRIB = (1 << 5),       ///< In directory item's attributes changed
-	DW_DELETE = (1 << 6)        ///< In directory item is deleted
+	DW_DELETE = (1 << 6),       ///< In directory item is deleted
+	DW_RECURSIVE = (1 << 7)     ///< Watch subdirectories too, including created later (inotify only)
 };
 
 /**
@@ -61,8 +62,22 @@ enum DirWatchReportFlags {
 struct DirWatchEntry;
 struct DirWatchImpl;
 
+/**
+ * \class DirWatchEvent
+ * \brief Single change, as delivered to batch callback
+ */
+struct DirWatchEvent {
+	/** watched directory */
+	const char* dir;
+	/** changed item inside directory; can be NULL */
+	const char* name;
+	/** one of DirWatchReportFlags */
+	int flags;
+};
+
 #ifndef SKIP_DOCS
 typedef void (DirWatchCallback)(const char* dir, const char* w, int flags, void* data);
+typedef void (DirWatchBatchCallback)(const DirWatchEvent* events, unsigned int n, void* data);
 #endif
 
 /**
@@ -171,6 +186,37 @@ typedef void (DirWatchCallback)(const char* dir, const char* w, int flags, void*
  *   DirWatch::callback(notify_cb, mywidget);
  * \endcode
  *
+ * When many changes happen at once (e.g. archive is unpacked in watched directory), events received
+ * together are coalesced, so the same report for the same item is not repeated. Such application can
+ * also register batch callback, which will get all received events at once:
+ * \code
+ *   void batch_cb(const DirWatchEvent* events, unsigned int n, void* d) {
+ *      for(unsigned int i = 0; i < n; i++)
+ *         printf("%s changed in %s\n", events[i].name ? events[i].name : "(unknown)", events[i].dir);
+ *   }
+ *
+ *   DirWatch::batch_callback(batch_cb);
+ * \endcode
+ *
+ * Batch callback does not replace callback registered with callback(); if both are registered, both
+ * will be called. Events and their strings are valid only during callback call.
+ *
+ * With <em>DW_RECURSIVE</em>, all subdirectories of given directory are watched too, and directories
+ * created (or moved in) later are added automatically. Events are reported with the subdirectory as
+ * <em>dir</em>. Symbolic links are not followed. Subdirectories are removed with remove() on the
+ * directory given to add().
+ *
+ * Coalescing only merges events received together; to get one notification for a bulk change
+ * (e.g. unpacking thousands of files), set debounce window:
+ * \code
+ *   DirWatch::add("/some/directory", DW_CREATE | DW_DELETE | DW_RECURSIVE);
+ *   DirWatch::debounce(0.5);
+ * \endcode
+ *
+ * Changes are then collected until the window expires and each changed directory is reported once,
+ * with <em>what_changed</em> set to NULL. Flag is the report when all changes were of the same kind,
+ * or DW_REPORT_NONE if they were mixed.
+ *
  * DirWatch can report what backend it use for notification via notifier() member
  * which will return one of the DirWatchNotifier elements. Then application can choose special
  * case for some backend when is compiled in.
@@ -203,6 +249,8 @@ public:
 	bool remove_entry(const char* dir);
 	bool have_entry(const char* dir);
 	void add_callback(DirWatchCallback* cb, void* data);
+	void add_batch_callback(DirWatchBatchCallback* cb, void* data);
+	void set_debounce(double t);
 	void run_callback(int fd);
 	DirWatchNotifier get_notifier(void) { return backend_notifier; }
 #endif
@@ -236,6 +284,18 @@ public:
 	 */
 	static void callback(DirWatchCallback& cb, void* data = 0);
 
+	/**
+	 * Register callback called with all events received at once. Not all backends can
+	 * receive more than one event at the time; those will call it for each event.
+	 */
+	static void batch_callback(DirWatchBatchCallback& cb, void* data = 0);
+
+	/**
+	 * Collect changes for given number of seconds and report each changed directory once. Value
+	 * 0 disables it (default). Currently only inotify backend supports it.
+	 */
+	static void debounce(double t);
+
 	/**
 	 * Return current notifier used, or DW_NONE if none of them.
 	 */
@@ -37,8 +37,9 @@ struct FontCache_P;
  * \class FontInfo
  * \brief Base structure for storing font information; used by FontCache
  *
- * FontInfo is structure used to store information in cache database. Database is represented in key/value form
- * (actualy it is sdbm powered) where each key is font name and each value FontInfo structure.
+ * FontInfo is structure used to store information in cache database. Database is a single file with font names,
+ * sorted for binary search, and FontInfo structure for each name. It is mapped in memory when loaded, so lookups
+ * and iteration over fonts does not read the file again.
  */
 struct EDELIB_API FontInfo {
 	/** Face name with encoded style; usable only for FLTK. */
@@ -95,26 +96,27 @@ public:
 	/**
 	 * Try to find given face and size in given database path. If found, register it as FLTK font and set font id
 	 * and size.
+	 *
+	 * Results (including failed ones) are remembered until clear(), so looking for the same name again does not
+	 * access database or FLTK font table.
  	 */
 	bool find(const char *n, Fl_Font &font, int &size);
 
 	/**
 	 * Try to find given FontInfo object for given name. This function will not register it as FLTK font, as other
-	 * <i>find()</i> method. Returns NULL if name wasn't found.
+	 * <i>find()</i> method. Returns NULL if name wasn't found. Returned object is valid until clear().
 	 */
 	FontInfo *find(const char *n, int &size);
 
 	/**
-	 * This function can be used to iterate all fonts, where on each font will be called callback. Fonts will not be
-	 * in sorted order.
+	 * This function can be used to iterate all fonts, where on each font will be called callback. Fonts are
+	 * visited in the order they are stored in database, which is sorted by name.
 	 */
 	void for_each_font(void (*) (const char *n, FontInfo *, void *), void *data = NULL);
 
 	/**
-	 * Iterate over fonts, just as <em>for_each_font()</em>, except fonts will be sorted. To operate like this, all
-	 * database keys must be fetched first and them sorted in memory. After that, it will access to database content.
-	 *
-	 * This function is clearly inefficient if called on large database.
+	 * Iterate over fonts sorted by name. Since database is already sorted, this is the same as
+	 * <em>for_each_font()</em>.
 	 */
 	void for_each_font_sorted(void (*) (const char *n, FontInfo *, void *), void *data = NULL);
 
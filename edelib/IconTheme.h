@@ -71,6 +71,10 @@ struct IconThemePrivate;
  * Icons are searched by giving the icon name, without extension, and IconTheme will try to find
  * either PNG or XPM icon with the same name.
  *
+ * On the first find_icon() call, all theme directories are scanned once and found icons are recorded
+ * in the index, so further lookups will not touch the filesystem. Icons installed after that will
+ * be visible after theme is loaded again with load().
+ *
  * Although this class can be used directly, preferred way is to load icons via IconLoader.
  *
  * \todo implement Threshold support (see icon-theme spec)
@@ -96,7 +100,8 @@ public:
 
 	/**
 	 * Load theme. Must be called before icons search. Calling load() again with
-	 * the new theme name will initialize that new theme
+	 * the new theme name will initialize that new theme. Icon index is discarded and
+	 * will be rebuilt on the next find_icon() call
 	 */
 	void load(const char* name);
 
@@ -20,16 +20,23 @@
 #define __EDELIB_LIST_H__
 
 #include "Debug.h"
+#include <new>
 
 EDELIB_NS_BEGIN
 
 #ifndef SKIP_DOCS
 
 struct ListNode {
-	void* value;
 	ListNode* next;
 	ListNode* prev;
-	ListNode() : value(0), next(0), prev(0) { }
+	ListNode() : next(0), prev(0) { }
+};
+
+/* value is stored inside the node, so each element requires only one allocation */
+template <typename T>
+struct ListValueNode : public ListNode {
+	T value;
+	ListValueNode(const T& v) : value(v) { }
 };
 
 template <typename T>
@@ -42,14 +49,12 @@ struct ListIterator {
 
 	T& operator*(void) const { 
 		E_ASSERT(node != 0 && "Bad code! Access to zero node!!!"); 
-		E_ASSERT(node->value != 0 && "Bad code! Dereferencing NULL value!!!"); 
-		return *(T*)node->value;
+		return static_cast<ListValueNode<T>*>(node)->value;
 	}
 
 	T* operator->(void) const {
 		E_ASSERT(node != 0 && "Bad code! Access to zero node!!!"); 
-		E_ASSERT(node->value != 0 && "Bad code! Dereferencing NULL value!!!"); 
-		return (T*)node->value;
+		return &(static_cast<ListValueNode<T>*>(node)->value);
 	}
 
 	bool operator!=(const ListIterator& other) const { return node != other.node; }
@@ -72,14 +77,12 @@ struct ListConstIterator {
 
 	const T& operator*(void) const { 
 		E_ASSERT(node != 0 && "Bad code! Access to zero node!!!"); 
-		E_ASSERT(node->value != 0 && "Bad code! Dereferencing NULL value!!!"); 
-		return *(T*)node->value;
+		return static_cast<ListValueNode<T>*>(node)->value;
 	}
 
 	const T* operator->(void) const { 
 		E_ASSERT(node != 0 && "Bad code! Access to zero node!!!"); 
-		E_ASSERT(node->value != 0 && "Bad code! Dereferencing NULL value!!!"); 
-		return (T*)node->value;
+		return &(static_cast<ListValueNode<T>*>(node)->value);
 	}
 
 	bool operator!=(const ListConstIterator& other) const { return node != other.node; }
@@ -153,6 +156,10 @@ struct ListConstIterator {
  * This issue is not related to this list implementation only; libstdc++ list will
  * return garbage in above cases (but in some will crash); this implementation will
  * always crash when above cases occurs, so be carefull :-P.
+ *
+ * Each element is stored together with its node, so insertion requires only one allocation. If
+ * list is often emptied and filled again, set_node_pool() can be used to keep nodes of removed
+ * elements for reuse.
  */
 template <typename T>
 class list {
@@ -162,15 +169,58 @@ public:
 #endif
 private:
 	typedef ListNode Node;
+	typedef ListValueNode<T> ValueNode;
 	typedef bool (SortCmp)(const T& val1, const T& val2);
 
 	size_type sz;
 	Node* tail;
 
+	/* unused nodes, linked via 'next' */
+	Node* pool;
+	size_type pool_sz;
+	size_type pool_max;
+
 	E_DISABLE_CLASS_COPY(list)
 
 	static bool default_sort_cmp(const T& val1, const T& val2) { return val1 < val2; }
 
+	Node* create_node(const T& val) {
+		void* mem;
+
+		if(pool) {
+			mem = pool;
+			pool = pool->next;
+			pool_sz--;
+		} else {
+			mem = ::operator new(sizeof(ValueNode));
+		}
+
+		return new (mem) ValueNode(val);
+	}
+
+	void destroy_node(Node* n) {
+		static_cast<ValueNode*>(n)->~ValueNode();
+
+		if(pool_sz < pool_max) {
+			n->next = pool;
+			pool = n;
+			pool_sz++;
+		} else {
+			::operator delete(n);
+		}
+	}
+
+	void trim_pool(size_type max) {
+		Node* t;
+
+		while(pool_sz > max) {
+			t = pool->next;
+			::operator delete(pool);
+			pool = t;
+			pool_sz--;
+		}
+	}
+
 	Node* merge_nodes(Node* a, Node* b, SortCmp* cmp) {
 		Node head;
 		Node* c = &head;
@@ -178,7 +228,7 @@ private:
 
 		while(a != 0 && b != 0) {
 			// compare values
-			if(cmp(*(T*)a->value, *(T*)b->value)) {
+			if(cmp(static_cast<ValueNode*>(a)->value, static_cast<ValueNode*>(b)->value)) {
 				c->next = a;
 				a = a->next;
 			} else {
@@ -250,12 +300,12 @@ public:
 	/**
 	 * Creates an empty list
 	 */
-	list() : sz(0), tail(0) { }
+	list() : sz(0), tail(0), pool(0), pool_sz(0), pool_max(0) { }
 
 	/**
 	 * Clears data
 	 */
-	~list() { clear(); } 
+	~list() { clear(); trim_pool(0); } 
 
 	/**
 	 * Clear all data
@@ -270,8 +320,7 @@ public:
 		Node* t;
 		while(p != tail) {
 			t = p->next;
-			delete (T*)p->value;
-			delete p;
+			destroy_node(p);
 			p = t;
 		}
 
@@ -292,8 +341,7 @@ public:
 	 */
 	iterator insert(iterator it, const T& val) {
 		// [23.2.2.3] insert() does not affect validity of iterators
-		Node* tmp = new Node;
-		tmp->value = new T(val); 
+		Node* tmp = create_node(val);
 
 		if(!tail) {
 			// dummy node first
@@ -329,12 +377,21 @@ public:
 		++ret;
 		sz--;
 
-		delete (T*)it.node->value;
-		delete it.node;
-
+		destroy_node(it.node);
 		return ret;
 	}
 
+	/**
+	 * Keep up to given number of nodes from removed elements, so they can be reused
+	 * by later insertions without allocating memory. By default, nodes are not kept.
+	 *
+	 * \param n is maximal number of kept nodes; 0 releases all kept nodes
+	 */
+	void set_node_pool(size_type n) {
+		pool_max = n;
+		trim_pool(n);
+	}
+
 	/**
 	 * Adds new value to the end of the list.
 	 * \param val is value to be added
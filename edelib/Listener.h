@@ -37,6 +37,11 @@ enum {
  * They are mainly created to avoid linking with FLTK libraries when is not needed, eg. console
  * applications.
  *
+ * On systems with epoll (Linux), descriptors are monitored with it, so the cost of listener_wait()
+ * depends only on number of ready descriptors and there is no FD_SETSIZE limit. Otherwise, or when
+ * library was configured with <i>--disable-epoll</i>, select() is used. select() can also be forced at
+ * runtime by setting <i>EDELIB_LISTENER_SELECT</i> environment variable.
+ *
  * listener_add_fd() will add file descriptor to listen to. Whem descriptor becomes ready, a <i>cb</i>
  * callback will be called.
  *
@@ -70,16 +75,62 @@ EDELIB_API inline void listener_remove_fd(int fd) {
 	listener_remove_fd(fd, LISTENER_READ); 
 }
 
+/**
+ * Call function after given number of seconds. Timers are kept in a hierarchical timer wheel with
+ * millisecond resolution, so adding, removing and expiring timers does not depend on their number.
+ * Timeouts are fired from listener_wait() and it will not sleep past the earliest timeout.
+ *
+ * \param t is time in seconds
+ * \param cb is callback to be called
+ * \param arg is optional parameter passed to the callback
+ */
+EDELIB_API void listener_add_timeout(double t, void (*cb)(void*), void* arg = 0);
+
+/**
+ * Much the same as Fl::repeat_timeout(). If called from timeout callback, new timeout is counted
+ * from the time previous one was scheduled, not when it was actually called, so repeating timeouts
+ * will not drift. Otherwise, it is the same as listener_add_timeout().
+ *
+ * \param t is time in seconds
+ * \param cb is callback to be called
+ * \param arg is optional parameter passed to the callback
+ */
+EDELIB_API void listener_repeat_timeout(double t, void (*cb)(void*), void* arg = 0);
+
+/**
+ * Remove all timeouts with given callback and parameter.
+ */
+EDELIB_API void listener_remove_timeout(void (*cb)(void*), void* arg = 0);
+
+/**
+ * Return true if timeout with given callback and parameter is pending.
+ */
+EDELIB_API bool listener_has_timeout(void (*cb)(void*), void* arg = 0);
+
+/**
+ * Add idle callback. Idle callbacks are called on each listener_wait() call, which then only checks
+ * descriptors without waiting.
+ *
+ * \param cb is callback to be called
+ * \param arg is optional parameter passed to the callback
+ */
+EDELIB_API void listener_add_idle(void (*cb)(void*), void* arg = 0);
+
+/**
+ * Remove idle callback added with listener_add_idle().
+ */
+EDELIB_API void listener_remove_idle(void (*cb)(void*), void* arg = 0);
+
 /**
  * This function corresponds (in some parts) to the FLTK's Fl::wait(). In this case, it will wait until 
  * some changes happens on monitored descriptors and will return. It will also call given callbacks (via listener_add_fd()).
  *
- * listener_wait(), on other hand, is not replacement for Fl::wait(). It will not handle all things Fl::wait()
- * does (like refreshing windows, calling idle callbacks, etc.) and in case listener_xxx be used with
- * FLTK elements, listener_wait() must be called too.
+ * listener_wait(), on other hand, is not replacement for Fl::wait(). It will run timeouts and idle callbacks
+ * added with listener_add_timeout() and listener_add_idle(), but it will not handle FLTK things (like refreshing
+ * windows) and in case listener_xxx be used with FLTK elements, listener_wait() must be called too.
  *
- * \return positive value if an event or fd happens before time elapsed. It is zero if nothing happens and negative
- *         is if error occurs, like signal
+ * \return positive value if an event or fd happens or timeout was fired before time elapsed. It is zero if nothing
+ *         happens and negative is if error occurs, like signal
  * \param t is time to wait maximum seconds. It can return much sooner if something happens
  */
 EDELIB_API double listener_wait(double t);
@@ -20,6 +20,7 @@
 #define __EDELIB_MIMETYPE_H__
 
 #include "String.h"
+#include "List.h"
 
 EDELIB_NS_BEGIN
 
@@ -38,11 +39,18 @@ EDELIB_NS_BEGIN
  *
  * If file could not be recognized, returned string will be <em>application/octet-stream</em>.
  *
- * comment() will return full description for recognized file, looking inside 
- * $XDG_DATA_DIRS/mime/context/file-type.xml file. This description can be plain english (default) or 
- * localized (not implemented yet).
+ * comment() will return full description for recognized file, in language set by LANG (or LC_ALL/LC_MESSAGES)
+ * environment variable if available, or plain english otherwise. Descriptions and icon names are read from
+ * shared-mime-info packages ($XDG_DATA_DIRS/mime/packages) once, and stored as index in user_cache_dir(), so
+ * further lookups, even from other processes, does not parse any XML. The index is rebuilt when packages are
+ * changed. If type is not found there, $XDG_DATA_DIRS/mime/context/file-type.xml is consulted.
+ *
+ * Mime database is loaded on first use and shared by all MimeType objects, so creating them is cheap. Results
+ * of set() are remembered in a process-wide cache keyed by file path; cached result is used only if file
+ * device, inode, mode, size and modification times are the same, so changed files are always inspected
+ * again. Cache holds the most recently used files (1024 by default) and its size can be changed with cache_size().
+ * Database and cache are released with shutdown().
  *
- * \todo add locale during read of comments
  * \todo  Last change in xdgmime.c moved stat-ed code to be executed first so ambiguous directory names
  * (like ".kde" or ".emacs.d" or ".e") doesn't be recognized as files or unknown types; can stat's be delayed?
  */
@@ -52,6 +60,7 @@ private:
 	String mtype;
 	String mcmt;
 	String micon;
+	String mgicon;
 
 	E_DISABLE_CLASS_COPY(MimeType)
 public:
@@ -60,6 +69,17 @@ public:
 	/** Cleans internal data */
 	~MimeType();
 
+	/**
+	 * Release shared mime database and clear cache. Database will be loaded again when needed.
+	 */
+	static void shutdown(void);
+
+	/**
+	 * Set maximum number of files whose types are cached. Value 0 disables caching. This will clear
+	 * current cache content.
+	 */
+	static void cache_size(unsigned int n);
+
 	/**
 	 * Set path to the file for inspection. If file does not exists or is unreadable, it will return false.
 	 *
@@ -108,7 +128,33 @@ public:
 	 * If set() failed, it will return empty string.
 	 */
 	const String& icon_name(void);
+
+	/**
+	 * Return name of generic icon, which should be used when icon from icon_name() is not available in
+	 * icon theme. If mime database does not say otherwise, it will be media type followed by <em>-x-generic</em>,
+	 * e.g. <em>text-x-generic</em> for <em>text/plain</em>.
+	 *
+	 * If set() failed, it will return empty string.
+	 */
+	const String& generic_icon_name(void);
 }; 
 
+/**
+ * Detect types of many files at once, e.g. all entries of a directory. Result for each file is the same
+ * as from MimeType::set() and MimeType::type(), and will be cached for later set() calls.
+ *
+ * Files are inspected in parallel: stat() calls and reading file content are spread over worker threads.
+ * Content is read only for files that can't be recognized by name, and only as many bytes as magic rules
+ * need. Without thread support on the system, files are inspected one by one.
+ *
+ * This function and MimeType must not be used from different threads at the same time.
+ *
+ * \return number of files whose type was detected
+ * \param files is list of full paths
+ * \param types will be filled with types, in the same order as files; for inaccessible files it will be empty string
+ * \param nthreads is number of used threads; if 0, it will be chosen by number of processors
+ */
+EDELIB_API unsigned int mime_types_for_files(const list<String>& files, list<String>& types, unsigned int nthreads = 0);
+
 EDELIB_NS_END
 #endif
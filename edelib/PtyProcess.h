@@ -28,6 +28,18 @@
 EDELIB_NS_BEGIN
 
 class PTY;
+class PtyProcess;
+
+/**
+ * A callback type for PtyProcess output in async mode; <i>data</i> is not terminated with '\\0'
+ */
+typedef void (*PtyProcessDataCallback)(PtyProcess *p, const char *data, int len, void *arg);
+
+/**
+ * A callback type for PtyProcess exit notification in async mode; <i>status</i> has the same
+ * meaning as check_pid_exited() result
+ */
+typedef void (*PtyProcessExitCallback)(PtyProcess *p, int status, void *arg);
 
 /**
  * \class PtyProcess
@@ -36,14 +48,40 @@ class PTY;
  * PtyProcess provides synchronous communication with tty based programs.
  * The communications channel used is a pseudo tty (as opposed to a pipe)
  * This means that programs which require a terminal will work.
+ *
+ * Besides reading with read_line(), which needs to be polled, PtyProcess can work in async mode,
+ * where the pseudo tty is monitored with listener_add_fd() and output and exit are reported via
+ * callbacks from listener_wait(). Each object registers only its own descriptor, so any number of
+ * programs can be driven from the same loop:
+ * \code
+ *   void data_cb(PtyProcess *p, const char *data, int len, void *arg) {
+ *     fwrite(data, 1, len, stdout);
+ *   }
+ *
+ *   void exit_cb(PtyProcess *p, int status, void *arg) {
+ *     printf("%i exited with %i\n", p->pid(), status);
+ *   }
+ *
+ *   // in some function...
+ *   PtyProcess p;
+ *   p.set_async(data_cb, exit_cb);
+ *   p.exec("/bin/ls", args);
+ *
+ *   while(1)
+ *     listener_wait();
+ * \endcode
  */
 class EDELIB_API PtyProcess {
 private:
 	int init();
 	int setup_tty(int fd);
+	void async_watch(bool on);
+
+	static void async_fd_cb(int fd, void *arg);
+	static void async_exit_cb(void *arg);
 
 	PTY *m_pPTY;
-	char *m_Inbuf, *m_TTY;
+	char *m_TTY;
 
 	class PtyProcessPrivate;
 	PtyProcessPrivate *d;
@@ -86,6 +124,23 @@ public:
 	 */
 	char *read_line(bool block=true);
 
+	/**
+	 * Same as read_line(), but the line is not copied. \p line will point inside internal buffer
+	 * and it is <b>not</b> terminated with '\\0'. It is valid until the next read or unread_line() call.
+	 * \param line will point to the line
+	 * \param block Block until a full line is read?
+	 * \return The line length, including '\\n', or 0 if nothing was read.
+	 */
+	int read_line_span(const char **line, bool block=true);
+
+	/**
+	 * Reads everything the program wrote so far, without blocking, and returns it at once together
+	 * with data not consumed by previous reads. \p data is valid the same way as in read_line_span().
+	 * \param data will point to the data
+	 * \return The data length or 0 if there is nothing to read.
+	 */
+	int read_available(const char **data);
+
 	/**
 	 * Writes a line of text to the program's standard in.
 	 * \param line The text to write.
@@ -106,6 +161,20 @@ public:
 	 */
 	void set_exit_string(char *exit) { m_Exit = exit; }
 
+	/**
+	 * Enables async mode. Program output is read when available and passed to \p data_cb; if
+	 * \p data_cb is NULL, output is kept and can be read with read_line() or read_line_span().
+	 * When program closes the terminal and exits, \p exit_cb is called, and it is safe to destroy
+	 * this object from it. Setting both callbacks to NULL disables async mode.
+	 *
+	 * Can be called before or after exec(); listener_wait() must be called to get notifications.
+	 *
+	 * \param data_cb is called with program output
+	 * \param exit_cb is called when program exits
+	 * \param arg is optional parameter passed to the callbacks
+	 */
+	void set_async(PtyProcessDataCallback data_cb, PtyProcessExitCallback exit_cb, void *arg = 0);
+
 	/**
 	 * Waits for the child to exit
 	 */
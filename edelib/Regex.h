@@ -67,6 +67,14 @@ struct RegexMatch {
 	int length;
 };
 
+/**
+ * \related Regex
+ * \typedef RegexMatchCallback
+ * Callback used by Regex::match_all(). <em>matches</em> holds <em>n</em> matched substrings, where the first one
+ * is full match; they are valid only during the call. Return false to stop matching.
+ */
+typedef bool (RegexMatchCallback)(const char* str, const RegexMatch* matches, int n, void* data);
+
 /**
  * \class Regex
  * \brief Regex class
@@ -92,6 +100,11 @@ struct RegexMatch {
  * is offset and the second substring length). This explains one important property inherited from PCRE:
  * when grouped patterns are involved and they are found in string, MatchVec first element will be
  * full matched string and substrings will follow.
+ *
+ * Compiled patterns are studied, so matching can skip directly to positions where the pattern could
+ * start, and are kept in a process-wide cache keyed by pattern and RegexMode flags. Compiling the same
+ * pattern again, from any Regex object, will reuse already compiled one. Cache holds the most recently
+ * used patterns (64 by default) and its size can be changed with cache_size().
  */
 class EDELIB_API Regex {
 private:
@@ -113,6 +126,12 @@ public:
 	 */
 	~Regex();
 
+	/**
+	 * Set maximum number of compiled patterns kept in cache. Value 0 disables caching. This will
+	 * clear current cache content; patterns used by Regex objects are released when those objects are done.
+	 */
+	static void cache_size(unsigned int n);
+
 	/**
 	 * Compile pattern for matching. This <b>must</b> be called before match/search functions.
 	 *
@@ -154,6 +173,37 @@ public:
 	int match(const char* str, int match_mode = 0, MatchVec* matches = 0) 
 	{ return match(str, match_mode, 0, -1, matches); }
 
+	/**
+	 * The same as match() with MatchVec, but offsets are stored in <em>matches</em> array, which can hold up to
+	 * <em>n</em> elements. No memory is allocated. If there are more grouped matches than <em>n</em>, only the
+	 * first <em>n</em> are stored, but returned value is still the number of all grouped matches.
+	 */
+	int match(const char* str, int match_mode, int start, int len, RegexMatch* matches, int n);
+
+	/**
+	 * Find all non-overlapping matches in str, calling cb for each of them. Matched offsets are passed
+	 * directly from matching engine and no memory is allocated, so this is the fastest way to scan large text:
+	 * \code
+	 *   static bool count_words(const char* str, const RegexMatch* m, int n, void* data) {
+	 *     (*(int*)data)++;
+	 *     return true;
+	 *   }
+	 *
+	 *   int words = 0;
+	 *   r.compile("\\w+");
+	 *   r.match_all(text, count_words, &words);
+	 * \endcode
+	 *
+	 * \return the number of matches reported to callback
+	 * \param str is target string
+	 * \param cb is callback called for each match
+	 * \param data is parameter passed to callback
+	 * \param match_mode is OR-ed RegexMatchMode value
+	 * \param start is starting position on string
+	 * \param len is desired length where matching will occur; if given -1, full length will be searched
+	 */
+	int match_all(const char* str, RegexMatchCallback* cb, void* data = 0, int match_mode = 0, int start = 0, int len = -1);
+
 	/**
 	 * Split given str and put each of splitted items in list.
 	 *
@@ -164,6 +214,19 @@ public:
 	 */
 	int split(const char* str, list<String>& ls, int match_mode = 0);
 
+	/**
+	 * Split given str the same way as split() with list, but instead of copying items, store their positions
+	 * in <em>spans</em> array, which can hold up to <em>n</em> elements. If array is too small, the rest of
+	 * items is not stored, but they are counted, so returned value can be used to allocate large enough array.
+	 *
+	 * \return 0 if pattern didn't find or the number of items
+	 * \param str is data to be splitted
+	 * \param spans is array where offsets and lengths of items are stored
+	 * \param n is size of spans array
+	 * \param match_mode is OR-ed RegexMatchMode value
+	 */
+	int split(const char* str, RegexMatch* spans, int n, int match_mode = 0);
+
 	/**
 	 * Return error in string form. Returned value points to static data and <b>must not</b> be modified or cleared
 	 */
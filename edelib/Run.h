@@ -41,6 +41,9 @@ enum {
  * Please note how some programs run without parameters (but internaly are executed via shell) can set <em>errno</em> to 2 which
  * is usually interpreted as ENOENT (or program does not exists); for examle <em>tar</em> is known for this.
  *
+ * Programs found in PATH are remembered, so starting the same program again does not search PATH; this is
+ * invalidated when PATH is changed or remembered program is removed.
+ *
  * \return 0 if starting and quitting program went fine; otherwise return one of RUN_* codes or errno value for not checked codes
  * \param fmt is printf-like formatted string
  */
@@ -48,6 +51,10 @@ EDELIB_API int run_sync(const char *fmt, ...);
 
 /**
  * Same as run_sync(), except it will run command without blocking.
+ *
+ * Started program is a child of current process and it is reaped from SIGCHLD handler, installed on
+ * the first call. Previously installed handler is still called, and children not started by edelib
+ * are left to it. Do not call waitpid() on started program.
  */
 EDELIB_API int run_async(const char *fmt, ...);
 
@@ -60,5 +67,214 @@ EDELIB_API int run_async(const char *fmt, ...);
  */
 EDELIB_API int run_async_with_pid(int *child_pid, const char *fmt, ...);
 
+/**
+ * Streams of program started with RunProcess, which can be connected to pipes
+ */
+enum {
+	RUN_PIPE_STDIN  = 1, ///< program stdin is fed with RunProcess::write()
+	RUN_PIPE_STDOUT = 2, ///< program stdout is read and reported
+	RUN_PIPE_STDERR = 4  ///< program stderr is read and reported
+};
+
+class RunProcess;
+
+/**
+ * A callback type for RunProcess output; <i>stream</i> is RUN_PIPE_STDOUT or RUN_PIPE_STDERR and
+ * <i>data</i> is not terminated with '\\0'
+ */
+typedef void (*RunOutputCallback)(RunProcess *p, int stream, const char *data, int len, void *arg);
+
+/**
+ * A callback type for RunProcess exit notification; see RunProcess::wait() for <i>status</i> values
+ */
+typedef void (*RunExitCallback)(RunProcess *p, int status, void *arg);
+
+#ifndef SKIP_DOCS
+struct RunProcessPrivate;
+struct RunQueuePrivate;
+#endif
+
+/**
+ * \class RunProcess
+ * \brief Start program and communicate with it via pipes
+ *
+ * Unlike run_sync() and run_async(), which take a single command line and split it, RunProcess is given
+ * argument array directly, so arguments with spaces or quotes are passed unchanged. It can also set
+ * environment and working directory for the program, and connect its stdin, stdout and stderr to pipes.
+ * Streams not connected to pipes are redirected to /dev/null.
+ *
+ * Pipes are monitored with listener_add_fd(), and program exit is noticed from the same SIGCHLD handler
+ * run_async() uses, so output and exit are reported via callbacks from listener_wait() and many programs
+ * can run from the same loop:
+ * \code
+ *   void output_cb(RunProcess *p, int stream, const char *data, int len, void *arg) {
+ *     fwrite(data, 1, len, stdout);
+ *   }
+ *
+ *   const char *args[] = { "ls", "-l", "/tmp", NULL };
+ *   RunProcess p;
+ *   p.args(args);
+ *   p.pipes(RUN_PIPE_STDOUT);
+ *   p.callback(output_cb, NULL);
+ *
+ *   if(p.start() == 0)
+ *     printf("ls exited with %i\n", p.wait());
+ * \endcode
+ *
+ * If output callback is not set, output is collected and can be read with output(). If application replaces
+ * SIGCHLD handler after program was started, exit will not be reported.
+ */
+class EDELIB_API RunProcess {
+private:
+	RunProcessPrivate *priv;
+	friend class RunQueue;
+	E_DISABLE_CLASS_COPY(RunProcess)
+public:
+	/**
+	 * Constructor; prepares internal data
+	 */
+	RunProcess();
+
+	/**
+	 * Clears internal data. If program is still running, it is sent SIGTERM and, if it does not exit
+	 * shortly, SIGKILL; it is reaped either way and exit callback is not called.
+	 */
+	~RunProcess();
+
+	/**
+	 * Set program and its arguments. The first element is program name; if it does not contain '/', program
+	 * is searched in PATH, the same way as for run_sync(). Array must be terminated with NULL and is copied.
+	 */
+	void args(const char **argv);
+
+	/**
+	 * Set environment for the program, as NULL terminated array of <i>NAME=VALUE</i> strings. It is copied. If
+	 * not set or set to NULL, program will get the environment of current process.
+	 */
+	void env(const char **envp);
+
+	/**
+	 * Set working directory for the program. If not set, it will be the current one.
+	 */
+	void cwd(const char *dir);
+
+	/**
+	 * Select which streams are connected to pipes, as combination of RUN_PIPE_STDIN, RUN_PIPE_STDOUT and
+	 * RUN_PIPE_STDERR. By default, none is.
+	 */
+	void pipes(int which);
+
+	/**
+	 * Register callbacks for program output and exit.
+	 *
+	 * \param output_cb is called with data program wrote to piped stdout or stderr
+	 * \param exit_cb is called when program exits; it is safe to destroy this object from it
+	 * \param arg is optional parameter passed to the callbacks
+	 */
+	void callback(RunOutputCallback output_cb, RunExitCallback exit_cb, void *arg = 0);
+
+	/**
+	 * Start the program.
+	 *
+	 * \return 0 if program was started; otherwise one of RUN_* codes or errno value, like run_async()
+	 */
+	int start(void);
+
+	/**
+	 * Send data to program stdin. Data is queued and written when pipe is ready, so this never blocks.
+	 *
+	 * \return false if stdin is not connected to pipe or program is not running
+	 */
+	bool write(const char *data, int len);
+
+	/**
+	 * Close program stdin, after all queued data was written, so program gets end of file.
+	 */
+	void close_stdin(void);
+
+	/**
+	 * Return output collected when output callback is not set.
+	 *
+	 * \param stream is RUN_PIPE_STDOUT or RUN_PIPE_STDERR
+	 * \param len if not NULL will be set to data length
+	 * \return data terminated with '\\0'
+	 */
+	const char *output(int stream, int *len = 0) const;
+
+	/**
+	 * Return PID of running program or 0 if it is not running.
+	 */
+	int pid(void) const;
+
+	/**
+	 * Return true if program is running.
+	 */
+	bool running(void) const;
+
+	/**
+	 * Run listener_wait() until program exits.
+	 *
+	 * \return program exit code, 128 + signal number if it was killed by signal, or one of RUN_* codes
+	 *         if program could not be started from RunQueue
+	 */
+	int wait(void);
+};
+
+/**
+ * \class RunQueue
+ * \brief Run programs in parallel, limiting their number
+ *
+ * RunQueue starts added RunProcess objects, but keeps at most given number of them running at once;
+ * the rest waits and is started when some of running programs exits. This way a batch of jobs can use
+ * all processors without starting all of them at once:
+ * \code
+ *   RunQueue q;  // as many jobs as there are processors
+ *
+ *   for(int i = 0; i < n; i++)
+ *     q.add(jobs[i]);
+ *
+ *   q.wait();
+ * \endcode
+ *
+ * Queue does not own added objects and they must be alive until their exit callback is called. If
+ * program could not be started, exit callback is called with RUN_* code as status.
+ */
+class EDELIB_API RunQueue {
+private:
+	RunQueuePrivate *priv;
+	E_DISABLE_CLASS_COPY(RunQueue)
+public:
+	/**
+	 * Create queue running at most <i>max_jobs</i> programs at once. If it is 0, the number of online
+	 * processors is used.
+	 */
+	RunQueue(unsigned int max_jobs = 0);
+
+	/**
+	 * Removes waiting jobs. Running programs are not stopped.
+	 */
+	~RunQueue();
+
+	/**
+	 * Add job to the queue. It is started immediately if there is a free slot.
+	 */
+	void add(RunProcess *p);
+
+	/**
+	 * Return number of jobs waiting to be started.
+	 */
+	unsigned int pending(void) const;
+
+	/**
+	 * Return number of running jobs.
+	 */
+	unsigned int running(void) const;
+
+	/**
+	 * Run listener_wait() until all jobs are done.
+	 */
+	void wait(void);
+};
+
 EDELIB_NS_END
 #endif
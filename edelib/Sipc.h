@@ -75,6 +75,14 @@ typedef void (*SipcCallback)(const char*, void*);
  *     listener_wait();
  * \endcode
  *
+ * Each accepted connection has its own buffer, so messages up to 1 MB are accepted and many
+ * messages received with a single read are all reported; a client sending larger message is
+ * disconnected. Server understands both plain text lines ending with '\\n' and framed messages
+ * (see SipcClient::set_framed()).
+ *
+ * It is safe to destroy the server from its own callback (e.g. on <i>quit</i> message); messages
+ * not yet reported are dropped then.
+ *
  * Bidirectional communication is not possible (a case when server wants to reply);
  * for that D-BUS exists :P
  */
@@ -126,7 +134,8 @@ public:
  *   c.send("howdy");
  * \endcode
  *
- * \note Message length is currently is limited to 1024 bytes.
+ * Messages are sent as plain text lines with a single system call, which every server understands.
+ * If messages needs to contain new lines, enable framing with set_framed().
  */
 class EDELIB_API SipcClient {
 private:
@@ -152,7 +161,17 @@ public:
 	bool connect(const char* prefix);
 
 	/**
-	 * Sends an message
+	 * Set how messages are sent. By default, message is sent as plain text line, terminated with
+	 * '\\n', which is understood by all servers. If set to true, messages are framed (prefixed with
+	 * length) and can contain new lines, but servers from edelib versions before framing support
+	 * will not understand them. Must be called after connect().
+	 *
+	 * \param f is true for framed messages
+	 */
+	void set_framed(bool f);
+
+	/**
+	 * Sends an message. Messages larger than 1 MB are not sent.
 	 *
 	 * \param msg is textual message
 	 */
@@ -70,12 +70,19 @@ EDELIB_NS_BEGIN
  *   s.printf("%s = %i", "num", 4);  // will be "num = 4"
  * \endcode
  *
+ * Short strings (up to 15 characters) are stored inside the object itself, so they do not require
+ * any allocation; longer ones are kept in one allocated, reference counted buffer. Copying such
+ * string will only share the buffer, and the content is copied when one of the strings is about
+ * to be changed (copy-on-write). If compiler supports C++11 rvalue references, String will also
+ * provide move constructor and move assignment.
+ *
+ * Taking a reference to the character via non-const operator[] will make that buffer unshareable,
+ * so later copies will not see changes done through that reference.
+ *
  * \note Since String increase internal buffer's size when is needed, some things should be considered to 
  * minimize reallocations:
  *  - use reserve() if you know the length
  *  - prefer operator+= than operator+
- *
- * \todo COW would be nice
  */
 class EDELIB_API String {
 public: 
@@ -85,17 +92,21 @@ public:
 
 private:
 #ifndef SKIP_DOCS
-	struct StringData {
-		size_type length;
-		size_type capacity;
-		char      *chars;
-	};
+	/* size of inline buffer, including terminating character */
+	enum { INLINE_SIZE = 16 };
 #endif
-	static StringData null_data;
-	StringData* sdata;
+	char*     schars;
+	size_type slength;
+	size_type scapacity;
+	char      sbuf[INLINE_SIZE];
+
+	void init_empty(void) { schars = sbuf; sbuf[0] = '\0'; slength = 0; scapacity = INLINE_SIZE - 1; }
+	bool is_inline(void) const { return schars == sbuf; }
 
-	void init(size_type len, size_type cap);
 	void dispose(void);
+	void take(String& from);
+	void share(const String& from);
+	void unshare(void);
 
 public:
 	/**
@@ -127,6 +138,15 @@ public:
 	 */
 	String(const String& str);
 
+#ifdef EDELIB_HAVE_RVALUE_REFERENCES
+	/**
+	 * Create a new string taking content of another string. Given string will be empty after this call
+	 *
+	 * \param str is object of type String
+	 */
+	String(String&& str) { init_empty(); take(str); }
+#endif
+
 	/**
 	 * Clears all internal data. All possible external pointers to internal buffer will be invalidated
 	 */
@@ -274,23 +294,23 @@ public:
 	 *     ...
 	 * \endcode
 	 */
-	const char* c_str(void)  { return sdata->chars; }
+	const char* c_str(void)  { return schars; }
 
 	/** Return data formated as c-like string */
-	const char* c_str(void) const { return sdata->chars; }
+	const char* c_str(void) const { return schars; }
 
 	/** 
 	 * Retrun pointer to internal buffer 
 	 *
 	 * Do \b not use this function as input for C functions.
 	 */
-	const char* data(void) const  { return sdata->chars; }
+	const char* data(void) const  { return schars; }
 
 	/** Retrun size of character data */
-	size_type length(void) const { return sdata->length; }
+	size_type length(void) const { return slength; }
 
 	/** Retrun size of internal buffer */
-	size_type capacity(void) const { return sdata->capacity; }
+	size_type capacity(void) const { return scapacity; }
 
 	/** Checks if string is empty */
 	bool empty(void) const  { return length() == 0; }
@@ -316,6 +336,17 @@ public:
 	/** Same as assign(String type) */
 	String& operator=(const String& str);
 
+#ifdef EDELIB_HAVE_RVALUE_REFERENCES
+	/** Take content of given string, leaving it empty */
+	String& operator=(String&& str) {
+		if(&str != this) {
+			dispose();
+			take(str);
+		}
+		return *this;
+	}
+#endif
+
 	/** Same as append(str) */
 	String& operator+=(const char* str);
 
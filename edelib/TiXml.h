@@ -79,6 +79,9 @@ class TiXmlAttribute;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
+class TiXmlSaxParser;
+struct TiXmlSaxParserData;
+class TiXmlArena;
 
 const int TIXML_MAJOR_VERSION = 2;
 const int TIXML_MINOR_VERSION = 5;
@@ -196,6 +199,7 @@ class TiXmlBase
 	friend class TiXmlNode;
 	friend class TiXmlElement;
 	friend class TiXmlDocument;
+	friend class TiXmlSaxParser;
 
 public:
 	TiXmlBase()	:	userData(0)		{}
@@ -252,6 +256,16 @@ public:
 	void* GetUserData()						{ return userData; }
 	/** Get a pointer to arbitrary user data. */
 	const void* GetUserData() const 		{ return userData; }
+
+#ifndef SKIP_DOCS
+	// Nodes and attributes are allocated from the heap, or from the document arena when placement
+	// form is used with a document which has arena enabled. See TiXmlDocument::SetArenaAllocation().
+	// Like the rest of TinyXml, they return null when out of memory.
+	static void* operator new( size_t size ) throw();
+	static void* operator new( size_t size, TiXmlDocument* doc ) throw();
+	static void  operator delete( void* p );
+	static void  operator delete( void* p, TiXmlDocument* doc );
+#endif
 #ifndef SKIP_DOCS
 	// Table that returs, for a given lead byte, the total number of bytes
 	// in the UTF-8 sequence.
@@ -1606,7 +1620,7 @@ public:
 	void operator=( const TiXmlDocument& copy );
 
 #ifndef SKIP_DOCS
-	virtual ~TiXmlDocument() {}
+	virtual ~TiXmlDocument();
 #endif
 
 	/**
@@ -1721,6 +1735,27 @@ public:
 	/** Return current tab size */
 	int TabSize() const	{ return tabsize; }
 
+	/**
+	 * Allocate nodes and attributes created by the parser (and by TiXmlElement::SetAttribute())
+	 * from a memory arena owned by the document, instead of allocating each one on the heap.
+	 * Arena memory is released at once when the document is destroyed, and reused when a new
+	 * file is loaded. Useful for large, read-mostly documents:
+	 * \verbatim
+	 *   TiXmlDocument doc;
+	 *   doc.SetArenaAllocation( true );
+	 *   doc.LoadFile( "large.xml" );
+	 * \endverbatim
+	 *
+	 * Nodes created with plain <em>new</em> by the application are still allocated on the heap, and
+	 * both kind can be mixed in the same tree. Removed arena nodes are destroyed as usual, but their
+	 * memory is not reused until the document is cleared. Strings are not affected, although short
+	 * ones are stored inside the node itself.
+	 */
+	void SetArenaAllocation( bool enable )	{ useArena = enable; }
+
+	/** Returns true if arena allocation is enabled */
+	bool ArenaAllocation() const	{ return useArena; }
+
 	/**
 	 * If you have handled the error, it can be reset with this call. The error
 	 * state is automatically cleared if you Parse a new XML block.
@@ -1767,7 +1802,10 @@ protected :
 #endif
 
 private:
+	friend class TiXmlBase;
+
 	void CopyTo( TiXmlDocument* target ) const;
+	void ArenaReset();
 
 	bool error;
 	int  errorId;
@@ -1775,6 +1813,8 @@ private:
 	int tabsize;
 	TiXmlCursor errorLocation;
 	bool useMicrosoftBOM;		// the UTF-8 BOM were found when read. Note this, and try to write.
+	bool useArena;
+	TiXmlArena* arena;
 };
 
 
@@ -2044,6 +2084,128 @@ private:
 };
 
 
+/**
+ * \class TiXmlSaxHandler
+ * \brief Callbacks for TiXmlSaxParser
+ *
+ * Override only methods for events you are interested in; the rest of them will just continue parsing.
+ * Each method should return true to continue parsing or false to stop it. Given strings are valid only
+ * during the call.
+ */
+class EDELIB_API TiXmlSaxHandler
+{
+public:
+	virtual ~TiXmlSaxHandler() {}
+
+	/**
+	 * Called on element start. Attributes are in <em>attrs</em> array, as name/value pairs, terminated
+	 * by NULL, e.g. for <em>&lt;icon name="foo" size="16"/&gt;</em> it will be <em>{"name", "foo", "size", "16", NULL}</em>.
+	 * Values have entities already resolved. Use TiXmlSaxParser::Attribute() to find one by name.
+	 */
+	virtual bool StartElement( const char* /*name*/, const char** /*attrs*/ ) { return true; }
+
+	/** Called on element end, including empty elements (<em>&lt;foo/&gt;</em>). */
+	virtual bool EndElement( const char* /*name*/ ) { return true; }
+
+	/**
+	 * Called for text inside element. White space is handled the same way as with TiXmlDocument
+	 * (see TiXmlBase::SetCondenseWhiteSpace()) and text with white space only is not reported.
+	 * <em>cdata</em> is true if text is from CDATA section, which is reported as is.
+	 */
+	virtual bool Text( const char* /*text*/, bool /*cdata*/ ) { return true; }
+
+	/** Called for comment. */
+	virtual bool Comment( const char* /*text*/ ) { return true; }
+};
+
+/**
+ * \class TiXmlSaxParser
+ * \brief Streaming XML parser
+ *
+ * TiXmlSaxParser reads XML and reports what it finds to TiXmlSaxHandler, without building the document
+ * tree. File is read in chunks and only currently parsed markup is kept in memory, so it is suitable for
+ * large files when only some parts of them are needed.
+ * \code
+ *   class CommentReader : public TiXmlSaxHandler {
+ *   public:
+ *     bool in_comment;
+ *     CommentReader() : in_comment(false) { }
+ *
+ *     bool StartElement(const char* name, const char** attrs) {
+ *       in_comment = (strcmp(name, "comment") == 0 && !TiXmlSaxParser::Attribute(attrs, "xml:lang"));
+ *       return true;
+ *     }
+ *
+ *     bool Text(const char* text, bool) {
+ *       if(in_comment) printf("%s\n", text);
+ *       return true;
+ *     }
+ *   };
+ *
+ *   CommentReader r;
+ *   TiXmlSaxParser parser(&r);
+ *   if(!parser.ParseFile("freedesktop.org.xml"))
+ *     printf("Error: %s at line %i\n", parser.ErrorDesc(), parser.ErrorRow());
+ * \endcode
+ *
+ * Declarations, DOCTYPE and other unknown markup are skipped. Like TiXmlDocument, it is not validating
+ * parser, but it will report unclosed and mismatched elements.
+ */
+class EDELIB_API TiXmlSaxParser
+{
+public:
+	/** Create parser which will report to given handler */
+	TiXmlSaxParser( TiXmlSaxHandler* handler );
+
+	/** Clean internal data */
+	~TiXmlSaxParser();
+
+	/**
+	 * Parse given file. Returns true if the whole file was parsed, or false if error was found or
+	 * handler stopped parsing.
+	 */
+	bool ParseFile( const char* filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** The same as ParseFile(const char*, TiXmlEncoding), but reading from already opened file */
+	bool ParseFile( FILE* file, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** Parse XML from null terminated string. */
+	bool Parse( const char* data, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** Returns true if last parsing failed because of error. */
+	bool Error() const { return errorId != 0; }
+
+	/** Return error code, one of TiXmlBase error codes. */
+	int ErrorId() const { return errorId; }
+
+	/** Return error description */
+	const char* ErrorDesc() const;
+
+	/** Return line where error was found, starting from 1. */
+	int ErrorRow() const { return errorRow; }
+
+	/**
+	 * Find attribute value in array given to TiXmlSaxHandler::StartElement(). Returns NULL
+	 * if there is no such attribute.
+	 */
+	static const char* Attribute( const char** attrs, const char* name );
+
+private:
+	TiXmlSaxHandler*    handler;
+	TiXmlSaxParserData* data;
+	int                 errorId;
+	int                 errorRow;
+
+	bool Run( TiXmlEncoding encoding );
+	bool Fill( void );
+	bool ParseTag( const char* p, TiXmlEncoding encoding, bool* stop );
+	void SetError( int err, const char* p );
+
+	TiXmlSaxParser( const TiXmlSaxParser& );
+	void operator=( const TiXmlSaxParser& );
+};
+
+
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
@@ -0,0 +1,327 @@
+/*
+ * STL-like vector class
+ * Copyright (c) 2005-2007 edelib authors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __EDELIB_VECTOR_H__
+#define __EDELIB_VECTOR_H__
+
+#include "Debug.h"
+#include <new>
+
+EDELIB_NS_BEGIN
+
+/**
+ * \class vector
+ * \brief Contiguous array class
+ *
+ * This implementation is similar to std::vector, providing subset of the same methods
+ * with the same behaviours. Elements are stored in a single memory block which grows by
+ * doubling, so push_back() runs in amortized constant time and traversal is cache friendly.
+ * If the number of elements is known in advance, reserve() will avoid reallocations completely.
+ *
+ * Use vector when data is mostly appended and read sequentially; if elements are often inserted
+ * or removed in the middle, or stable addresses are needed, use list instead. Iterators are plain
+ * pointers and they are invalidated by every operation that can change capacity.
+ *
+ * Besides usual methods, vector provides sort() and binary search helpers:
+ * \code
+ *   vector<int> v;
+ *   v.push_back(34);
+ *   v.push_back(4);
+ *   v.push_back(12);
+ *   v.sort();
+ *
+ *   if(v.binary_search(12))
+ *     printf("found 12\n");
+ * \endcode
+ */
+template <typename T>
+class vector {
+public:
+#ifndef SKIP_DOCS
+	typedef unsigned int size_type;
+	typedef T*           iterator;
+	typedef const T*     const_iterator;
+#endif
+private:
+	typedef bool (SortCmp)(const T& val1, const T& val2);
+
+	T*        data;
+	size_type sz;
+	size_type cap;
+
+	E_DISABLE_CLASS_COPY(vector)
+
+	static bool default_sort_cmp(const T& val1, const T& val2) { return val1 < val2; }
+
+	static void swap_values(T& a, T& b) {
+		T tmp(a);
+		a = b;
+		b = tmp;
+	}
+
+	/* heapsort; it does not need extra memory and does not degrade on sorted input */
+	static void sift_down(T* arr, size_type root, size_type n, SortCmp* cmp) {
+		size_type child;
+
+		while((child = root * 2 + 1) < n) {
+			if(child + 1 < n && cmp(arr[child], arr[child + 1]))
+				child++;
+
+			if(!cmp(arr[root], arr[child]))
+				return;
+
+			swap_values(arr[root], arr[child]);
+			root = child;
+		}
+	}
+
+	void grow(size_type n) {
+		size_type c = cap ? cap : 8;
+		while(c < n) c *= 2;
+		reserve(c);
+	}
+
+public:
+	/**
+	 * Creates an empty vector
+	 */
+	vector() : data(0), sz(0), cap(0) { }
+
+	/**
+	 * Clears data
+	 */
+	~vector() { clear(); ::operator delete(data); }
+
+	/**
+	 * Clear all data. Allocated memory is kept, so the vector can be filled again
+	 * without reallocations.
+	 */
+	void clear(void) {
+		for(size_type i = 0; i < sz; i++)
+			data[i].~T();
+		sz = 0;
+	}
+
+	/**
+	 * Make sure vector can hold at least given number of elements without reallocating
+	 * memory. It will never shrink the vector.
+	 *
+	 * \param n is number of elements
+	 */
+	void reserve(size_type n) {
+		if(n <= cap) return;
+
+		T* ndata = (T*)::operator new(n * sizeof(T));
+		for(size_type i = 0; i < sz; i++) {
+			new (ndata + i) T(data[i]);
+			data[i].~T();
+		}
+
+		::operator delete(data);
+		data = ndata;
+		cap = n;
+	}
+
+	/**
+	 * Adds new value to the end of the vector.
+	 * \param val is value to be added
+	 */
+	void push_back(const T& val) {
+		if(sz == cap) {
+			/* val can be an element of this vector, so keep a copy before growing */
+			T tmp(val);
+			grow(sz + 1);
+			new (data + sz) T(tmp);
+		} else {
+			new (data + sz) T(val);
+		}
+
+		sz++;
+	}
+
+	/**
+	 * Remove last element.
+	 */
+	void pop_back(void) {
+		E_ASSERT(sz > 0 && "Bad code! pop_back() on empty vector!!!");
+		sz--;
+		data[sz].~T();
+	}
+
+	/**
+	 * Inserts given value at position <b>before</b> position pointing by given iterator.
+	 *
+	 * \return iterator pointing to inserted element
+	 * \param it is location before to be inserted
+	 * \param val is value to insert
+	 */
+	iterator insert(iterator it, const T& val) {
+		size_type pos = it - data;
+		E_ASSERT(pos <= sz && "Bad code! Iterator out of range!!!");
+
+		T tmp(val);
+		if(sz == cap) grow(sz + 1);
+
+		if(pos == sz) {
+			new (data + sz) T(tmp);
+		} else {
+			new (data + sz) T(data[sz - 1]);
+			for(size_type i = sz - 1; i > pos; i--)
+				data[i] = data[i - 1];
+			data[pos] = tmp;
+		}
+
+		sz++;
+		return data + pos;
+	}
+
+	/**
+	 * Remove element given at iterator position.
+	 *
+	 * \return iterator pointing to the next element
+	 * \param it is element to be removed
+	 */
+	iterator erase(iterator it) {
+		size_type pos = it - data;
+		E_ASSERT(pos < sz && "Bad code! Iterator out of range!!!");
+
+		for(size_type i = pos; i + 1 < sz; i++)
+			data[i] = data[i + 1];
+
+		sz--;
+		data[sz].~T();
+		return data + pos;
+	}
+
+	/**
+	 * Return iterator pointing to the start of the vector.
+	 */
+	iterator begin(void) { return data; }
+
+	/**
+	 * Return const iterator pointing to the start of the vector.
+	 */
+	const_iterator begin(void) const { return data; }
+
+	/**
+	 * Return iterator pointing <b>after</b> the end of the vector.
+	 */
+	iterator end(void) { return data + sz; }
+
+	/**
+	 * Return const iterator pointing <b>after</b> the end of the vector.
+	 */
+	const_iterator end(void) const { return data + sz; }
+
+	/**
+	 * Return reference to element at given position.
+	 */
+	T& operator[](size_type i) {
+		E_ASSERT(i < sz && "Bad code! Index out of range!!!");
+		return data[i];
+	}
+
+	/**
+	 * Return const reference to element at given position.
+	 */
+	const T& operator[](size_type i) const {
+		E_ASSERT(i < sz && "Bad code! Index out of range!!!");
+		return data[i];
+	}
+
+	/**
+	 * Return reference to first element in the vector.
+	 */
+	T& front(void) { return operator[](0); }
+
+	/**
+	 * Return const reference to first element in the vector.
+	 */
+	const T& front(void) const { return operator[](0); }
+
+	/**
+	 * Return reference to last element in the vector.
+	 */
+	T& back(void) { return operator[](sz - 1); }
+
+	/**
+	 * Return const reference to last element in the vector.
+	 */
+	const T& back(void) const { return operator[](sz - 1); }
+
+	/**
+	 * Return size of vector.
+	 */
+	size_type size(void) const { return sz; }
+
+	/**
+	 * Return number of elements vector can hold without reallocating memory.
+	 */
+	size_type capacity(void) const { return cap; }
+
+	/**
+	 * Return true if vector is empty; otherwise false.
+	 */
+	bool empty(void) const { return sz == 0; }
+
+	/**
+	 * Sorts vector. If cmp function is given (in form <em>bool cmp(const T& v1, const T& v2)</em>,
+	 * elements will be compared with it. Sort is not stable.
+	 */
+	void sort(SortCmp* cmp = default_sort_cmp) {
+		if(sz < 2) return;
+
+		for(size_type i = sz / 2; i > 0; i--)
+			sift_down(data, i - 1, sz, cmp);
+
+		for(size_type n = sz - 1; n > 0; n--) {
+			swap_values(data[0], data[n]);
+			sift_down(data, 0, n, cmp);
+		}
+	}
+
+	/**
+	 * Return iterator to the first element not less than given value, or end() if there is
+	 * no such element. Vector must be sorted with the same cmp function.
+	 */
+	iterator lower_bound(const T& val, SortCmp* cmp = default_sort_cmp) {
+		size_type lo = 0, hi = sz, mid;
+
+		while(lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if(cmp(data[mid], val))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		return data + lo;
+	}
+
+	/**
+	 * Return true if given value is present in vector. Vector must be sorted with the same
+	 * cmp function.
+	 */
+	bool binary_search(const T& val, SortCmp* cmp = default_sort_cmp) {
+		iterator it = lower_bound(val, cmp);
+		return (it != end() && !cmp(val, *it));
+	}
+};
+
+EDELIB_NS_END
+#endif
@@ -233,6 +233,17 @@
 	}
                                                 
 
+/**
+ * \def EDELIB_HAVE_RVALUE_REFERENCES
+ * \ingroup macros
+ *
+ * Defined when compiler supports C++11 rvalue references. Classes will provide move constructor
+ * and move assignment operator only if this macro is defined.
+ */
+#if defined(__cplusplus) && (__cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__))
+# define EDELIB_HAVE_RVALUE_REFERENCES 1
+#endif
+
 #ifdef __GNUC__
 # define EDELIB_DEPRECATED __attribute__ ((deprecated))
 #else
@@ -23,7 +23,7 @@
 #include <edelib/ColorDb.h>
 #include <edelib/Debug.h>
 #include <edelib/String.h>
-#include <edelib/List.h>
+#include <edelib/Vector.h>
 
 EDELIB_NS_BEGIN
 
@@ -39,16 +39,24 @@ static const char *x11_rgb[] = {
 
 struct ColorInfo {
 	unsigned char r, g, b;
+	/* line order, so the first of duplicate names is found, as before sorting */
+	unsigned int pos;
 	String name;
 };
 
-typedef list<ColorInfo> ColorInfoList;
-typedef list<ColorInfo>::iterator ColorInfoListIt;
+typedef vector<ColorInfo> ColorInfoList;
+typedef vector<ColorInfo>::iterator ColorInfoListIt;
 
 struct ColorDb_P {
 	ColorInfoList list;
 };
 
+static bool color_info_cmp(const ColorInfo &c1, const ColorInfo &c2) {
+	int ret = strcmp(c1.name.c_str(), c2.name.c_str());
+	if(ret != 0) return ret < 0;
+	return c1.pos < c2.pos;
+}
+
 ColorDb::ColorDb() : priv(NULL) {
 }
 
@@ -71,6 +79,7 @@ bool ColorDb::load(const char *file) {
 
 	char buf[256], name[64];
 	int r, g, b, ret;
+	unsigned int pos = 0;
 
 	if(!priv) {
 		priv = new ColorDb_P;
@@ -92,11 +101,15 @@ bool ColorDb::load(const char *file) {
 		c.r = (unsigned char)r;
 		c.g = (unsigned char)g;
 		c.b = (unsigned char)b;
+		c.pos = pos++;
 
 		priv->list.push_back(c);
 	}
 
 	fclose(fd);
+
+	/* entries are only searched after load, so keep them sorted for binary search */
+	priv->list.sort(color_info_cmp);
 	return true;
 }
 
@@ -104,18 +117,18 @@ bool ColorDb::find(const char *name, unsigned char &r, unsigned char &g, unsigne
 	E_RETURN_VAL_IF_FAIL(priv != NULL, false);
 	E_RETURN_VAL_IF_FAIL(priv->list.empty() != true, false);
 
-	ColorInfoListIt it = priv->list.begin(), ite = priv->list.end();
-	for(; it != ite; ++it) {
-		if((*it).name == name) {
-			r = (*it).r;
-			g = (*it).g;
-			b = (*it).b;
+	ColorInfo key;
+	key.pos = 0;
+	key.name = name;
 
-			return true;
-		}
-	}
+	ColorInfoListIt it = priv->list.lower_bound(key, color_info_cmp);
+	if(it == priv->list.end() || (*it).name != name)
+		return false;
 
-	return false;
+	r = (*it).r;
+	g = (*it).g;
+	b = (*it).b;
+	return true;
 }
 
 EDELIB_NS_END
@@ -19,6 +19,9 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <sys/stat.h>
 
 #include <edelib/Config.h>
@@ -27,16 +30,19 @@
 #include <edelib/StrUtil.h>
 #include <edelib/Nls.h>
 
-#define ESECT_MAX         128 /* max section len */
-#define EKEY_MAX          128 /* max key len */
-#define ELINE_SIZE_START 1024 /* starting size for line/value, can grow */
+#include "HashTable.h"
 
 #define COMMENT    '#'
 #define SECT_OPEN  '['
 #define SECT_CLOSE ']'
 #define KV_DELIM   '='
 
-#define EAT_SPACES(ptr) while(*ptr && isspace(*ptr)) ptr++
+#define EAT_SPACES(ptr) while(*ptr && isspace((unsigned char)*ptr)) ptr++
+
+/* ConfigEntry flags; tells which parts are not allocated from the file buffer */
+#define ENTRY_KEY_ALLOCATED   (1 << 0)
+#define ENTRY_VALUE_ALLOCATED (1 << 1)
+#define ENTRY_ALLOCATED       (1 << 2)
 
 EDELIB_NS_BEGIN
 
@@ -46,6 +52,18 @@ struct ConfigEntry {
 	unsigned int keylen;
 	unsigned int valuelen;
 	unsigned int hash;
+	unsigned int flags;
+};
+
+/*
+ * Storage for loaded file. Whole file is read in 'buf' and parsed in place, so keys and values
+ * points inside it; entries are taken from 'entries' array, sized by the number of lines.
+ */
+struct ConfigArena {
+	char*        buf;
+	ConfigEntry* entries;
+	unsigned int nentries;
+	unsigned int used;
 };
 
 class ConfigSection {
@@ -56,12 +74,15 @@ private:
 	size_t snamelen;
 	unsigned shash;
 
-	EntryList entry_list;
+	/* entries are found through hash, but list keeps them in the order save() writes them */
+	EntryList    entry_list;
+	StrHashTable entry_hash;
 
 	ConfigSection(const ConfigSection&);
 	ConfigSection& operator=(ConfigSection&);
 
 	void add_entry(const char* key, const char* value);
+	void add_entry(char* key, unsigned int keylen, char* value, unsigned int valuelen, ConfigEntry* e);
 	void remove_entry(const char* key);
 	ConfigEntry* find_entry(const char* key);
 
@@ -125,60 +146,52 @@ int config_getline(char** buf, int* len, FILE* f) {
 	return i;
 }
 
-/*
- * scan section in [section]
- * returned value is terminated with '\0'
- */
-static bool scan_section(char* line, char* buf, int bufsz) {
-	char* bufp = buf;
-	bool status = false;
-
-	str_trimleft(line);
-
-	for(; *line && bufsz > 0; line++) {
-		if(*line == SECT_CLOSE) {
-			status = true;
-			break;
-		}
+/* strip surrounding spaces without moving the content; returns new start and sets new length */
+static char* trim_in_place(char* str, char* end, unsigned int& len) {
+	while(str < end && isspace((unsigned char)*str))
+		str++;
 
-		*bufp++ = *line;
-		bufsz--;
-	}
+	while(end > str && isspace((unsigned char)end[-1]))
+		end--;
 
-	*bufp = '\0';
-	str_trimright(buf);
-	return status;
+	*end = '\0';
+	len = end - str;
+	return str;
 }
 
-/*
- * scans key = value part
- * returned values are terminated with '\0'
- */
-static bool scan_keyvalues(char* line, char* key, char* val, int linesz, int keysz, int valsz) {
-	char* linep = line;
+/* read whole file in one shot; returned buffer is terminated with '\0' */
+static char* config_read_file(const char* fname, unsigned int& size) {
+	int fd = open(fname, O_RDONLY);
+	if(fd == -1) return NULL;
 
-	char* pos = strchr(line, KV_DELIM);
-	if (!pos)
-		return false;
+	struct stat st;
+	if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return NULL;
+	}
 
-	int i;
-	for (i = 0; (*linep != *pos) && (i < keysz); linep++, i++)
-		key[i] = *linep;
-	key[i] = '\0';
+	char* buf = new char[st.st_size + 1];
+	ssize_t n;
+	size = 0;
 
-	// skip KV_DELIM
-	if (*linep == KV_DELIM)
-		linep++;
+	while(size < (unsigned int)st.st_size) {
+		n = read(fd, buf + size, st.st_size - size);
+		if(n == -1) {
+			if(errno == EINTR) continue;
 
-	for (i = 0; *linep && (*linep != '\n') && (i < valsz) && (i < linesz); linep++, i++)
-		val[i] = *linep;
-	val[i] = '\0';
+			delete [] buf;
+			close(fd);
+			return NULL;
+		}
 
-	// trim spaces
-	str_trim(key);
-	str_trim(val);
+		/* file was truncated in the meantime */
+		if(n == 0) break;
+		size += n;
+	}
 
-	return true;
+	buf[size] = '\0';
+	close(fd);
+	return buf;
 }
 
 /*
@@ -192,16 +205,19 @@ ConfigSection::ConfigSection(const char* n) {
 	shash = str_hash(sname, snamelen);
 }
 
-ConfigSection::~ConfigSection() {
-	EntryListIter it = entry_list.begin();
-	ConfigEntry *e;
-	for (; it != entry_list.end(); ++it) {
-		e = *it;
+static void entry_free(ConfigEntry* e) {
+	if(e->flags & ENTRY_KEY_ALLOCATED)
 		free(e->key);
+	if(e->flags & ENTRY_VALUE_ALLOCATED)
 		free(e->value);
+	if(e->flags & ENTRY_ALLOCATED)
 		delete e;
-		e = NULL;
-	}
+}
+
+ConfigSection::~ConfigSection() {
+	EntryListIter it = entry_list.begin();
+	for (; it != entry_list.end(); ++it)
+		entry_free(*it);
 
 	free(sname);
 }
@@ -223,57 +239,89 @@ void ConfigSection::add_entry(const char* key, const char* value) {
 		e->key      = strdup(key);
 		e->value    = strdup(value);
 		e->hash     = str_hash(e->key, e->keylen);
+		e->flags    = ENTRY_KEY_ALLOCATED | ENTRY_VALUE_ALLOCATED | ENTRY_ALLOCATED;
 
 		E_ASSERT(e->key != NULL);
 		E_ASSERT(e->value != NULL);
 
 		entry_list.push_back(e);
+		entry_hash.insert(e->key, e->keylen, e->hash, e);
 	} else {
-		free(e->value);
+		if(e->flags & ENTRY_VALUE_ALLOCATED)
+			free(e->value);
+
 		e->valuelen = strlen(value);
 		e->value    = strdup(value);
+		e->flags   |= ENTRY_VALUE_ALLOCATED;
 
 		E_ASSERT(e->value != NULL);
 	}
 }
 
+/*
+ * Add key/value that points inside loaded file buffer, using preallocated 'e' if
+ * entry was not present.
+ */
+void ConfigSection::add_entry(char* key, unsigned int keylen, char* value, unsigned int valuelen, ConfigEntry* e) {
+	unsigned int hh = str_hash(key, keylen);
+	ConfigEntry* old = (ConfigEntry*)entry_hash.find(key, keylen, hh);
+
+	if(old) {
+		if(old->flags & ENTRY_VALUE_ALLOCATED)
+			free(old->value);
+
+		old->value    = value;
+		old->valuelen = valuelen;
+		old->flags   &= ~ENTRY_VALUE_ALLOCATED;
+		return;
+	}
+
+	e->key      = key;
+	e->keylen   = keylen;
+	e->value    = value;
+	e->valuelen = valuelen;
+	e->hash     = hh;
+	e->flags    = 0;
+
+	entry_list.push_back(e);
+	entry_hash.insert(e->key, e->keylen, e->hash, e);
+}
+
 void ConfigSection::remove_entry(const char* key) {
-	E_ASSERT(key != NULL);
+	ConfigEntry* e = find_entry(key);
+	if(!e) return;
 
-	unsigned int hh = str_hash(key);
-	EntryListIter it = entry_list.begin();
+	entry_hash.remove(e->key, e->keylen, e->hash);
 
-	for(; it != entry_list.end(); ++it) {
-		ConfigEntry* e = *it;
-		if(hh == e->hash && strncmp(e->key, key, e->keylen) == 0)
+	EntryListIter it = entry_list.begin(), it_end = entry_list.end();
+	for(; it != it_end; ++it) {
+		if(*it == e) {
 			entry_list.erase(it);
+			break;
+		}
 	}
+
+	entry_free(e);
 }
 
 ConfigEntry* ConfigSection::find_entry(const char* key) {
 	E_ASSERT(key != NULL);
 
-	unsigned int hh = str_hash(key);
-	EntryListIter it = entry_list.begin(), it_end = entry_list.end();
-
-	for (; it != it_end; ++it) {
-		ConfigEntry* e = *it;
-		if (hh == e->hash && strncmp(e->key, key, e->keylen) == 0)
-			return e;
-	}
-	return NULL;
+	unsigned int len = strlen(key);
+	return (ConfigEntry*)entry_hash.find(key, len, str_hash(key, len));
 }
 
 /* Config methods */
-Config::Config() : errcode(0), linenum(0), sectnum(0), cached(0) {}
+Config::Config() : errcode(0), linenum(0), sectnum(0), cached(0), section_hash(0), arena(0) {}
 
 bool Config::load(const char* fname) {
 	E_ASSERT(fname != NULL);
 
 	clear();
 
-	FILE *f = fopen(fname, "r");
-	if (!f) {
+	unsigned int size;
+	char* buf = config_read_file(fname, size);
+	if (!buf) {
 		errcode = CONF_ERR_FILE;
 		return false;
 	}
@@ -285,25 +333,33 @@ bool Config::load(const char* fname) {
 	// we must have at least one section
 	bool sect_found = false;
 
-	// use fixed sizes for sections and keys
-	char section[ESECT_MAX];
-	char keybuf[EKEY_MAX];
-
-	// line and value can grow
-	int buflen = ELINE_SIZE_START;
-	char* buf = new char[buflen];
-
-	// use the same size as for line
-	int valbuflen = buflen;
-	char* valbuf = new char[valbuflen];
-
-	char *bufp;
+	/*
+	 * Every entry takes at least one line, so number of lines is enough for
+	 * all entries; this way all of them are allocated at once.
+	 */
+	unsigned int nlines = 1;
+	for (char* p = buf; (p = (char*)memchr(p, '\n', buf + size - p)) != NULL; p++)
+		nlines++;
+
+	arena = new ConfigArena;
+	arena->buf = buf;
+	arena->entries = new ConfigEntry[nlines];
+	arena->nentries = nlines;
+	arena->used = 0;
+
+	char *bufp, *line, *lend, *end = buf + size, *delim;
+	char *key, *val;
+	unsigned int keylen, vallen;
 	ConfigSection* tsect = NULL;
 
-	while(config_getline(&buf, &buflen, f) != -1) {
+	for (line = buf; line < end; line = lend + 1) {
+		lend = (char*)memchr(line, '\n', end - line);
+		if (!lend) lend = end;
+		*lend = '\0';
+
 		++linenum;
 
-		bufp = buf;
+		bufp = line;
 		EAT_SPACES(bufp);
 
 		// comment or empty line
@@ -314,19 +370,17 @@ bool Config::load(const char* fname) {
 		if (*bufp == SECT_OPEN) {
 			sect_found = true;
 			bufp++;
-			if (!scan_section(bufp, section, sizeof(section))) {
+
+			delim = strchr(bufp, SECT_CLOSE);
+			if (!delim) {
 				errcode = CONF_ERR_BAD;
 				status = false;
 				break;
-			} else {
-				// first check if section exists, or create if not
-				tsect = find_section(section);
-				if (!tsect) {
-					++sectnum;
-					tsect = new ConfigSection(section);
-					section_list.push_back(tsect);
-				}
 			}
+
+			// first check if section exists, or create if not
+			bufp = trim_in_place(bufp, delim, keylen);
+			tsect = add_section(bufp);
 		}
 		// data part
 		else {
@@ -337,33 +391,22 @@ bool Config::load(const char* fname) {
 				break;
 			}
 
-			/*
-			 * check if size of valbuf is less than buflen;
-			 * in that case make it size as buflen (better would be to use 
-			 * buflen - EKEY_MAX - '=' - <spaces>, but that would complicate thing,
-			 * also more size does not hurts :P)
-			 */
-			if(valbuflen < buflen) {
-				valbuflen = buflen;
-				delete [] valbuf;
-				valbuf = new char[valbuflen];
-			}
-
-			if (!scan_keyvalues(bufp, keybuf, valbuf, buflen, EKEY_MAX, valbuflen)) {
+			delim = strchr(bufp, KV_DELIM);
+			if (!delim) {
 				errcode = CONF_ERR_BAD;
 				status = false;
 				break;
 			}
 
+			key = trim_in_place(bufp, delim, keylen);
+			val = trim_in_place(delim + 1, lend, vallen);
+
 			E_ASSERT(tsect != NULL && "Entry without a section ?!");
-			tsect->add_entry(keybuf, valbuf);
+			E_ASSERT(arena->used < arena->nentries);
+			tsect->add_entry(key, keylen, val, vallen, &arena->entries[arena->used++]);
 		}
 	}
 
-	fclose(f);
-	delete [] buf;
-	delete [] valbuf;
-
 	return status;
 }
 
@@ -424,6 +467,10 @@ ConfigSection* Config::add_section(const char* section) {
 		++sectnum;
 		sc = new ConfigSection(section);
 		section_list.push_back(sc);
+
+		if(!section_hash)
+			section_hash = new StrHashTable;
+		section_hash->insert(sc->sname, sc->snamelen, sc->shash, sc);
 	}
 	return sc;
 }
@@ -435,22 +482,20 @@ ConfigSection* Config::add_section(const char* section) {
 ConfigSection* Config::find_section(const char* section) {
 	E_ASSERT(section != NULL);
 
-	unsigned int hh = str_hash(section);
+	unsigned int len = strlen(section);
+	unsigned int hh = str_hash(section, len);
 
 	// check if we have cached section
-	if (cached && cached->shash == hh && (strncmp(cached->sname, section, cached->snamelen) == 0))
+	if (cached && cached->shash == hh && cached->snamelen == len && (strncmp(cached->sname, section, len) == 0))
 		return cached;
 
-	SectionListIter it = section_list.begin(), it_end = section_list.end();
-	ConfigSection *cs;
-	for (; it != it_end; ++it) {
-		cs = *it;
-		if (cs->shash == hh && (strncmp(cs->sname, section, cs->snamelen) == 0)) {
-			cached = cs;
-			return cs;
-		}
-	}
-	return NULL;
+	if (!section_hash)
+		return NULL;
+
+	ConfigSection *cs = (ConfigSection*)section_hash->find(section, len, hh);
+	if (cs)
+		cached = cs;
+	return cs;
 }
 
 void Config::clear(void) {
@@ -459,6 +504,16 @@ void Config::clear(void) {
 		delete *it;
 	section_list.clear();
 
+	delete section_hash;
+	section_hash = 0;
+
+	if (arena) {
+		delete [] arena->buf;
+		delete [] arena->entries;
+		delete arena;
+		arena = 0;
+	}
+
 	errcode = 0;
 	linenum = 0;
 	sectnum = 0;
@@ -67,6 +67,14 @@ void DirWatch::callback(DirWatchCallback& cb, void* data) {
 	DirWatch::instance()->add_callback(cb, data);
 }
 
+void DirWatch::batch_callback(DirWatchBatchCallback& cb, void* data) {
+	DirWatch::instance()->add_batch_callback(cb, data);
+}
+
+void DirWatch::debounce(double t) {
+	DirWatch::instance()->set_debounce(t);
+}
+
 DirWatchNotifier DirWatch::notifier(void) {
 	return DirWatch::instance()->get_notifier();
 }
@@ -34,6 +34,8 @@ struct DirWatchEntry {
 struct DirWatchImpl {
 	DirWatchCallback* callback;
 	void* callback_data;
+	DirWatchBatchCallback* batch_callback;
+	void* batch_callback_data;
 	FAMConnection fc;
 
 	list<DirWatchEntry*> entries;
@@ -41,16 +43,30 @@ struct DirWatchImpl {
 
 typedef list<DirWatchEntry*>::iterator DirEntryIter;
 
+/* FAM gives events one by one, so batch callback gets them one by one too */
+static void report_event(DirWatchImpl* impl, DirWatchEntry* entry, const char* name, int report) {
+	if(impl->callback)
+		impl->callback(entry->name.c_str(), name, report, impl->callback_data);
+
+	if(impl->batch_callback) {
+		DirWatchEvent e;
+		e.dir = entry->name.c_str();
+		e.name = name;
+		e.flags = report;
+
+		impl->batch_callback(&e, 1, impl->batch_callback_data);
+	}
+}
+
 static void watch_callback(int fd, void* data) {
 	DirWatchImpl* impl = (DirWatchImpl*)data;
-	DirWatchCallback* cb = impl->callback;
 	FAMEvent ev;
 
 	/*
 	 * No callback; just clear FAM event queue or it will
 	 * notify us infinitely until we do so
 	 */
-	if(!cb) {
+	if(!impl->callback && !impl->batch_callback) {
 		while(FAMPending(&impl->fc))
 			FAMNextEvent(&impl->fc, &ev);
 		return;
@@ -92,15 +108,15 @@ static void watch_callback(int fd, void* data) {
 		switch(ev.code) {
 			case FAMCreated:
 				if(entry->flags & DW_CREATE)
-					cb(entry->name.c_str(), ev.filename, DW_REPORT_CREATE, impl->callback_data);
+					report_event(impl, entry, ev.filename, DW_REPORT_CREATE);
 				break;
 			case FAMDeleted:
 				if(entry->flags & DW_DELETE)
-					cb(entry->name.c_str(), ev.filename, DW_REPORT_DELETE, impl->callback_data);
+					report_event(impl, entry, ev.filename, DW_REPORT_DELETE);
 				break;
 			case FAMChanged:
 				if(entry->flags & DW_MODIFY)
-					cb(entry->name.c_str(), ev.filename, DW_REPORT_MODIFY, impl->callback_data);
+					report_event(impl, entry, ev.filename, DW_REPORT_MODIFY);
 				break;
 			default:
 				break;
@@ -133,6 +149,8 @@ bool DirWatch::init_backend(void) {
 	impl = new DirWatchImpl;
 	impl->callback = NULL;
 	impl->callback_data = NULL;
+	impl->batch_callback = NULL;
+	impl->batch_callback_data = NULL;
 
 	if(FAMOpen(&(impl->fc)) != 0) {
 		/* can't start/connect to FAM daemon */
@@ -219,4 +237,16 @@ void DirWatch::add_callback(DirWatchCallback* cb, void* data) {
 	impl->callback_data = data;
 }
 
+void DirWatch::add_batch_callback(DirWatchBatchCallback* cb, void* data) {
+	/* allow NULL callbacks */
+	E_ASSERT(impl != NULL);
+
+	impl->batch_callback = cb;
+	impl->batch_callback_data = data;
+}
+
+void DirWatch::set_debounce(double t) {
+	/* FAM reports events one by one as they come; nothing to collect them with */
+}
+
 EDELIB_NS_END
@@ -41,4 +41,10 @@ bool DirWatch::remove_entry(const char* dir) {
 void DirWatch::add_callback(DirWatchCallback* cb, void* data) {
 }
 
+void DirWatch::add_batch_callback(DirWatchBatchCallback* cb, void* data) {
+}
+
+void DirWatch::set_debounce(double t) {
+}
+
 EDELIB_NS_END
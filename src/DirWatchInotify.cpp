@@ -18,40 +18,452 @@
 
 
 #include <sys/inotify.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <dirent.h>
 #include <errno.h>
+#include <string.h>
 #include <FL/Fl.H>
+#include <edelib/StrUtil.h>
+#include <edelib/Vector.h>
 
 #define EVENT_SIZE (sizeof (struct inotify_event))
 #define BUFF_LEN (1024 * (EVENT_SIZE + 16))
 
+/* every event has at least EVENT_SIZE bytes, so this is more than events in one read */
+#define COALESCE_SIZE 4096
+
 EDELIB_NS_BEGIN
 
 struct DirWatchEntry {
 	String name;      // directory full path
-	int dir_fd;       // directory descriptor
+	int dir_fd;       // directory descriptor; -1 if kernel removed the watch
+	int flags;        // DirWatchFlags given to add()
+
+	/* recursive entry this subdirectory was added for; NULL if added with add() */
+	DirWatchEntry* root;
+
+	/* changes collected while waiting for debounce timeout */
+	bool           pending;
+	int            pending_report;
+	DirWatchEntry* pending_next;
+
+	unsigned int   name_hash;
+	DirWatchEntry* wd_next;   // next in DirWatchImpl::wd_table bucket
+	DirWatchEntry* name_next; // next in DirWatchImpl::name_table bucket
+	DirWatchEntry* dead_next;
 };
 
+/*
+ * Entries are hashed by watch descriptor (for events) and by name (for add/remove). Both
+ * tables have the same size, which is power of 2.
+ */
 struct DirWatchImpl {
 	DirWatchCallback* callback;
 	void* callback_data;
+	DirWatchBatchCallback* batch_callback;
+	void* batch_callback_data;
 	int   inotify_fd;
 
-	String tmp_storage;
-	list<DirWatchEntry*> entries;
+	DirWatchEntry** wd_table;
+	DirWatchEntry** name_table;
+	unsigned int    table_size;
+	unsigned int    nentries;
+
+	/* events from one read; entries removed while they are processed are freed after that */
+	vector<DirWatchEvent> events;
+	int                   coalesce[COALESCE_SIZE];
+	bool                  dispatching;
+	DirWatchEntry*        dead;
+	list<String>          names;  // names of items found in new subdirectories
+
+	/* debounce window in seconds; 0 if disabled */
+	double                debounce;
+	bool                  debounce_scheduled;
+	DirWatchEntry*        pending;
 };
 
-typedef list<DirWatchEntry*>::iterator DirEntryIter;
+static inline unsigned int wd_bucket(DirWatchImpl* impl, int wd) {
+	return ((unsigned int)wd * 2654435761U) & (impl->table_size - 1);
+}
+
+static void entry_tables_grow(DirWatchImpl* impl) {
+	unsigned int nsize = impl->table_size ? impl->table_size * 2 : 64;
+	DirWatchEntry** nwd = new DirWatchEntry*[nsize];
+	DirWatchEntry** nname = new DirWatchEntry*[nsize];
+	DirWatchEntry *e, *next;
+	unsigned int i, b;
+
+	for(i = 0; i < nsize; i++)
+		nwd[i] = nname[i] = NULL;
+
+	/* every entry is in name table, so walking it is enough */
+	for(i = 0; i < impl->table_size; i++) {
+		for(e = impl->name_table[i]; e; e = next) {
+			next = e->name_next;
+
+			b = e->name_hash & (nsize - 1);
+			e->name_next = nname[b];
+			nname[b] = e;
+
+			if(e->dir_fd >= 0) {
+				b = ((unsigned int)e->dir_fd * 2654435761U) & (nsize - 1);
+				e->wd_next = nwd[b];
+				nwd[b] = e;
+			}
+		}
+	}
+
+	delete [] impl->wd_table;
+	delete [] impl->name_table;
+	impl->wd_table = nwd;
+	impl->name_table = nname;
+	impl->table_size = nsize;
+}
+
+static DirWatchEntry* entry_find(DirWatchImpl* impl, const char* dir, unsigned int h) {
+	if(!impl->table_size)
+		return NULL;
+
+	for(DirWatchEntry* e = impl->name_table[h & (impl->table_size - 1)]; e; e = e->name_next) {
+		if(e->name_hash == h && e->name == dir)
+			return e;
+	}
+
+	return NULL;
+}
+
+static void entry_unlink_wd(DirWatchImpl* impl, DirWatchEntry* entry) {
+	if(entry->dir_fd < 0)
+		return;
+
+	for(DirWatchEntry** pp = &impl->wd_table[wd_bucket(impl, entry->dir_fd)]; *pp; pp = &(*pp)->wd_next) {
+		if(*pp == entry) {
+			*pp = entry->wd_next;
+			break;
+		}
+	}
+
+	entry->dir_fd = -1;
+}
+
+static void entry_unlink_pending(DirWatchImpl* impl, DirWatchEntry* entry) {
+	if(!entry->pending)
+		return;
+
+	for(DirWatchEntry** pp = &impl->pending; *pp; pp = &(*pp)->pending_next) {
+		if(*pp == entry) {
+			*pp = entry->pending_next;
+			break;
+		}
+	}
+
+	entry->pending = false;
+}
+
+/* remove entry from all tables and free it, or delay freeing if events still point to it */
+static void entry_release(DirWatchImpl* impl, DirWatchEntry* entry) {
+	for(DirWatchEntry** pp = &impl->name_table[entry->name_hash & (impl->table_size - 1)]; *pp; pp = &(*pp)->name_next) {
+		if(*pp == entry) {
+			*pp = entry->name_next;
+			break;
+		}
+	}
+
+	entry_unlink_wd(impl, entry);
+	entry_unlink_pending(impl, entry);
+	impl->nentries--;
+
+	if(impl->dispatching) {
+		entry->dead_next = impl->dead;
+		impl->dead = entry;
+	} else {
+		delete entry;
+	}
+}
+
+/* remove kernel watch, unless the same directory is watched under other name, and release entry */
+static void entry_forget(DirWatchImpl* impl, DirWatchEntry* entry) {
+	if(entry->dir_fd >= 0) {
+		DirWatchEntry* e = impl->wd_table[wd_bucket(impl, entry->dir_fd)];
+		for(; e; e = e->wd_next) {
+			if(e != entry && e->dir_fd == entry->dir_fd)
+				break;
+		}
+
+		if(!e)
+			inotify_rm_watch(impl->inotify_fd, entry->dir_fd);
+	}
+
+	entry_release(impl, entry);
+}
+
+/* release subdirectory 'dir' and everything below it, added for recursive entry 'root' */
+static void entry_forget_subtree(DirWatchImpl* impl, const String& dir, DirWatchEntry* root) {
+	DirWatchEntry *e, *next;
+	unsigned int len = dir.length();
+
+	for(unsigned int i = 0; i < impl->table_size; i++) {
+		for(e = impl->name_table[i]; e; e = next) {
+			next = e->name_next;
+			if(e->root != root || e->name.length() < len)
+				continue;
 
-static void watch_callback(int fd, void* data) { 
+			if(strncmp(e->name.c_str(), dir.c_str(), len) != 0)
+				continue;
+
+			if(e->name.length() > len && e->name.c_str()[len] != E_DIR_SEPARATOR)
+				continue;
+
+			entry_forget(impl, e);
+		}
+	}
+}
+
+static DirWatchEntry* entry_add(DirWatchImpl* impl, const char* dir, int flags, DirWatchEntry* root) {
+	/*
+	 * if entry already exists, just skip it since calling inotify code on the already
+	 * watched will reset flags
+	 */
+	unsigned int h = str_hash(dir);
+	DirWatchEntry* e = entry_find(impl, dir, h);
+	if(e)
+		return e;
+
+	int inotify_flags = 0;
+	if(flags & DW_CREATE) inotify_flags |= IN_CREATE | IN_MOVED_TO;
+	if(flags & DW_DELETE) inotify_flags |= IN_DELETE | IN_MOVED_FROM;
+	if(flags & DW_MODIFY) inotify_flags |= IN_MODIFY;
+	if(flags & DW_ATTRIB) inotify_flags |= IN_ATTRIB;
+	/* we must know about new and removed subdirectories, even if caller is not interested in them */
+	if(flags & DW_RECURSIVE) inotify_flags |= IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM;
+	/* ignore other flags */
+
+	int fd = inotify_add_watch(impl->inotify_fd, dir, inotify_flags);
+	if(fd < 0)
+		return NULL;
+
+	if(impl->nentries >= impl->table_size)
+		entry_tables_grow(impl);
+
+	e = new DirWatchEntry;
+	e->name = dir;
+	e->dir_fd = fd;
+	e->flags = flags;
+	e->root = root;
+	e->pending = false;
+	e->pending_report = DW_REPORT_NONE;
+	e->pending_next = NULL;
+	e->name_hash = h;
+	e->dead_next = NULL;
+
+	unsigned int b = h & (impl->table_size - 1);
+	e->name_next = impl->name_table[b];
+	impl->name_table[b] = e;
+
+	b = wd_bucket(impl, fd);
+	e->wd_next = impl->wd_table[b];
+	impl->wd_table[b] = e;
+
+	impl->nentries++;
+	return e;
+}
+
+static void events_dispatch(DirWatchImpl* impl) {
+	if(impl->callback) {
+		for(unsigned int j = 0; j < impl->events.size(); j++) {
+			DirWatchEvent& e = impl->events[j];
+			impl->callback(e.dir, e.name, e.flags, impl->callback_data);
+		}
+	}
+
+	if(impl->batch_callback)
+		impl->batch_callback(impl->events.begin(), impl->events.size(), impl->batch_callback_data);
+}
+
+static void dead_entries_free(DirWatchImpl* impl) {
+	DirWatchEntry* entry;
+
+	while(impl->dead) {
+		entry = impl->dead;
+		impl->dead = entry->dead_next;
+		delete entry;
+	}
+}
+
+/* debounce window expired; report one aggregated change for each changed directory */
+static void debounce_cb(void* data) {
+	DirWatchImpl* impl = (DirWatchImpl*)data;
+	DirWatchEntry* entry;
+	DirWatchEvent e;
+
+	impl->debounce_scheduled = false;
+	impl->events.clear();
+
+	for(entry = impl->pending; entry; entry = entry->pending_next) {
+		e.dir = entry->name.c_str();
+		e.name = NULL;
+		e.flags = entry->pending_report;
+		impl->events.push_back(e);
+	}
+
+	/* pending list is in reversed order */
+	for(unsigned int i = 0, n = impl->events.size(); i < n / 2; i++) {
+		e = impl->events[i];
+		impl->events[i] = impl->events[n - i - 1];
+		impl->events[n - i - 1] = e;
+	}
+
+	while(impl->pending) {
+		entry = impl->pending;
+		impl->pending = entry->pending_next;
+		entry->pending = false;
+	}
+
+	if(impl->events.empty())
+		return;
+
+	impl->dispatching = true;
+	events_dispatch(impl);
+	impl->dispatching = false;
+
+	dead_entries_free(impl);
+}
+
+static void entry_mark_pending(DirWatchImpl* impl, DirWatchEntry* entry, int report) {
+	if(!entry->pending) {
+		entry->pending = true;
+		entry->pending_report = report;
+		entry->pending_next = impl->pending;
+		impl->pending = entry;
+	} else if(entry->pending_report != report) {
+		/* different kinds of changes happened */
+		entry->pending_report = DW_REPORT_NONE;
+	}
+
+	if(!impl->debounce_scheduled) {
+		Fl::add_timeout(impl->debounce, debounce_cb, impl);
+		impl->debounce_scheduled = true;
+	}
+}
+
+/*
+ * Add event to the list, unless the last event for the same item is the same; e.g. a file written
+ * in small chunks will give only one DW_REPORT_MODIFY per read.
+ */
+static void event_push(DirWatchImpl* impl, DirWatchEntry* entry, const char* name, int report) {
+	if(impl->debounce > 0) {
+		entry_mark_pending(impl, entry, report);
+		return;
+	}
+
+	unsigned int h = (unsigned int)entry->dir_fd * 2654435761U;
+	if(name) h ^= str_hash(name);
+
+	unsigned int i = h & (COALESCE_SIZE - 1);
+	int idx;
+	DirWatchEvent* ev;
+
+	/* keep table at most half full; the same directory added under many names could fill it */
+	bool coalesce = impl->events.size() < COALESCE_SIZE / 2;
+
+	/* linear probing; find the last event for this item */
+	while(coalesce && (idx = impl->coalesce[i]) != -1) {
+		ev = &impl->events[idx];
+
+		if(ev->dir == entry->name.c_str() &&
+		   (ev->name == name || (ev->name && name && strcmp(ev->name, name) == 0)))
+		{
+			if(ev->flags == report)
+				return;
+			break;
+		}
+
+		i = (i + 1) & (COALESCE_SIZE - 1);
+	}
+
+	DirWatchEvent e;
+	e.dir = entry->name.c_str();
+	e.name = name;
+	e.flags = report;
+
+	if(coalesce)
+		impl->coalesce[i] = impl->events.size();
+	impl->events.push_back(e);
+}
+
+/*
+ * Add all subdirectories of 'parent'; symbolic links are not followed so there are no loops. When
+ * directory was created while we were watching, items could be created in it before it was added,
+ * so 'report' will emit create events for everything found.
+ */
+static void entry_add_subdirs(DirWatchImpl* impl, DirWatchEntry* parent, DirWatchEntry* root, bool report) {
+	const String& dir = parent->name;
+	DIR* d = opendir(dir.c_str());
+	if(!d)
+		return;
+
+	report = report && (root->flags & DW_CREATE);
+
+	dirent* dp;
+	String  path;
+	bool    is_dir;
+	DirWatchEntry* e;
+
+	while((dp = readdir(d)) != NULL) {
+		if(dp->d_name[0] == '.' && (dp->d_name[1] == '\0' || (dp->d_name[1] == '.' && dp->d_name[2] == '\0')))
+			continue;
+
+		if(report) {
+			impl->names.push_back(dp->d_name);
+			event_push(impl, parent, impl->names.back().c_str(), DW_REPORT_CREATE);
+		}
+
+		path = dir;
+		path += E_DIR_SEPARATOR_STR;
+		path += dp->d_name;
+
+#ifdef HAVE_D_TYPE
+		if(dp->d_type != DT_UNKNOWN) {
+			is_dir = (dp->d_type == DT_DIR);
+		} else
+#endif
+		{
+			struct stat st;
+			is_dir = (lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+		}
+
+		if(is_dir && (e = entry_add(impl, path.c_str(), root->flags, root)) != NULL)
+			entry_add_subdirs(impl, e, root, report);
+	}
+
+	closedir(d);
+}
+
+static bool report_wanted(int flags, int report) {
+	switch(report) {
+		case DW_REPORT_CREATE:
+			return (flags & DW_CREATE) != 0;
+		case DW_REPORT_DELETE:
+			return (flags & DW_DELETE) != 0;
+		case DW_REPORT_MODIFY:
+			return (flags & (DW_MODIFY | DW_ATTRIB)) != 0;
+		default:
+			return true;
+	}
+}
+
+static void watch_callback(int fd, void* data) {
 	char buff[BUFF_LEN];
 	int len = 0;
 	int i = 0;
 	int report = 0;
 	struct inotify_event* event;
 	DirWatchImpl* impl = (DirWatchImpl*)data;
-	DirEntryIter it, it_end;
-	it_end = impl->entries.end();
+	DirWatchEntry *entry, *next;
+	list<String> new_dirs, gone_dirs;
+	list<DirWatchEntry*> new_dirs_root, gone_dirs_root;
 
 again:
 	len = read(fd, buff, BUFF_LEN);
@@ -65,58 +477,135 @@ again:
 		return;
 	}
 
-	DirWatchCallback* cb = impl->callback;
-	if(!cb)
-		return;
+	impl->events.clear();
+	impl->names.clear();
+	memset(impl->coalesce, 0xff, sizeof(impl->coalesce));
+
+	/* entries can be removed while events are collected */
+	impl->dispatching = true;
 
 	while(i < len) {
 		event = (struct inotify_event*)&buff[i];
+		i += EVENT_SIZE + event->len;
+
+		if(!impl->table_size)
+			continue;
 
-		/* scan for directory descriptor */
-		for(it = impl->entries.begin(); it != it_end; ++it) {
-			if((*it)->dir_fd == event->wd) {
-				/*
-				 * When file is moved (but not deleted) in/out watched directory, inotify
-				 * will not emit IN_CREATE/IN_DELETE but IN_MOVED_TO/IN_MOVED_FROM instead.
-				 * To allow compatibility with Gamin backend we will see IN_MOVED_XXX events
-				 * as entry creating/deleting. The same applies for watch_callback() reports.
-				 */
-				if(event->mask & (IN_DELETE | IN_MOVED_FROM))
-					report = DW_REPORT_DELETE;
-				else if(event->mask & (IN_CREATE | IN_MOVED_TO))
-					report = DW_REPORT_CREATE;
-				else if(event->mask & IN_MODIFY)
-					report = DW_REPORT_MODIFY;
-				else if(event->mask & IN_ATTRIB)
-					report = DW_REPORT_MODIFY;
-				else {
-					/* unknown flag; should not happened; just continue */
+		/* directory was deleted or unmounted; kernel removed the watch */
+		if(event->mask & IN_IGNORED) {
+			for(entry = impl->wd_table[wd_bucket(impl, event->wd)]; entry; entry = next) {
+				next = entry->wd_next;
+				if(entry->dir_fd != event->wd)
 					continue;
-				}
 
-				/* call callback but do not quit since we can get continuous events */
-				cb((*it)->name.c_str(), event->name, report, impl->callback_data);
+				/* subdirectories are ours; entries added by user are kept until remove() */
+				if(entry->root)
+					entry_release(impl, entry);
+				else
+					entry_unlink_wd(impl, entry);
 			}
+
+			continue;
 		}
 
-		i += EVENT_SIZE + event->len;
+		/*
+		 * When file is moved (but not deleted) in/out watched directory, inotify
+		 * will not emit IN_CREATE/IN_DELETE but IN_MOVED_TO/IN_MOVED_FROM instead.
+		 * To allow compatibility with Gamin backend we will see IN_MOVED_XXX events
+		 * as entry creating/deleting. The same applies for watch_callback() reports.
+		 */
+		if(event->mask & (IN_DELETE | IN_MOVED_FROM))
+			report = DW_REPORT_DELETE;
+		else if(event->mask & (IN_CREATE | IN_MOVED_TO))
+			report = DW_REPORT_CREATE;
+		else if(event->mask & IN_MODIFY)
+			report = DW_REPORT_MODIFY;
+		else if(event->mask & IN_ATTRIB)
+			report = DW_REPORT_MODIFY;
+		else {
+			/* unknown flag (e.g. IN_Q_OVERFLOW); just continue */
+			continue;
+		}
+
+		/* the same directory can be added under different names, so check all of them */
+		for(entry = impl->wd_table[wd_bucket(impl, event->wd)]; entry; entry = entry->wd_next) {
+			if(entry->dir_fd != event->wd)
+				continue;
+
+			if((entry->flags & DW_RECURSIVE) && (event->mask & IN_ISDIR) && event->len) {
+				/* tables can't be changed while we are walking them; add it later */
+				String p = entry->name;
+				p += E_DIR_SEPARATOR_STR;
+				p += event->name;
+
+				if(report == DW_REPORT_CREATE) {
+					new_dirs.push_back(p);
+					new_dirs_root.push_back(entry->root ? entry->root : entry);
+				} else if(report == DW_REPORT_DELETE) {
+					gone_dirs.push_back(p);
+					gone_dirs_root.push_back(entry->root ? entry->root : entry);
+				}
+			}
+
+			if(report_wanted(entry->flags, report))
+				event_push(impl, entry, event->len ? event->name : NULL, report);
+		}
+
+		/*
+		 * Subdirectory moved out of the tree (or renamed) keeps its watches, and would be reported
+		 * under the old name; release it now, so IN_MOVED_TO adds it again under the new one.
+		 */
+		if(!gone_dirs.empty()) {
+			list<String>::iterator git = gone_dirs.begin(), gite = gone_dirs.end();
+			list<DirWatchEntry*>::iterator grit = gone_dirs_root.begin();
+
+			for(; git != gite; ++git, ++grit)
+				entry_forget_subtree(impl, *git, *grit);
+
+			gone_dirs.clear();
+			gone_dirs_root.clear();
+		}
+	}
+
+	list<String>::iterator it = new_dirs.begin(), ite = new_dirs.end();
+	list<DirWatchEntry*>::iterator rit = new_dirs_root.begin();
+
+	for(; it != ite; ++it, ++rit) {
+		if((entry = entry_add(impl, (*it).c_str(), (*rit)->flags, *rit)) != NULL)
+			entry_add_subdirs(impl, entry, *rit, true);
 	}
+
+	if(!impl->events.empty() && (impl->callback || impl->batch_callback))
+		events_dispatch(impl);
+
+	impl->dispatching = false;
+	dead_entries_free(impl);
 }
 
-DirWatch::DirWatch() : impl(NULL), backend_notifier(DW_INOTIFY) { 
+DirWatch::DirWatch() : impl(NULL), backend_notifier(DW_INOTIFY) {
 }
 
 DirWatch::~DirWatch() {
 	if(!impl)
 		return;
 
-	DirEntryIter it = impl->entries.begin(), it_end = impl->entries.end();
-	for(; it != it_end; ++it) {
-		inotify_rm_watch(impl->inotify_fd, (*it)->dir_fd);
-		delete *it;
+	if(impl->debounce_scheduled)
+		Fl::remove_timeout(debounce_cb, impl);
+
+	DirWatchEntry *e, *next;
+	for(unsigned int i = 0; i < impl->table_size; i++) {
+		for(e = impl->name_table[i]; e; e = next) {
+			next = e->name_next;
+			if(e->dir_fd >= 0)
+				inotify_rm_watch(impl->inotify_fd, e->dir_fd);
+			delete e;
+		}
 	}
 
-	impl->entries.clear();
+	delete [] impl->wd_table;
+	delete [] impl->name_table;
+
+	Fl::remove_fd(impl->inotify_fd);
 	close(impl->inotify_fd);
 	delete impl;
 }
@@ -125,12 +614,21 @@ bool DirWatch::init_backend(void) {
 	impl = new DirWatchImpl;
 	impl->callback = NULL;
 	impl->callback_data = NULL;
+	impl->batch_callback = NULL;
+	impl->batch_callback_data = NULL;
+	impl->wd_table = impl->name_table = NULL;
+	impl->table_size = impl->nentries = 0;
+	impl->dispatching = false;
+	impl->dead = NULL;
+	impl->debounce = 0;
+	impl->debounce_scheduled = false;
+	impl->pending = NULL;
 
 	impl->inotify_fd = inotify_init();
 	if(impl->inotify_fd < 0)
 		return false;
 
-	/* 
+	/*
 	 * Use FLTK descriptor watch code. In some time it would be nice
 	 * to replace it with local code so DirWatch code does not depends on FLTK
 	 */
@@ -143,32 +641,13 @@ bool DirWatch::add_entry(const char* dir, int flags) {
 	E_ASSERT(dir != NULL);
 	E_ASSERT(impl != NULL);
 
-	/* 
-	 * if entry already exists, just skip it since calling inotify code on the already
-	 * watched will reset flags
-	 */
-	DirEntryIter it = impl->entries.begin(), it_end = impl->entries.end();
-	for(; it != it_end; ++it) {
-		if((*it)->name == dir)
-			return true;
-	}
-
-	int inotify_flags = 0;
-	if(flags & DW_CREATE) inotify_flags |= IN_CREATE | IN_MOVED_TO;
-	if(flags & DW_DELETE) inotify_flags |= IN_DELETE | IN_MOVED_FROM;
-	if(flags & DW_MODIFY) inotify_flags |= IN_MODIFY;
-	if(flags & DW_ATTRIB) inotify_flags |= IN_ATTRIB;
-	/* ignore other flags */
-
-	int fd = inotify_add_watch(impl->inotify_fd, dir, inotify_flags);
-	if(fd < 0)
+	DirWatchEntry* e = entry_add(impl, dir, flags, NULL);
+	if(!e)
 		return false;
 
-	DirWatchEntry* new_entry = new DirWatchEntry;
-	new_entry->name = dir;
-	new_entry->dir_fd = fd;
+	if(flags & DW_RECURSIVE)
+		entry_add_subdirs(impl, e, e, false);
 
-	impl->entries.push_back(new_entry);
 	return true;
 }
 
@@ -176,22 +655,47 @@ bool DirWatch::remove_entry(const char* dir) {
 	E_ASSERT(dir != NULL);
 	E_ASSERT(impl != NULL);
 
-	if(impl->entries.empty())
+	DirWatchEntry* entry = entry_find(impl, dir, str_hash(dir));
+	if(!entry)
 		return false;
 
-	DirEntryIter it = impl->entries.begin(), it_end = impl->entries.end();
-	for(; it != it_end; ++it) {
-		if((*it)->name == dir) {
-			/* TODO: return value checks */
-			inotify_rm_watch(impl->inotify_fd, (*it)->dir_fd);
+	/* with recursive watch, remove subdirectories added by us too */
+	if(!entry->root && (entry->flags & DW_RECURSIVE)) {
+		DirWatchEntry *e, *next;
 
-			delete *it;
-			impl->entries.erase(it);
-			return true;
+		for(unsigned int i = 0; i < impl->table_size; i++) {
+			for(e = impl->name_table[i]; e; e = next) {
+				next = e->name_next;
+				if(e->root != entry)
+					continue;
+
+				entry_forget(impl, e);
+			}
 		}
 	}
 
-	return false;
+	entry_forget(impl, entry);
+	return true;
+}
+
+void DirWatch::set_debounce(double t) {
+	E_ASSERT(impl != NULL);
+
+	impl->debounce = (t > 0) ? t : 0;
+
+	/* deliver what was collected so far */
+	if(impl->debounce == 0 && impl->debounce_scheduled) {
+		Fl::remove_timeout(debounce_cb, impl);
+		debounce_cb(impl);
+	}
+}
+
+void DirWatch::add_batch_callback(DirWatchBatchCallback* cb, void* data) {
+	/* allow NULL callbacks */
+	E_ASSERT(impl != NULL);
+
+	impl->batch_callback = cb;
+	impl->batch_callback_data = data;
 }
 
 void DirWatch::add_callback(DirWatchCallback* cb, void* data) {
@@ -16,39 +16,75 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <ctype.h>
 #include <edelib/FontCache.h>
 #include <edelib/Directory.h>
 #include <edelib/StrUtil.h>
 #include <edelib/String.h>
-#include <edelib/List.h>
+#include <edelib/Vector.h>
 #include <edelib/Util.h>
 #include <edelib/Debug.h>
 #include <edelib/Missing.h>
 #include <FL/Fl.H>
 
-#include "sdbm/sdbm.h"
+#include "HashTable.h"
+
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 /* database version for possible future changes */
-#define FONT_CACHE_DB_SCHEMA_VERSION 1.0
+#define FONT_CACHE_MAGIC   "edelibfc"
+#define FONT_CACHE_VERSION 2
 
 /* maximum size for face size with size */
 #define FONT_CACHE_FACE_LEN_WITH_SIZE 68
 
-#define SDBM_SAFE_CLOSE(db) \
-	if(db) {                \
-		sdbm_close(db);     \
-		db = NULL;          \
-	}                       \
+/* FLTK font id is stored in hash table as pointer, and 0 is a valid id */
+#define FONT_ID_TO_PTR(id)  ((void*)(long)((id) + 1))
+#define FONT_ID_FROM_PTR(p) ((Fl_Font)((long)(p) - 1))
 
 EDELIB_NS_BEGIN
 
-typedef list<String*>           StrList;
-typedef list<String*>::iterator StrListIt;
+typedef vector<String*>           StrList;
+typedef vector<String*>::iterator StrListIt;
+
+/*
+ * Database is a single read-only file, mapped in memory. Numbers are in native byte order, as
+ * database is created on the same machine; wrong order will be seen as wrong version. Layout is:
+ *
+ *   FontCacheHeader
+ *   FontCacheIndex  - 'count' items, sorted by font name
+ *   FontInfo        - 'count' items, in the same order as index
+ *   names           - '\0' terminated font names
+ */
+struct FontCacheHeader {
+	char         magic[8];
+	unsigned int version;
+	unsigned int info_size;     /* sizeof(FontInfo), in case it was changed */
+	unsigned int count;
+	unsigned int index_offset;
+	unsigned int values_offset;
+	unsigned int names_offset;
+	unsigned int size;          /* whole file size */
+};
+
+struct FontCacheIndex {
+	unsigned int name_offset;   /* relative to names */
+	unsigned int name_len;
+};
 
 /* class to allow static storage of font names */
 class FontHolder {
@@ -73,22 +109,66 @@ public:
 	StrListIt end(void)   { return fonts.end(); }
 };
 
+/* result of find() for given name, so the same name is not parsed and fetched from database again */
+struct FontLookup {
+	char     *name;
+	FontInfo *info; /* NULL if not found */
+	int       size;
+	int       font; /* registered FLTK font or -1 */
+};
+
+typedef vector<FontLookup*>           FontLookupList;
+typedef vector<FontLookup*>::iterator FontLookupListIt;
+
 struct FontCache_P {
-	SDBM *db;
+	char *data;  /* database content */
+	long  size;
+	bool  mapped;
 	int   count;
+
+	const FontCacheIndex *index;
+	FontInfo             *values;
+	const char           *names;
+
+	StrHashTable   lookup_hash;
+	FontLookupList lookup_list;
+
+	FontCache_P() : data(NULL), size(0), mapped(false), count(-1), index(NULL), values(NULL), names(NULL) { }
+	~FontCache_P();
+
+	void close(void);
 };
 
-/* internal holder for registered name inside FLTK */
-static FontHolder static_font_names;
+void FontCache_P::close(void) {
+	if(!data) return;
 
-/* compare strings ignoring leading spaces */
-static int strscmp(const char *s1, const char *s2) {
-	while(isspace(*s1) && *s1) s1++;
-	while(isspace(*s2) && *s2) s2++;
+#ifdef HAVE_MMAP
+	if(mapped)
+		munmap(data, size);
+	else
+#endif
+		free(data);
 
-	return strcmp(s1, s2);
+	data = NULL;
+	count = -1;
 }
 
+FontCache_P::~FontCache_P() {
+	for(FontLookupListIt it = lookup_list.begin(), ite = lookup_list.end(); it != ite; ++it) {
+		free((*it)->name);
+		delete *it;
+	}
+
+	close();
+}
+
+/* internal holder for registered name inside FLTK */
+static FontHolder static_font_names;
+
+/* FLTK face name (without leading spaces) to FLTK font id, for built-in and registered fonts */
+static StrHashTable  font_ids;
+static bool          font_ids_builtin = false;
+
 static bool have_size(FontInfo *fi, int sz) {
 	for(int i = 0; i < fi->nsizes; i++) {
 		if(fi->sizes[i] == sz)
@@ -98,6 +178,49 @@ static bool have_size(FontInfo *fi, int sz) {
 	return false;
 }
 
+static const char *skip_spaces(const char *s) {
+	while(isspace(*s) && *s) s++;
+	return s;
+}
+
+static void font_id_add(const char *face, Fl_Font id) {
+	if(!face) return;
+	face = skip_spaces(face);
+
+	unsigned int len = strlen(face), hash = str_hash(face, len);
+
+	/* the first one wins, as with linear search */
+	if(!font_ids.find(face, len, hash))
+		font_ids.insert(face, len, hash, FONT_ID_TO_PTR(id));
+}
+
+/*
+ * Find FLTK font id for given face. FLTK allocates FL_FREE_FONT - 1 fonts with some default font
+ * names, so they are added first.
+ *
+ * FL_FREE_FONT is not increased when new fonts are registered via Fl::set_font().
+ *
+ * Leading spaces are ignored; FLTK for some fonts will leave leading space, e.g. ' sans', but will
+ * be 'Bsans' or 'Isans' for bold/italic variants.
+ */
+static bool font_id_find(const char *face, Fl_Font &id) {
+	if(!font_ids_builtin) {
+		for(int i = 0; i < FL_FREE_FONT; i++)
+			font_id_add(Fl::get_font((Fl_Font)i), (Fl_Font)i);
+		font_ids_builtin = true;
+	}
+
+	face = skip_spaces(face);
+
+	unsigned int len = strlen(face);
+	void *p = font_ids.find(face, len, str_hash(face, len));
+
+	if(!p) return false;
+
+	id = FONT_ID_FROM_PTR(p);
+	return true;
+}
+
 static bool parse_font(const char *font, char *ret, int &sz, int maxlen) {
 	int len = edelib_strnlen(font, maxlen);
 	E_RETURN_VAL_IF_FAIL(len > 0, false);
@@ -138,12 +261,85 @@ static bool parse_font(const char *font, char *ret, int &sz, int maxlen) {
 	return true;
 }
 
+static char *cache_read(int fd, long size, bool &mapped) {
+#ifdef HAVE_MMAP
+	/* private writable mapping, so callers modifying FontInfo will not crash or change the file */
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if(p != MAP_FAILED) {
+		mapped = true;
+		return (char*)p;
+	}
+#endif
+
+	char *buf = (char*)malloc(size);
+	E_RETURN_VAL_IF_FAIL(buf != NULL, NULL);
+
+	long n, got = 0;
+	while(got < size) {
+		n = read(fd, buf + got, size - got);
+		if(n == -1 && errno == EINTR) continue;
+		if(n <= 0) {
+			free(buf);
+			return NULL;
+		}
+
+		got += n;
+	}
+
+	mapped = false;
+	return buf;
+}
+
+/* check header and names, so lookups does not have to */
+static bool cache_valid(FontCache_P *priv) {
+	const FontCacheHeader *h = (const FontCacheHeader*)priv->data;
+
+	if(priv->size < (long)sizeof(FontCacheHeader) || memcmp(h->magic, FONT_CACHE_MAGIC, sizeof(h->magic)) != 0) {
+		E_WARNING(E_STRLOC ": Unrecognized database format\n");
+		return false;
+	}
+
+	if(h->version != FONT_CACHE_VERSION || h->info_size != sizeof(FontInfo)) {
+		E_WARNING(E_STRLOC ": Wrong database version\n");
+		return false;
+	}
+
+	unsigned long count = h->count;
+	if(h->size != (unsigned long)priv->size ||
+	   h->index_offset < sizeof(FontCacheHeader) ||
+	   h->index_offset + count * sizeof(FontCacheIndex) > h->values_offset ||
+	   h->values_offset % sizeof(int) != 0 ||
+	   h->values_offset + count * sizeof(FontInfo) > h->names_offset ||
+	   h->names_offset > h->size)
+	{
+		E_WARNING(E_STRLOC ": Damaged database\n");
+		return false;
+	}
+
+	const FontCacheIndex *index = (const FontCacheIndex*)(priv->data + h->index_offset);
+	const char           *names = priv->data + h->names_offset;
+	unsigned long         names_size = h->size - h->names_offset;
+
+	for(unsigned long i = 0; i < count; i++) {
+		if((unsigned long)index[i].name_offset + index[i].name_len >= names_size || names[index[i].name_offset + index[i].name_len] != '\0') {
+			E_WARNING(E_STRLOC ": Damaged database\n");
+			return false;
+		}
+	}
+
+	priv->count  = h->count;
+	priv->index  = index;
+	priv->values = (FontInfo*)(priv->data + h->values_offset);
+	priv->names  = names;
+	return true;
+}
+
 bool FontCache::load(const char *dir, const char *db, const char *prefix) {
 	E_RETURN_VAL_IF_FAIL(dir != NULL, false);
 	E_RETURN_VAL_IF_FAIL(db != NULL, false);
 
 	/* do not load already loaded */
-	if(priv && priv->db) return true;
+	if(priv && priv->data) return true;
 
 	String path = dir;
 	path.append(E_DIR_SEPARATOR_STR);
@@ -151,42 +347,29 @@ bool FontCache::load(const char *dir, const char *db, const char *prefix) {
 	path.append(E_DIR_SEPARATOR_STR).append(db);
 
 	/* create on demand */
-	if(!priv) {
-		priv = new FontCache_P;
-		priv->db = NULL;
-		priv->count = -1;
-	}
+	if(!priv) priv = new FontCache_P;
 
-	priv->db = sdbm_open((char*)path.c_str(), O_RDONLY, 0640);
-	if(!priv->db) return false;
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd == -1) return false;
 
-	/* see if we have valid database */
-	datum key, val;
-
-	key.dptr = (char*)"font-cache:version";
-	key.dsize = 18;
-	val = sdbm_fetch(priv->db, key);
-	if(!val.dptr) {
+	struct stat st;
+	if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(FontCacheHeader)) {
 		E_WARNING(E_STRLOC ": Unrecognized database format\n");
-		SDBM_SAFE_CLOSE(priv->db);
+		::close(fd);
 		return false;
 	}
 
-	double *ver = (double*)val.dptr;
-	if(*ver != FONT_CACHE_DB_SCHEMA_VERSION) {
-		E_WARNING(E_STRLOC ": Wrong database version\n");
-		SDBM_SAFE_CLOSE(priv->db);
+	priv->size = (long)st.st_size;
+	priv->data = cache_read(fd, priv->size, priv->mapped);
+	::close(fd);
+
+	if(!priv->data) return false;
+
+	if(!cache_valid(priv)) {
+		priv->close();
 		return false;
 	}
 
-	key.dptr = (char*)"font-cache:count";
-	key.dsize = 16;
-	val = sdbm_fetch(priv->db, key);
-	if(val.dptr)
-		priv->count = *(int*)val.dptr;
-	else
-		E_WARNING(E_STRLOC ": Unable to get number of fonts from database\n");
-
 	return true;
 }
 
@@ -198,170 +381,214 @@ bool FontCache::load(void) {
 void FontCache::clear(void) {
 	E_RETURN_IF_FAIL(priv != NULL);
 
-	SDBM_SAFE_CLOSE(priv->db);
 	delete priv;
 	priv = NULL;
 }
 
 int FontCache::count(void) const {
 	E_RETURN_VAL_IF_FAIL(priv != NULL, -1);
-	E_RETURN_VAL_IF_FAIL(priv->db != NULL, -1);
+	E_RETURN_VAL_IF_FAIL(priv->data != NULL, -1);
 
 	return priv->count;
 }
 
-FontInfo *FontCache::find(const char *n, int &size) {
-	E_RETURN_VAL_IF_FAIL(priv->db != NULL, NULL);
-	E_RETURN_VAL_IF_FAIL(n != NULL, NULL);
+/* binary search in database index; names are sorted as with strcmp() */
+static FontInfo *cache_fetch(FontCache_P *priv, const char *key, unsigned int len) {
+	int lo = 0, hi = priv->count - 1, mid, cmp;
+	const FontCacheIndex *ix;
+
+	while(lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		ix  = priv->index + mid;
+
+		cmp = memcmp(key, priv->names + ix->name_offset, len < ix->name_len ? len : ix->name_len);
+		if(cmp == 0)
+			cmp = (int)len - (int)ix->name_len;
+
+		if(cmp == 0)
+			return priv->values + mid;
+
+		if(cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+static FontLookup *font_lookup(FontCache_P *priv, const char *n) {
+	unsigned int len = strlen(n), hash = str_hash(n, len);
+
+	FontLookup *l = (FontLookup*)priv->lookup_hash.find(n, len, hash);
+	if(l) return l;
+
+	l = new FontLookup;
+	l->name = strdup(n);
+	l->info = NULL;
+	l->size = 0;
+	l->font = -1;
+
+	/* not found names are remembered too */
+	priv->lookup_hash.insert(l->name, len, hash, l);
+	priv->lookup_list.push_back(l);
 
 	char face[EDELIB_FONT_CACHE_FACE_LEN];
 	int  facesz;
 	
 	if(!parse_font(n, face, facesz, FONT_CACHE_FACE_LEN_WITH_SIZE)) {
 		E_WARNING(E_STRLOC ": Unable to parse '%s' as valid font name\n", n);
-		return NULL;
+		return l;
 	}
 
 	/* ignore case for font name */
 	str_tolower((unsigned char*)face);
 
 	/* find face/size combination */
-	datum key, val;
+	l->info = cache_fetch(priv, face, edelib_strnlen(face, EDELIB_FONT_CACHE_FACE_LEN));
+	l->size = facesz;
+	return l;
+}
 
-	key.dptr = (char*)face;
-	/* size is without terminating character */
-	key.dsize = edelib_strnlen(face, EDELIB_FONT_CACHE_FACE_LEN);
+FontInfo *FontCache::find(const char *n, int &size) {
+	E_RETURN_VAL_IF_FAIL(priv->data != NULL, NULL);
+	E_RETURN_VAL_IF_FAIL(n != NULL, NULL);
 
-	val = sdbm_fetch(priv->db, key);
-	if(val.dptr == NULL) return NULL;
+	FontLookup *l = font_lookup(priv, n);
+	if(!l->info) return NULL;
 
-	size = facesz;
-	return (FontInfo*)val.dptr;
+	size = l->size;
+	return l->info;
 }
 
 bool FontCache::find(const char *n, Fl_Font &font, int &font_size) {
-	int facesz = 0;
-	FontInfo *fi = find(n, facesz);
+	E_RETURN_VAL_IF_FAIL(priv->data != NULL, false);
+	E_RETURN_VAL_IF_FAIL(n != NULL, false);
 
-	E_RETURN_VAL_IF_FAIL(fi != NULL, false);
+	FontLookup *l = font_lookup(priv, n);
+	E_RETURN_VAL_IF_FAIL(l->info != NULL, false);
 
-	if(!have_size(fi, facesz)) {
-		E_WARNING(E_STRLOC ": font size '%i' not found\n", facesz);
-		return false;
-	} 
-
-	/*
-	 * First check if if FLTK already has this font; to find that out, FLTK
-	 * allocates FL_FREE_FONT - 1 fonts with some default font names so we check
-	 * there first.
-	 *
-	 * FL_FREE_FONT is not increased when new fonts are registered via Fl::set_font().
-	 *
-	 * Also note usage of 'strscmp'; FLTK for some fonts will leave leading space, e.g.
-	 * ' sans', but will be 'Bsans' or 'Isans' for bold/italic variants.
-	 */
-	for(int i = 0; i < FL_FREE_FONT; i++) {
-		if(strscmp(fi->face, Fl::get_font((Fl_Font)i)) == 0) {
-			font = (Fl_Font)i;
-			font_size = facesz;
-
-			E_DEBUG(E_STRLOC ": FLTK already has '%s' registered as '%i'\n", fi->face, font);
-			return true;
-		}
+	/* already resolved */
+	if(l->font >= 0) {
+		font = (Fl_Font)l->font;
+		font_size = l->size;
+		return true;
 	}
 
-	/* now try to see if it exists in our static storage */
-	StrListIt it = static_font_names.begin(), ite = static_font_names.end();
-	for(int i = FL_FREE_FONT; it != ite; ++it, i++) {
-		E_DEBUG("'%s' == '%s'\n", fi->face, (*it)->c_str());
+	FontInfo *fi = l->info;
 
-		if(strscmp(fi->face, (*it)->c_str()) == 0) {
-			font = (Fl_Font)i;
-			font_size = facesz;
+	if(!have_size(fi, l->size)) {
+		E_WARNING(E_STRLOC ": font size '%i' not found\n", l->size);
+		return false;
+	} 
 
-			E_DEBUG(E_STRLOC ": font '%s' found as '%i'\n", fi->face, font);
-			return true;
-		}
-	}
+	/* first check if FLTK already has this font or we registered it */
+	if(font_id_find(fi->face, font)) {
+		E_DEBUG(E_STRLOC ": FLTK already has '%s' registered as '%i'\n", fi->face, font);
+	} else {
+		const char *sf = static_font_names.append(fi->face);
+		font = (Fl_Font)(FL_FREE_FONT + static_font_names.size() - 1);
 
-	
-	const char *sf = static_font_names.append(fi->face);
-	font = (Fl_Font)(FL_FREE_FONT + static_font_names.size() - 1);
-	font_size = facesz;
+		E_DEBUG(E_STRLOC ": registering '%s' as '%i'\n", sf, font);
 
-	E_DEBUG(E_STRLOC ": registering '%s' as '%i'\n", sf, font);
+		/* register it under this index */
+		Fl::set_font(font, sf);
+		font_id_add(sf, font);
+	}
 
-	/* register it under this index */
-	Fl::set_font(font, sf);
+	l->font = font;
+	font_size = l->size;
 	return true;
 }
 
 void FontCache::for_each_font(void (*func) (const char *, FontInfo *, void *), void *data) {
-	E_RETURN_IF_FAIL(priv->db != NULL);
+	E_RETURN_IF_FAIL(priv->data != NULL);
 	E_RETURN_IF_FAIL(func != NULL);
 
-	datum    key, val;
-	FontInfo *fi;
-	char     n[EDELIB_FONT_CACHE_FACE_LEN];
-	int      len;
-
-	for(key = sdbm_firstkey(priv->db); key.dptr != NULL; key = sdbm_nextkey(priv->db)) {
-		val = sdbm_fetch(priv->db, key);
-		if(E_UNLIKELY(!val.dptr)) {
-			E_WARNING(E_STRLOC ": got nonexisting value\n");
-			continue;
-		}
-
-		fi  = (FontInfo*)val.dptr;
-		len = (key.dsize < EDELIB_FONT_CACHE_FACE_LEN) ? key.dsize + 1 : EDELIB_FONT_CACHE_FACE_LEN;
-		edelib_strlcpy(n, (char*)key.dptr, len);
-
-		/* skip information keys */
-		if(strncmp(n, "font-cache:", 11) == 0) continue;
-
-		func((const char*)n, fi, data);
-	}
+	for(int i = 0; i < priv->count; i++)
+		func(priv->names + priv->index[i].name_offset, priv->values + i, data);
 }
 
-static void font_it_cb(const char *f, FontInfo *fi, void *data) {
-	StrList *slist = (StrList*)data;
-	String *str = new String(f);
-	slist->push_back(str);
+void FontCache::for_each_font_sorted(void (*func) (const char *, FontInfo *, void *), void *data) {
+	/* database is already sorted */
+	for_each_font(func, data);
 }
 
-/* TODO: bug in edelib */
-static bool sort_func(String* const &s1, String* const &s2) {
-	return *s1 < *s2;
-}
+/* font collected by init_db() */
+struct FontCacheEntry {
+	char         name[EDELIB_FONT_CACHE_FACE_LEN];
+	unsigned int order;
+	FontInfo     info;
+};
 
-void FontCache::for_each_font_sorted(void (*func) (const char *, FontInfo *, void *), void *data) {
-	E_RETURN_IF_FAIL(priv->db != NULL);
-	E_RETURN_IF_FAIL(func != NULL);
+typedef vector<FontCacheEntry*>           FontCacheEntryList;
+typedef vector<FontCacheEntry*>::iterator FontCacheEntryListIt;
 
-	datum   key, val;
-	StrList slist;
-	String  *sp;
+static bool entry_cmp(FontCacheEntry* const &e1, FontCacheEntry* const &e2) {
+	int ret = strcmp(e1->name, e2->name);
+	return ret ? (ret < 0) : (e1->order < e2->order);
+}
 
-	for_each_font(font_it_cb, (void*)&slist);
-	slist.sort(sort_func);
+static bool cache_write(const char *path, FontCacheEntryList &fonts) {
+	FontCacheHeader h;
+	unsigned int    i, n = fonts.size(), names_size = 0;
+
+	for(i = 0; i < n; i++)
+		names_size += strlen(fonts[i]->name) + 1;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FONT_CACHE_MAGIC, sizeof(h.magic));
+	h.version       = FONT_CACHE_VERSION;
+	h.info_size     = sizeof(FontInfo);
+	h.count         = n;
+	h.index_offset  = sizeof(h);
+	h.values_offset = h.index_offset + n * sizeof(FontCacheIndex);
+	h.names_offset  = h.values_offset + n * sizeof(FontInfo);
+	h.size          = h.names_offset + names_size;
+
+	char *buf = (char*)calloc(1, h.size);
+	E_RETURN_VAL_IF_FAIL(buf != NULL, false);
+
+	memcpy(buf, &h, sizeof(h));
+
+	FontCacheIndex *index  = (FontCacheIndex*)(buf + h.index_offset);
+	FontInfo       *values = (FontInfo*)(buf + h.values_offset);
+	char           *names  = buf + h.names_offset;
+	unsigned int    pos = 0, len;
+
+	for(i = 0; i < n; i++) {
+		len = strlen(fonts[i]->name);
+
+		index[i].name_offset = pos;
+		index[i].name_len = len;
+		memcpy(names + pos, fonts[i]->name, len + 1);
+		memcpy(values + i, &fonts[i]->info, sizeof(FontInfo));
+		pos += len + 1;
+	}
 
-	StrListIt it = slist.begin(), ite = slist.end();
-	for(; it != ite; ++it) {
-		sp = *it;
+	/* 
+	 * write to temporary file and rename it, so applications having old database mapped in memory
+	 * are not affected
+	 */
+	String tmp = path;
+	tmp.append(".tmp");
 
-		key.dptr  = (char*)sp->c_str();
-		key.dsize = sp->length();
+	bool  ret = false;
+	FILE *f = fopen(tmp.c_str(), "wb");
 
-		val = sdbm_fetch(priv->db, key);
-		if(E_UNLIKELY(!val.dptr)) {
-			E_WARNING(E_STRLOC ": Got nonexisting value\n");
-			continue;
-		}
+	if(f) {
+		ret = (fwrite(buf, h.size, 1, f) == 1);
+		ret = (fclose(f) == 0) && ret;
+		ret = ret && (rename(tmp.c_str(), path) == 0);
 
-		func(sp->c_str(), (FontInfo*)val.dptr, data);
-		/* we are not using it any more */
-		delete *it;
+		if(!ret) {
+			E_WARNING(E_STRLOC ": Unable to write '%s'\n", path);
+			unlink(tmp.c_str());
+		}
 	}
+
+	free(buf);
+	return ret;
 }
 
 int FontCache::init_db(const char *dir, const char *db, const char *prefix) {
@@ -377,15 +604,10 @@ int FontCache::init_db(const char *dir, const char *db, const char *prefix) {
 
 	path.append(E_DIR_SEPARATOR_STR).append(db);
 
-	/* open database first */
-	SDBM *fdb = sdbm_open((char*)path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0640);
-	E_RETURN_VAL_IF_FAIL(fdb != NULL, -1);
-
-	const char *n, *f;
-	char       name[EDELIB_FONT_CACHE_FACE_LEN];
-	int        count, type, nsizes, *sizes, nfonts = 0;
-	datum      key, val;
-	FontInfo   fi;
+	const char         *n, *f;
+	int                count, type, nsizes, *sizes;
+	FontCacheEntry     *e;
+	FontCacheEntryList fonts;
 
 	/* now register all fonts */
 	count = Fl::set_fonts("-*");
@@ -398,11 +620,17 @@ int FontCache::init_db(const char *dir, const char *db, const char *prefix) {
 		nsizes = Fl::get_font_sizes((Fl_Font)i, sizes);
 		if(!nsizes) continue;
 
-		edelib_strlcpy(name, n, EDELIB_FONT_CACHE_FACE_LEN);
+		e = new FontCacheEntry;
+		memset(e, 0, sizeof(FontCacheEntry));
+		e->order = i;
+
+		FontInfo &fi = e->info;
+
+		edelib_strlcpy(e->name, n, EDELIB_FONT_CACHE_FACE_LEN);
 		edelib_strlcpy(fi.face, f, EDELIB_FONT_CACHE_FACE_LEN);
 
 		/* ignore case for font name */
-		str_tolower((unsigned char*)name);
+		str_tolower((unsigned char*)e->name);
 
 		/* get sizes */
 		if(sizes[0] == 0) {
@@ -411,41 +639,32 @@ int FontCache::init_db(const char *dir, const char *db, const char *prefix) {
 			for(int j = 0; j < fi.nsizes; j++)
 				fi.sizes[j] = j + 1;
 		} else {
-			fi.nsizes = nsizes;
+			fi.nsizes = nsizes > 64 ? 64 : nsizes;
 			for(int j = 0; j < fi.nsizes; j++)
 				fi.sizes[j] = sizes[j];
 		}
 
 		fi.type = type;
+		fonts.push_back(e);
+	}
 
-		key.dptr = name;
-		key.dsize = edelib_strnlen(name, EDELIB_FONT_CACHE_FACE_LEN);
+	fonts.sort(entry_cmp);
 
-		val.dptr = (char*)&fi;
-		val.dsize = sizeof(fi);
+	/* the same name can be given more than once; the last one is kept, as it was replacing database record */
+	FontCacheEntryList unique;
+	unique.reserve(fonts.size());
 
-		sdbm_store(fdb, key, val, SDBM_REPLACE);
-		nfonts++;
+	for(unsigned int i = 0; i < fonts.size(); i++) {
+		if(i + 1 < fonts.size() && strcmp(fonts[i]->name, fonts[i + 1]->name) == 0)
+			continue;
+		unique.push_back(fonts[i]);
 	}
 
-	/* store number of records in 'count' key */
-	key.dptr = (char*)"font-cache:count";
-	key.dsize = 16;
-
-	val.dptr = (char*)&nfonts;
-	val.dsize = sizeof(int);
-	sdbm_store(fdb, key, val, SDBM_REPLACE);
-	
-	/* store version */
-	key.dptr = (char*)"font-cache:version";
-	key.dsize = 18;
+	int nfonts = cache_write(path.c_str(), unique) ? (int)unique.size() : -1;
 
-	double version = FONT_CACHE_DB_SCHEMA_VERSION;
-	val.dptr = (char*)&version;
-	val.dsize = sizeof(double);
-	sdbm_store(fdb, key, val, SDBM_REPLACE);
+	for(FontCacheEntryListIt it = fonts.begin(), ite = fonts.end(); it != ite; ++it)
+		delete *it;
 
-	sdbm_close(fdb);
 	return nfonts;
 }
 
@@ -0,0 +1,172 @@
+/*
+ * Internal hash table and LRU list
+ * Copyright (c) 2005-2014 edelib authors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __EDELIB_HASHTABLE_H__
+#define __EDELIB_HASHTABLE_H__
+
+/* not installed; shared by Config, FontCache, MimeType and Regex */
+
+#include <string.h>
+#include <edelib/Debug.h>
+
+EDELIB_NS_BEGIN
+
+struct StrHashSlot {
+	unsigned int hash;
+	unsigned int keylen;
+	const char*  key;
+	void*        data;
+};
+
+/*
+ * Open addressing (linear probing) table mapping string keys to non-NULL pointers. Keys are not
+ * copied and must live as long as they are in the table; hash is computed by caller (str_hash()).
+ */
+class StrHashTable {
+private:
+	StrHashSlot* slots;
+	unsigned int nslots;
+	unsigned int nused;
+
+	StrHashTable(const StrHashTable&);
+	StrHashTable& operator=(StrHashTable&);
+
+	void grow(void) {
+		StrHashSlot* old = slots;
+		unsigned int oldsz = nslots;
+
+		nslots = nslots ? nslots * 2 : 8;
+		slots = new StrHashSlot[nslots];
+		memset(slots, 0, sizeof(StrHashSlot) * nslots);
+		nused = 0;
+
+		for(unsigned int i = 0; i < oldsz; i++) {
+			if(old[i].data)
+				insert(old[i].key, old[i].keylen, old[i].hash, old[i].data);
+		}
+
+		delete [] old;
+	}
+
+	bool slot_match(unsigned int i, const char* key, unsigned int keylen, unsigned int hash) const {
+		return slots[i].hash == hash && slots[i].keylen == keylen && memcmp(slots[i].key, key, keylen) == 0;
+	}
+public:
+	StrHashTable() : slots(NULL), nslots(0), nused(0) { }
+	~StrHashTable() { clear(); }
+
+	void clear(void) {
+		delete [] slots;
+		slots = NULL;
+		nslots = nused = 0;
+	}
+
+	void insert(const char* key, unsigned int keylen, unsigned int hash, void* data) {
+		E_ASSERT(data != NULL);
+
+		/* keep load factor below 3/4 */
+		if((nused + 1) * 4 > nslots * 3)
+			grow();
+
+		unsigned int i = hash & (nslots - 1);
+		while(slots[i].data)
+			i = (i + 1) & (nslots - 1);
+
+		slots[i].hash   = hash;
+		slots[i].keylen = keylen;
+		slots[i].key    = key;
+		slots[i].data   = data;
+		nused++;
+	}
+
+	void* find(const char* key, unsigned int keylen, unsigned int hash) const {
+		if(!nused) return NULL;
+
+		for(unsigned int i = hash & (nslots - 1); slots[i].data; i = (i + 1) & (nslots - 1)) {
+			if(slot_match(i, key, keylen, hash))
+				return slots[i].data;
+		}
+
+		return NULL;
+	}
+
+	void remove(const char* key, unsigned int keylen, unsigned int hash) {
+		if(!nused) return;
+
+		unsigned int mask = nslots - 1, i, j, k;
+
+		for(i = hash & mask; slots[i].data; i = (i + 1) & mask) {
+			if(slot_match(i, key, keylen, hash))
+				break;
+		}
+
+		if(!slots[i].data) return;
+
+		/* shift back following items from the same cluster, so probing sequences are not broken */
+		for(j = (i + 1) & mask; slots[j].data; j = (j + 1) & mask) {
+			k = slots[j].hash & mask;
+
+			/* move item only if its home slot is not between the hole and its current position */
+			if((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+				slots[i] = slots[j];
+				i = j;
+			}
+		}
+
+		slots[i].data = NULL;
+		nused--;
+	}
+};
+
+/*
+ * Intrusive list in the most recently used order; T must have 'prev' and 'next' members. It has no
+ * constructor, so it can be a static object, zero initialized before any code runs.
+ */
+template <typename T>
+struct LruList {
+	T* head;
+	T* tail;
+
+	void unlink(T* e) {
+		if(e->prev) e->prev->next = e->next;
+		else        head = e->next;
+
+		if(e->next) e->next->prev = e->prev;
+		else        tail = e->prev;
+	}
+
+	void push_front(T* e) {
+		e->prev = NULL;
+		e->next = head;
+
+		if(head) head->prev = e;
+		else     tail = e;
+
+		head = e;
+	}
+
+	/* mark as most recently used */
+	void touch(T* e) {
+		if(e == head) return;
+		unlink(e);
+		push_front(e);
+	}
+};
+
+EDELIB_NS_END
+#endif
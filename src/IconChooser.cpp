@@ -128,21 +128,25 @@ void IconBox::select_only_me(void) {
 
 void IconBox::set_icon_name_and_path(const String& s) {
 	char *ptr;
-	int W = 0, H = 0, len;
+	const char *base;
+	int W = 0, H = 0, len = 64;
 
 	icon_path.assign(s);
 
-	/* get basename without extension */
-	ptr = (char*)strrchr(s.c_str(), E_DIR_SEPARATOR);
-	if(ptr && *ptr++) {
-		char *e = strrchr(ptr, '.');
-		if(e) *e = '\0';
+	/*
+	 * get basename without extension; string buffer can be shared with other
+	 * String objects, so extension is cut by length instead of writing to it
+	 */
+	base = strrchr(s.c_str(), E_DIR_SEPARATOR);
+	if(base && *base++) {
+		const char *e = strrchr(base, '.');
+		if(e && (e - base) < len) len = e - base;
 	} else {
-		ptr = (char*)_("(unknown)");
+		base = _("(unknown)");
 	}
 
 	/* keep max icon name 64 bytes */
-	icon_name = edelib_strndup(ptr, 64);
+	icon_name = edelib_strndup(base, len);
 	len = edelib_strnlen(icon_name, 64);
 
 	fl_measure(icon_name, W, H);
@@ -362,17 +366,22 @@ String icon_chooser(IconSizes sz, IconContext ctx, bool always_full_path, bool *
 	String &ret = ic.get_ret();
 
 	if(!always_full_path && !ic.is_browsed_icon() && ret.length() > 0) {
-		char *p, *e;
-		p = (char*)strrchr(ret.c_str(), E_DIR_SEPARATOR);
+		const char *p, *e;
+		String name;
+
+		p = strrchr(ret.c_str(), E_DIR_SEPARATOR);
 
 		if(!p || !(*p++))
-			p = (char*)ret.c_str();
+			p = ret.c_str();
 
-		/* now remove extension */
-		e = (char*)strrchr((const char*)p, '.');
-		if(e) *e = '\0';
+		/* now remove extension; 'ret' is not modified since its buffer can be shared */
+		e = strrchr(p, '.');
+		if(e)
+			name.assign(p, e - p);
+		else
+			name.assign(p);
 
-		return String(p);
+		return name;
 	}
 
 	return ret;
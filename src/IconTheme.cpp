@@ -16,7 +16,15 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <dirent.h>
+
 #include <edelib/IconTheme.h>
 #include <edelib/Config.h>
 #include <edelib/Util.h>
@@ -24,6 +32,7 @@
 #include <edelib/Directory.h>
 #include <edelib/FileTest.h>
 #include <edelib/Missing.h>
+#include <edelib/Vector.h>
 
 EDELIB_NS_BEGIN
 
@@ -43,23 +52,185 @@ struct IconDirInfo {
 	IconContext context;
 };
 
-typedef list<String>                StrList;
-typedef list<String>::iterator      StrListIter;
+typedef list<String>                  StrList;
+typedef list<String>::iterator        StrListIter;
+
+typedef vector<IconDirInfo>           DirList;
+typedef vector<IconDirInfo>::iterator DirListIter;
+
+/*
+ * One node for each icon file found inside theme directories. Name is stored without extension
+ * and is allocated together with the node. 'dir' is index in IconIndex::dirs, and if is equal or
+ * greater than IconIndex::ndirs, it points to the base directory (IconIndex::bases).
+ */
+struct IconIndexNode {
+	unsigned int   hash;
+	unsigned int   dir;
+	unsigned int   ext;
+	IconIndexNode* next;
+	char           name[1];
+};
+
+struct IconIndex {
+	IconIndexNode** buckets;
+	unsigned int    nbuckets;
+
+	IconDirInfo**   dirs;
+	unsigned int    ndirs;
 
-typedef list<IconDirInfo>           DirList;
-typedef list<IconDirInfo>::iterator DirListIter;
+	String**        bases;
+	unsigned int    nbases;
+};
 
 struct IconThemePrivate {
-	bool    fallback_visited;
-	bool    info_loaded;
-	String  curr_theme;
-	String  curr_theme_stylized;
-	String  curr_theme_descr;
-	String  curr_theme_example;
-	StrList theme_dirs;
-	DirList dirlist;
+	bool      fallback_visited;
+	bool      info_loaded;
+	String    curr_theme;
+	String    curr_theme_stylized;
+	String    curr_theme_descr;
+	String    curr_theme_example;
+	StrList   theme_dirs;
+	DirList   dirlist;
+	IconIndex *index;
+
+	IconThemePrivate() : fallback_visited(false), info_loaded(false), index(NULL) { }
+	~IconThemePrivate();
 };
 
+static void icon_index_free(IconIndex *idx) {
+	IconIndexNode *n, *next;
+
+	for(unsigned int i = 0; i < idx->nbuckets; i++) {
+		for(n = idx->buckets[i]; n; n = next) {
+			next = n->next;
+			free(n);
+		}
+	}
+
+	delete [] idx->buckets;
+	delete [] idx->dirs;
+	delete [] idx->bases;
+	delete idx;
+}
+
+IconThemePrivate::~IconThemePrivate() {
+	if(index) icon_index_free(index);
+}
+
+/* returns extension index from icon_extensions[] or -1 if name does not end with any of them */
+static int icon_extension_index(const char *name, unsigned int len) {
+	unsigned int elen;
+
+	for(int i = 0; icon_extensions[i]; i++) {
+		elen = strlen(icon_extensions[i]);
+		if(len > elen && strcmp(name + len - elen, icon_extensions[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static bool icon_is_regular(const char *dir, const char *name, String &full) {
+	full = dir;
+	if(!str_ends(full.c_str(), E_DIR_SEPARATOR_STR))
+		full += E_DIR_SEPARATOR_STR;
+	full += name;
+
+	return file_test(full.c_str(), FILE_TEST_IS_REGULAR);
+}
+
+/* read content of 'path' and put every found icon in 'head' list */
+static unsigned int icon_index_scan(const char *path, unsigned int dir, IconIndexNode **head) {
+	DIR *dirp = opendir(path);
+	if(!dirp) return 0;
+
+	IconIndexNode *n;
+	unsigned int   len, count = 0;
+	int            ext;
+	String         full;
+
+	for(dirent *dp = readdir(dirp); dp != NULL; dp = readdir(dirp)) {
+		len = strlen(dp->d_name);
+		ext = icon_extension_index(dp->d_name, len);
+		if(ext < 0) continue;
+
+#ifdef HAVE_D_TYPE
+		if(dp->d_type != DT_REG && dp->d_type != DT_LNK && dp->d_type != DT_UNKNOWN)
+			continue;
+
+		/* only symlinks and unknown entries requires stat() call */
+		if(dp->d_type != DT_REG && !icon_is_regular(path, dp->d_name, full))
+			continue;
+#else
+		if(!icon_is_regular(path, dp->d_name, full))
+			continue;
+#endif
+
+		len -= strlen(icon_extensions[ext]);
+
+		n = (IconIndexNode*)malloc(sizeof(IconIndexNode) + len);
+		if(!n) break;
+
+		memcpy(n->name, dp->d_name, len);
+		n->name[len] = '\0';
+		n->hash = str_hash(n->name, len);
+		n->dir  = dir;
+		n->ext  = (unsigned int)ext;
+		n->next = *head;
+		*head = n;
+		count++;
+	}
+
+	closedir(dirp);
+	return count;
+}
+
+/*
+ * Scan all theme directories once and record every found icon in hash table, so find_icon()
+ * does not have to stat() each possible location.
+ */
+static IconIndex *icon_index_build(DirList &dirlist, StrList &theme_dirs) {
+	IconIndex *idx = new IconIndex;
+	IconIndexNode *head = NULL, *next;
+	unsigned int i, count = 0;
+
+	idx->ndirs = dirlist.size();
+	idx->dirs = new IconDirInfo*[idx->ndirs + 1];
+
+	idx->nbases = theme_dirs.size();
+	idx->bases = new String*[idx->nbases + 1];
+
+	i = 0;
+	for(DirListIter it = dirlist.begin(), ite = dirlist.end(); it != ite; ++it, i++) {
+		idx->dirs[i] = &(*it);
+		count += icon_index_scan((*it).path.c_str(), i, &head);
+	}
+
+	i = 0;
+	for(StrListIter it = theme_dirs.begin(), ite = theme_dirs.end(); it != ite; ++it, i++) {
+		idx->bases[i] = &(*it);
+		count += icon_index_scan((*it).c_str(), idx->ndirs + i, &head);
+	}
+
+	/* keep load factor below 1; bucket count is power of 2 so we can mask the hash */
+	for(idx->nbuckets = 64; idx->nbuckets < count; idx->nbuckets <<= 1)
+		;
+
+	idx->buckets = new IconIndexNode*[idx->nbuckets];
+	for(i = 0; i < idx->nbuckets; i++)
+		idx->buckets[i] = NULL;
+
+	for(; head; head = next) {
+		next = head->next;
+		i = head->hash & (idx->nbuckets - 1);
+
+		head->next = idx->buckets[i];
+		idx->buckets[i] = head;
+	}
+
+	return idx;
+}
+
 static void list_append(StrList& from, StrList& to) {
 	StrListIter it = from.begin(), ite = from.end();
 
@@ -285,8 +456,6 @@ void IconTheme::load(const char* name) {
 		clear();
 
 	priv = new IconThemePrivate;
-	priv->fallback_visited = false;
-	priv->info_loaded = false;
 	priv->curr_theme = name;
 
 	init_base_dirs(priv->theme_dirs);
@@ -304,95 +473,71 @@ String IconTheme::find_icon(const char* icon, IconSizes sz, IconContext ctx) {
 	E_ASSERT(priv != NULL && "Did you call load() before this function?");
 	E_RETURN_VAL_IF_FAIL(priv->dirlist.size() > 0, "");
 
-	String ret; ret.reserve(64);
-	bool has_extension = false;
+	if(!priv->index)
+		priv->index = icon_index_build(priv->dirlist, priv->theme_dirs);
 
-	/* handle the case when icon has extension */
-	for(int i = 0; icon_extensions[i]; i++) {
-		if(str_ends(icon, icon_extensions[i])) {
-			has_extension = true;
-			break;
-		}
-	}
+	unsigned int len = strlen(icon);
 
-	/* check if icon has extension; this is error, but check that anyway */
-	DirListIter it = priv->dirlist.begin(), ite = priv->dirlist.end();
+	/* handle the case when icon has extension; this is error, but check that anyway */
+	int want_ext = icon_extension_index(icon, len);
+	if(want_ext >= 0)
+		len -= strlen(icon_extensions[want_ext]);
 
-	/* ICON_CONTEXT_ANY means context is ignored, but also means slower lookup since all entries are searched */
-	for(; it != ite; ++it) {
-		if((*it).size == sz && ((*it).context == ctx || ctx == ICON_CONTEXT_ANY)) {
-			if(has_extension) {
-				ret = (*it).path;
-				ret += E_DIR_SEPARATOR_STR;
-				ret += icon;
-
-				if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-					return ret;
-			} else {
-				for(int i = 0; icon_extensions[i]; i++) {
-					ret = (*it).path;
-					ret += E_DIR_SEPARATOR_STR;
-					ret += icon;
-					ret += icon_extensions[i];
-
-					/* only check if exists; not too good, but we do not handle file opennings */
-					if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-						return ret;
-				}
-			}
-		}
-	}
+	IconIndex     *idx = priv->index;
+	IconIndexNode *n, *found = NULL;
+	unsigned int   hh = str_hash(icon, len), pass, found_pass = 0;
+
+	/*
+	 * Lookup order is the same as when directories were probed one by one:
+	 *  0. theme directories with matching size and context (ICON_CONTEXT_ANY ignores the context)
+	 *  1. base directories
+	 *  2. theme directories, ignoring the size and context
+	 * In each pass, the directory order has precedence over the extension order.
+	 */
+	for(n = idx->buckets[hh & (idx->nbuckets - 1)]; n; n = n->next) {
+		if(n->hash != hh || strncmp(n->name, icon, len) != 0 || n->name[len] != '\0')
+			continue;
 
-	/* the icon wasn't found in theme; search it in folders */
-	StrListIter si = priv->theme_dirs.begin(), se = priv->theme_dirs.end();
-	for(; si != se; ++si) {
-		if(has_extension) {
-			ret = *si;
-			/* added dirs already have E_DIR_SEPARATOR_STR added */
-			ret += icon;
+		if(want_ext >= 0 && n->ext != (unsigned int)want_ext)
+			continue;
 
-			if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-				return ret;
+		if(n->dir >= idx->ndirs) {
+			pass = 1;
+		} else if(idx->dirs[n->dir]->size == sz && (idx->dirs[n->dir]->context == ctx || ctx == ICON_CONTEXT_ANY)) {
+			pass = 0;
 		} else {
-			for(int i = 0; icon_extensions[i]; i++) {
-				ret = *si;
-				ret += icon;
-				ret += icon_extensions[i];
-
-				/* only check if exists; not too good, but we do not handle file opennings */
-				if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-					return ret;
-			}
+#ifdef ICON_THEME_FAST
+			/* third chance, search ignoring the size and context, is disabled to speed up things */
+			continue;
+#endif
+			pass = 2;
 		}
-	}
 
-#ifndef ICON_THEME_FAST
-	/* Third chance, search through icon theme, ignoring the size and context. Can be disabled to speed up things. */
-	for(it = priv->dirlist.begin(); it != ite; ++it) {
-		if(has_extension) {
-			ret = (*it).path;
-			ret += E_DIR_SEPARATOR_STR;
-			ret += icon;
-
-			if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-				return ret;
-		} else {
-			for(int i = 0; icon_extensions[i]; i++) {
-				ret = (*it).path;
-				ret += E_DIR_SEPARATOR_STR;
-				ret += icon;
-				ret += icon_extensions[i];
-
-				/* only check if exists; not too good, but we do not handle file opennings */
-				if(file_test(ret.c_str(), FILE_TEST_IS_REGULAR))
-					return ret;
-			}
+		if(!found ||
+		   pass < found_pass ||
+		   (pass == found_pass && (n->dir < found->dir || (n->dir == found->dir && n->ext < found->ext))))
+		{
+			found = n;
+			found_pass = pass;
 		}
 	}
-#endif
 
 	/* nothing found */
-	return "";
+	if(!found) return "";
+
+	String ret; ret.reserve(64);
+
+	if(found->dir >= idx->ndirs) {
+		/* added dirs already have E_DIR_SEPARATOR_STR added */
+		ret = *idx->bases[found->dir - idx->ndirs];
+	} else {
+		ret = idx->dirs[found->dir]->path;
+		ret += E_DIR_SEPARATOR_STR;
+	}
+
+	ret += found->name;
+	ret += icon_extensions[found->ext];
+	return ret;
 }
 
 const char* IconTheme::theme_name(void) const {
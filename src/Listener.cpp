@@ -17,115 +17,399 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <sys/select.h>
+#include <sys/time.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_EPOLL
+# include <sys/epoll.h>
+# include <unistd.h>
+# include <fcntl.h>
+#endif
 
 #include <edelib/Listener.h>
+#include <edelib/Debug.h>
 
 EDELIB_NS_BEGIN
 
+/* maximum number of events fetched with single epoll_wait() */
+#define LISTENER_EPOLL_EVENTS 64
+
+/*
+ * Timer wheel parameters. One tick is one millisecond; each level has WHEEL_SIZE slots and covers
+ * WHEEL_SIZE times longer period than level below it, so with 4 levels timers up to ~4.6 hours are
+ * placed directly and farther ones are moved down when top level slot gets cascaded.
+ */
+#define WHEEL_BITS   6
+#define WHEEL_SIZE   (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN   (1U << (WHEEL_BITS * WHEEL_LEVELS))
+
+/* buckets for lookup by callback and argument, used by listener_remove_timeout() */
+#define TIMER_HASH_SIZE 64
+
 struct FD {
-	int fd;
 	short events;
 	void (*cb)(int, void*);
 	void* arg;
+	FD*   next;
+	FD*   next_dead;
+};
+
+/* callbacks registered on the same descriptor; 'events' is union of their events */
+struct FDSlot {
+	FD*   head;
+	short events;
+	short forced; /* descriptor epoll refused (e.g. regular file); it is always ready, as with select() */
 };
 
-static FD  *fd_array = 0;
-static int fd_array_size = 0;
-static int nfds = 0;
-static int maxfd = 0; // largest descriptor number known
+/* indexed by descriptor number, so lookup after wakeup does not depend on number of descriptors */
+static FDSlot *fd_table = 0;
+static int fd_table_size = 0;
+static int maxfd = -1; // largest descriptor number known
+
+/*
+ * Entries removed from inside callbacks; they are freed when dispatching is done, so
+ * dispatch loop can safely continue with the next entry.
+ */
+static FD  *fd_dead = 0;
+static int dispatching = 0;
 
 static fd_set fdsets[3];
 
-void listener_add_fd(int fd, int when, void(*cb)(int, void*), void *arg) {
-	listener_remove_fd(fd, when);
+/* timer wheel slots are circular lists with sentinel node */
+struct TimerLink {
+	TimerLink* next;
+	TimerLink* prev;
+};
 
-	int i = nfds++;
-	if(i >= fd_array_size) {
-		FD *tmp;
-		fd_array_size = 2 * fd_array_size + 1;
+struct Timer : public TimerLink {
+	unsigned int expires; // in ticks
+	void (*cb)(void*);
+	void* arg;
+	Timer* hnext;
+};
+
+struct Idle {
+	void (*cb)(void*);
+	void* arg;
+	Idle* next;
+};
 
-		if(!fd_array)
-			tmp = (FD*)malloc(sizeof(FD) * fd_array_size);
-		else
-			tmp = (FD*)realloc(fd_array, sizeof(FD) * fd_array_size);
+static TimerLink    wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static Timer*       timer_hash[TIMER_HASH_SIZE];
+static unsigned int wheel_current;  // next tick to be processed
+static unsigned int ntimers = 0;
+static double       wheel_base;     // time of tick 0, in seconds
+static bool         wheel_ready = false;
 
-		if(!tmp)
-			return;
-		fd_array = tmp;
+/* scheduled tick of timer whose callback is running; used by listener_repeat_timeout() */
+static bool         in_timer = false;
+static unsigned int in_timer_expires;
+
+static Idle* idle_list = 0;
+static bool  in_idle = false;
+static bool  idle_dirty = false;
+
+static bool backend_ready = false;
+#ifdef HAVE_EPOLL
+static int epoll_fd = -1;
+static int nforced = 0;
+#endif
+
+static void backend_init(void) {
+	if(backend_ready) return;
+	backend_ready = true;
+
+#ifdef HAVE_EPOLL
+	/* allow to force select() at runtime */
+	if(getenv("EDELIB_LISTENER_SELECT"))
+		return;
+
+	epoll_fd = epoll_create(LISTENER_EPOLL_EVENTS);
+	if(epoll_fd < 0) {
+		E_WARNING(E_STRLOC ": epoll_create() failed (%s), using select()\n", strerror(errno));
+		return;
+	}
+
+	fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+#endif
+}
+
+#ifdef HAVE_EPOLL
+static void epoll_update(int fd, short oldev, short newev) {
+	FDSlot *s = &fd_table[fd];
+
+	if(s->forced) {
+		if(!newev) {
+			s->forced = 0;
+			nforced--;
+		}
+		return;
+	}
+
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.data.fd = fd;
+
+	if(newev & LISTENER_READ)
+		ev.events |= EPOLLIN;
+	if(newev & LISTENER_WRITE)
+		ev.events |= EPOLLOUT;
+	if(newev & LISTENER_EXCEPT)
+		ev.events |= EPOLLPRI;
+
+	if(!newev) {
+		/* descriptor could be closed already; kernel removed it then */
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+		return;
+	}
+
+	/* descriptor could be closed and reopened under the same number without removing it */
+	if(oldev && epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0)
+		return;
+
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+		return;
+
+	if(errno == EEXIST) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+	} else if(errno == EPERM) {
+		s->forced = 1;
+		nforced++;
+	} else {
+		E_WARNING(E_STRLOC ": unable to monitor %i (%s)\n", fd, strerror(errno));
 	}
+}
+#endif
 
-	fd_array[i].fd = fd;
-	fd_array[i].events = when;
-	fd_array[i].cb = cb;
-	fd_array[i].arg = arg;
+static void select_update(int fd, short newev) {
+	if(fd >= FD_SETSIZE) {
+		if(newev) E_WARNING(E_STRLOC ": %i is beyond FD_SETSIZE and can't be monitored\n", fd);
+		return;
+	}
 
-	if(when & LISTENER_READ)
+	if(newev & LISTENER_READ)
 		FD_SET(fd, &fdsets[0]);
-	if(when & LISTENER_WRITE)
+	else
+		FD_CLR(fd, &fdsets[0]);
+
+	if(newev & LISTENER_WRITE)
 		FD_SET(fd, &fdsets[1]);
-	if(when & LISTENER_EXCEPT)
+	else
+		FD_CLR(fd, &fdsets[1]);
+
+	if(newev & LISTENER_EXCEPT)
 		FD_SET(fd, &fdsets[2]);
-	
-	if(fd > maxfd)
-		maxfd = fd;
+	else
+		FD_CLR(fd, &fdsets[2]);
+}
+
+static void slot_update(int fd) {
+	FDSlot *s = &fd_table[fd];
+	short oldev = s->events, newev = 0;
+
+	for(FD *e = s->head; e; e = e->next)
+		newev |= e->events;
+
+	s->events = newev;
+	if(oldev == newev) return;
+
+#ifdef HAVE_EPOLL
+	if(epoll_fd >= 0)
+		epoll_update(fd, oldev, newev);
+	else
+#endif
+		select_update(fd, newev);
+
+	if(newev) {
+		if(fd > maxfd) maxfd = fd;
+	} else if(fd == maxfd) {
+		while(maxfd >= 0 && !fd_table[maxfd].head)
+			maxfd--;
+	}
+}
+
+static bool fd_table_grow(int fd) {
+	if(fd < fd_table_size) return true;
+
+	int sz = fd_table_size ? fd_table_size : 16;
+	while(sz <= fd) sz *= 2;
+
+	FDSlot *tmp = (FDSlot*)realloc(fd_table, sizeof(FDSlot) * sz);
+	if(!tmp) return false;
+
+	memset(tmp + fd_table_size, 0, sizeof(FDSlot) * (sz - fd_table_size));
+	fd_table = tmp;
+	fd_table_size = sz;
+	return true;
+}
+
+static void dispatch_fd(int fd, short ev) {
+	for(FD *e = fd_table[fd].head; e; e = e->next) {
+		if(e->events & ev)
+			e->cb(fd, e->arg);
+	}
+}
+
+static void dispatch_begin(void) {
+	dispatching++;
+}
+
+static void dispatch_end(void) {
+	if(--dispatching > 0) return;
+
+	FD *e;
+	while(fd_dead) {
+		e = fd_dead;
+		fd_dead = e->next_dead;
+		free(e);
+	}
+}
+
+void listener_add_fd(int fd, int when, void(*cb)(int, void*), void *arg) {
+	E_RETURN_IF_FAIL(fd >= 0);
+
+	backend_init();
+	listener_remove_fd(fd, when);
+
+	if(!fd_table_grow(fd))
+		return;
+
+	FD *e = (FD*)malloc(sizeof(FD));
+	if(!e)
+		return;
+
+	e->events = when;
+	e->cb = cb;
+	e->arg = arg;
+	e->next = 0;
+	e->next_dead = 0;
+
+	/* append, so callbacks on the same descriptor are called in order they were added */
+	FD **pp = &fd_table[fd].head;
+	while(*pp) pp = &(*pp)->next;
+	*pp = e;
+
+	slot_update(fd);
 }
 
 void listener_remove_fd(int fd, int when) {
-	int i, j;
-	maxfd = -1; // recalculate maxfd in the fly
+	if(fd < 0 || fd >= fd_table_size)
+		return;
 
-	for(i = j = 0; i < fd_array_size; i++) {
-		if(fd_array[i].fd == fd) {
-			int e = fd_array[i].events & ~when;
+	FD **pp = &fd_table[fd].head, *e;
 
-			// no events left, delete this fd
-			if(!e)
-				continue;
-			fd_array[i].events = e;
+	while((e = *pp) != 0) {
+		e->events &= ~when;
+
+		if(e->events) {
+			pp = &e->next;
+			continue;
 		}
 
-		if(fd_array[i].fd > maxfd)
-			maxfd = fd_array[i].fd;
-		// remove it down in the array if necessary
-		if(j < i)
-			fd_array[j] = fd_array[i];
-		j++;
+		// no events left, delete this entry
+		*pp = e->next;
+
+		if(dispatching) {
+			e->next_dead = fd_dead;
+			fd_dead = e;
+		} else {
+			free(e);
+		}
 	}
 
-	fd_array_size = j;
+	slot_update(fd);
+}
+
+#ifdef HAVE_EPOLL
+static int epoll_wait_dispatch(double t) {
+	epoll_event evs[LISTENER_EPOLL_EVENTS];
+	int ms, n;
 
-	if(when & LISTENER_READ)
-		FD_CLR(fd, &fdsets[0]);
-	if(when & LISTENER_WRITE)
-		FD_CLR(fd, &fdsets[1]);
-	if(when & LISTENER_EXCEPT)
-		FD_CLR(fd, &fdsets[2]);
+	if(nforced > 0) {
+		/* select() would return immediately too */
+		ms = 0;
+	} else if(t < 2147483.648) {
+		/* round up, so we do not wake up before timeout and then busy poll */
+		ms = (int)(t * 1000);
+		if(ms < t * 1000) ms++;
+	} else {
+		ms = -1;
+	}
+
+	n = epoll_wait(epoll_fd, evs, LISTENER_EPOLL_EVENTS, ms);
+	if(n < 0)
+		return n;
+
+	dispatch_begin();
+
+	for(int i = 0; i < n; i++) {
+		int      f = evs[i].data.fd;
+		uint32_t r = evs[i].events;
+		short    ev = 0;
+
+		/* the same as select(), hangup and errors wake up readers and writers */
+		if(r & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			ev |= LISTENER_READ;
+		if(r & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+			ev |= LISTENER_WRITE;
+		if(r & EPOLLPRI)
+			ev |= LISTENER_EXCEPT;
+
+		if(f < fd_table_size)
+			dispatch_fd(f, ev);
+	}
+
+	if(nforced > 0) {
+		for(int f = 0; f <= maxfd; f++) {
+			if(fd_table[f].forced) {
+				dispatch_fd(f, LISTENER_READ | LISTENER_WRITE);
+				n++;
+			}
+		}
+	}
+
+	dispatch_end();
+	return n;
 }
+#endif
+
+static int backend_wait(double t) {
+#ifdef HAVE_EPOLL
+	if(epoll_fd >= 0)
+		return epoll_wait_dispatch(t);
+#endif
 
-double listener_wait(double t) {
 	fd_set fdtmp[3];
 	fdtmp[0] = fdsets[0];
 	fdtmp[1] = fdsets[1];
 	fdtmp[2] = fdsets[2];
 
-	int n;
+	int n, last = (maxfd < FD_SETSIZE) ? maxfd : FD_SETSIZE - 1;
 
 	if(t < 2147483.648) {
 		timeval tval;
 		tval.tv_sec = (int)t;
 		tval.tv_usec = (int)(1000000 * (t - tval.tv_sec));
 
-		n = select(maxfd + 1, &fdtmp[0], &fdtmp[1], &fdtmp[2], &tval);
+		n = select(last + 1, &fdtmp[0], &fdtmp[1], &fdtmp[2], &tval);
 	} else {
-		n = select(maxfd + 1, &fdtmp[0], &fdtmp[1], &fdtmp[2], 0);
+		n = select(last + 1, &fdtmp[0], &fdtmp[1], &fdtmp[2], 0);
 	}
 
 	if(n > 0) {
-		for(int i = 0; i < fd_array_size; i++) {
-			int f = fd_array[i].fd;
+		dispatch_begin();
+
+		for(int f = 0; f <= last; f++) {
 			short ev = 0;
 
 			if(FD_ISSET(f, &fdtmp[0]))
@@ -135,12 +419,448 @@ double listener_wait(double t) {
 			if(FD_ISSET(f, &fdtmp[2]))
 				ev |= LISTENER_EXCEPT;
 
-			if(fd_array[i].events & ev)
-				fd_array[i].cb(f, fd_array[i].arg);
+			if(ev && f < fd_table_size)
+				dispatch_fd(f, ev);
 		}
+
+		dispatch_end();
 	}
 
 	return n;
 }
 
+static double time_now(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void wheel_init(void) {
+	if(wheel_ready) return;
+	wheel_ready = true;
+
+	for(int l = 0; l < WHEEL_LEVELS; l++) {
+		for(int i = 0; i < WHEEL_SIZE; i++)
+			wheel[l][i].next = wheel[l][i].prev = &wheel[l][i];
+	}
+
+	wheel_base = time_now();
+	wheel_current = 0;
+}
+
+/*
+ * Current tick; time is rounded down, so timers are never fired before requested time. Ticks wrap
+ * after ~49.7 days, so conversion goes through 64 bit integer; the wheel compares ticks only by
+ * signed difference.
+ */
+static unsigned int wheel_now(void) {
+	return (unsigned int)(unsigned long long)((time_now() - wheel_base) * 1000);
+}
+
+/* tick when timer 't' seconds from now should fire; rounded up */
+static unsigned int wheel_ticks_from_now(double t) {
+	if(t < 0) t = 0;
+
+	double ticks = (time_now() - wheel_base + t) * 1000;
+	unsigned long long ret = (unsigned long long)ticks;
+	if(ticks > ret) ret++;
+	return (unsigned int)ret;
+}
+
+/* seconds until given tick; negative if it passed */
+static double wheel_time_until(unsigned int tick) {
+	double ms = (time_now() - wheel_base) * 1000;
+	unsigned long long cur = (unsigned long long)ms;
+
+	return ((int)(tick - (unsigned int)cur) - (ms - cur)) / 1000.0;
+}
+
+static inline bool link_empty(TimerLink *l) {
+	return l->next == l;
+}
+
+static inline void link_remove(TimerLink *n) {
+	n->prev->next = n->next;
+	n->next->prev = n->prev;
+	n->next = n->prev = n;
+}
+
+static inline void link_append(TimerLink *head, TimerLink *n) {
+	n->prev = head->prev;
+	n->next = head;
+	head->prev->next = n;
+	head->prev = n;
+}
+
+/* move all nodes from 'from' to 'to', leaving 'from' empty */
+static void link_splice(TimerLink *from, TimerLink *to) {
+	to->next = to->prev = to;
+	if(link_empty(from)) return;
+
+	to->next = from->next;
+	to->prev = from->prev;
+	to->next->prev = to;
+	to->prev->next = to;
+	from->next = from->prev = from;
+}
+
+static void timer_link(Timer *t) {
+	unsigned int e = t->expires;
+	int delta = (int)(e - wheel_current);
+	int level;
+
+	if(delta < 0) {
+		/* already expired; run it with the next tick */
+		e = wheel_current;
+		delta = 0;
+	} else if((unsigned int)delta >= WHEEL_SPAN) {
+		/* too far; it will be placed again when top level slot is cascaded */
+		e = wheel_current + WHEEL_SPAN - 1;
+		delta = WHEEL_SPAN - 1;
+	}
+
+	for(level = 0; level < WHEEL_LEVELS - 1; level++) {
+		if((unsigned int)delta < (1U << (WHEEL_BITS * (level + 1))))
+			break;
+	}
+
+	link_append(&wheel[level][(e >> (WHEEL_BITS * level)) & WHEEL_MASK], t);
+}
+
+static inline unsigned int timer_hash_index(void (*cb)(void*), void *arg) {
+	unsigned long h = (unsigned long)cb ^ (unsigned long)arg;
+	return (unsigned int)((h >> 4) ^ (h >> 12)) & (TIMER_HASH_SIZE - 1);
+}
+
+static void timer_hash_remove(Timer *t) {
+	Timer **pp = &timer_hash[timer_hash_index(t->cb, t->arg)];
+
+	for(; *pp; pp = &(*pp)->hnext) {
+		if(*pp == t) {
+			*pp = t->hnext;
+			return;
+		}
+	}
+}
+
+static void timer_add_at(unsigned int expires, void (*cb)(void*), void *arg) {
+	Timer *t = (Timer*)malloc(sizeof(Timer));
+	if(!t) return;
+
+	/* wheel is not moved when there are no timers, so catch up first */
+	if(!ntimers) wheel_current = wheel_now();
+
+	t->expires = expires;
+	t->cb = cb;
+	t->arg = arg;
+
+	unsigned int h = timer_hash_index(cb, arg);
+	t->hnext = timer_hash[h];
+	timer_hash[h] = t;
+
+	timer_link(t);
+	ntimers++;
+}
+
+/* re-distribute timers from higher level slot to lower levels; returns slot index */
+static unsigned int wheel_cascade(int level) {
+	unsigned int idx = (wheel_current >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	TimerLink work;
+
+	link_splice(&wheel[level][idx], &work);
+
+	while(!link_empty(&work)) {
+		Timer *t = (Timer*)work.next;
+		link_remove(t);
+		timer_link(t);
+	}
+
+	return idx;
+}
+
+/*
+ * Find the earliest tick when something has to be done. For level 0 it is exact time; for the higher
+ * levels it is the time when the first non-empty slot will be cascaded, which is never after timers
+ * from that slot expire.
+ */
+static bool wheel_next(unsigned int &next) {
+	if(!ntimers) return false;
+
+	bool found = false;
+	unsigned int i, start, cur, cand;
+
+	for(i = 0; i < WHEEL_SIZE; i++) {
+		if(!link_empty(&wheel[0][(wheel_current + i) & WHEEL_MASK])) {
+			next = wheel_current + i;
+			found = true;
+			break;
+		}
+	}
+
+	for(int l = 1; l < WHEEL_LEVELS; l++) {
+		cur = wheel_current >> (WHEEL_BITS * l);
+
+		/* on level boundary, current slot is not cascaded yet */
+		start = (wheel_current & ((1U << (WHEEL_BITS * l)) - 1)) ? 1 : 0;
+
+		for(i = start; i < start + WHEEL_SIZE; i++) {
+			if(!link_empty(&wheel[l][(cur + i) & WHEEL_MASK])) {
+				cand = (cur + i) << (WHEEL_BITS * l);
+				if(!found || (int)(cand - next) < 0)
+					next = cand;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Place all timers again, relative to 'now'. Used when the wheel is behind more than it can cover
+ * (e.g. after suspend), so expired timers are moved to the current slot at once. Slots are visited
+ * from the current one onwards, so timers keep roughly their order.
+ */
+static void wheel_relink(unsigned int now) {
+	TimerLink work, *slot;
+	unsigned int cur;
+
+	work.next = work.prev = &work;
+
+	for(int l = 0; l < WHEEL_LEVELS; l++) {
+		cur = wheel_current >> (WHEEL_BITS * l);
+
+		for(unsigned int i = 0; i < WHEEL_SIZE; i++) {
+			slot = &wheel[l][(cur + i) & WHEEL_MASK];
+
+			while(!link_empty(slot)) {
+				TimerLink *n = slot->next;
+				link_remove(n);
+				link_append(&work, n);
+			}
+		}
+	}
+
+	wheel_current = now;
+
+	while(!link_empty(&work)) {
+		Timer *t = (Timer*)work.next;
+		link_remove(t);
+		timer_link(t);
+	}
+}
+
+/* fire all expired timers; returns number of called callbacks */
+static int wheel_run(void) {
+	if(!wheel_ready) return 0;
+
+	unsigned int now = wheel_now();
+	int ret = 0;
+
+	if(!ntimers) {
+		/* nothing to do; just move the wheel */
+		wheel_current = now + 1;
+		return 0;
+	}
+
+	TimerLink work;
+	unsigned int next;
+
+	if((int)(now - wheel_current) >= (int)WHEEL_SPAN)
+		wheel_relink(now);
+
+	while((int)(now - wheel_current) >= 0) {
+		unsigned int idx = wheel_current & WHEEL_MASK;
+
+		/* nothing in this tick; skip to the next one where timer fires or slot is cascaded */
+		if(idx && link_empty(&wheel[0][idx])) {
+			if(!wheel_next(next) || (int)(next - now) > 0) {
+				wheel_current = now + 1;
+				break;
+			}
+
+			/* wheel_next() may return current tick only on level boundary, which is not the case here */
+			wheel_current = next;
+			continue;
+		}
+
+		if(!idx) {
+			for(int l = 1; l < WHEEL_LEVELS; l++) {
+				if(wheel_cascade(l) != 0)
+					break;
+			}
+		}
+
+		link_splice(&wheel[0][idx], &work);
+
+		/* incremented before callbacks, so timers added from them do not land in processed slot */
+		wheel_current++;
+
+		while(!link_empty(&work)) {
+			Timer *t = (Timer*)work.next;
+			link_remove(t);
+			timer_hash_remove(t);
+			ntimers--;
+
+			void (*cb)(void*) = t->cb;
+			void *arg = t->arg;
+
+			in_timer = true;
+			in_timer_expires = t->expires;
+			free(t);
+
+			cb(arg);
+			in_timer = false;
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+static bool idle_run(void) {
+	if(!idle_list || in_idle) return false;
+
+	in_idle = true;
+	for(Idle *e = idle_list; e; e = e->next) {
+		if(e->cb) e->cb(e->arg);
+	}
+	in_idle = false;
+
+	/* purge callbacks removed while running */
+	if(idle_dirty) {
+		Idle **pp = &idle_list, *e;
+		while((e = *pp) != 0) {
+			if(!e->cb) {
+				*pp = e->next;
+				free(e);
+			} else {
+				pp = &e->next;
+			}
+		}
+
+		idle_dirty = false;
+	}
+
+	return true;
+}
+
+void listener_add_timeout(double t, void (*cb)(void*), void *arg) {
+	E_RETURN_IF_FAIL(cb != 0);
+
+	wheel_init();
+	timer_add_at(wheel_ticks_from_now(t), cb, arg);
+}
+
+void listener_repeat_timeout(double t, void (*cb)(void*), void *arg) {
+	E_RETURN_IF_FAIL(cb != 0);
+
+	wheel_init();
+	if(!in_timer) {
+		timer_add_at(wheel_ticks_from_now(t), cb, arg);
+		return;
+	}
+
+	/* count from the time previous timeout was scheduled, so repeating timers do not drift */
+	unsigned int e = in_timer_expires + (unsigned int)(t * 1000);
+	unsigned int now = wheel_now();
+
+	/* if we are too late, start from now instead of firing missed timeouts in a burst */
+	if((int)(e - now) < -50)
+		e = now;
+
+	timer_add_at(e, cb, arg);
+}
+
+void listener_remove_timeout(void (*cb)(void*), void *arg) {
+	Timer **pp = &timer_hash[timer_hash_index(cb, arg)], *t;
+
+	while((t = *pp) != 0) {
+		if(t->cb == cb && t->arg == arg) {
+			*pp = t->hnext;
+			link_remove(t);
+			free(t);
+			ntimers--;
+		} else {
+			pp = &t->hnext;
+		}
+	}
+}
+
+bool listener_has_timeout(void (*cb)(void*), void *arg) {
+	for(Timer *t = timer_hash[timer_hash_index(cb, arg)]; t; t = t->hnext) {
+		if(t->cb == cb && t->arg == arg)
+			return true;
+	}
+
+	return false;
+}
+
+void listener_add_idle(void (*cb)(void*), void *arg) {
+	E_RETURN_IF_FAIL(cb != 0);
+
+	Idle *e = (Idle*)malloc(sizeof(Idle));
+	if(!e) return;
+
+	e->cb = cb;
+	e->arg = arg;
+	e->next = 0;
+
+	Idle **pp = &idle_list;
+	while(*pp) pp = &(*pp)->next;
+	*pp = e;
+}
+
+void listener_remove_idle(void (*cb)(void*), void *arg) {
+	Idle **pp = &idle_list, *e;
+
+	while((e = *pp) != 0) {
+		if(e->cb == cb && e->arg == arg) {
+			if(in_idle) {
+				/* list is traversed now; it will be removed when all callbacks are done */
+				e->cb = 0;
+				idle_dirty = true;
+				pp = &e->next;
+			} else {
+				*pp = e->next;
+				free(e);
+			}
+		} else {
+			pp = &e->next;
+		}
+	}
+}
+
+double listener_wait(double t) {
+	int n, fired;
+	unsigned int next = 0;
+
+	backend_init();
+
+	fired = wheel_run();
+
+	/* do not sleep past the next timer */
+	if(wheel_next(next)) {
+		double tt = wheel_time_until(next);
+		if(tt < 0) tt = 0;
+		if(tt < t) t = tt;
+	}
+
+	/* the same as Fl::wait(), with idle callbacks only poll descriptors */
+	if(idle_run() && t > 0)
+		t = 0;
+
+	n = backend_wait(t);
+	if(n < 0)
+		return n;
+
+	return n + fired + wheel_run();
+}
+
 EDELIB_NS_END
@@ -16,7 +16,23 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <string.h>  // strncmp
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
 
 #include <edelib/MimeType.h>
 #include <edelib/TiXml.h>
@@ -24,42 +40,930 @@
 #include <edelib/Util.h>
 #include <edelib/StrUtil.h>
 #include <edelib/List.h>
+#include <edelib/Vector.h>
+#include <edelib/Directory.h>
+#include <edelib/FileTest.h>
 
 #include "xdgmime/xdgmime.h"
+#include "HashTable.h"
 
 #define MIME_LOADED    1
 #define COMMENT_LOADED 2
 #define ICON_LOADED    4
+#define GICON_LOADED   8
+
+/* default number of files remembered by set() */
+#define CACHE_SIZE_DEFAULT 1024
+
+/* mime_types_for_files() limits */
+#define BULK_THREADS_MAX   16
+#define BULK_SERIAL_MAX    16  /* do not start threads for less files than this */
+#define BULK_CANDIDATES    10
+
+/* comment/icon index; increase version when format is changed */
+#define INDEX_MAGIC        "EDELIB-MIME-INDEX 1"
+#define LANG_RANK_DEFAULT  100  /* comment without xml:lang */
+#define LANG_RANK_NONE     1000 /* comment in other language */
 
 EDELIB_NS_BEGIN
 
+/*
+ * Results of set() are kept in LRU cache, so looking at the same file again will not sniff its
+ * content. Entry is valid as long as file stat data is the same; when anything of it changes
+ * file is inspected again.
+ */
+struct MimeCacheEntry {
+	String       path;
+	unsigned int hash;
+
+	dev_t        dev;
+	ino_t        ino;
+	mode_t       mode;
+	off_t        size;
+	time_t       mtime;
+	time_t       ctime;
+
+	String       type;
+
+	MimeCacheEntry* hnext;  // next in bucket
+	MimeCacheEntry* prev;   // LRU list; head is most recently used
+	MimeCacheEntry* next;
+};
+
+static MimeCacheEntry** cache_table = NULL;
+static unsigned int     cache_table_size = 0;
+static unsigned int     cache_count = 0;
+static unsigned int     cache_max = CACHE_SIZE_DEFAULT;
+static bool             cache_callback_registered = false;
+
+static LruList<MimeCacheEntry> cache_lru;
+
+static void cache_remove(MimeCacheEntry* e) {
+	for(MimeCacheEntry** pp = &cache_table[e->hash & (cache_table_size - 1)]; *pp; pp = &(*pp)->hnext) {
+		if(*pp == e) {
+			*pp = e->hnext;
+			break;
+		}
+	}
+
+	cache_lru.unlink(e);
+	cache_count--;
+	delete e;
+}
+
+static void cache_clear(void) {
+	while(cache_lru.head)
+		cache_remove(cache_lru.head);
+}
+
+/* called by xdgmime when database was changed on disk and reloaded; cached types can be wrong now */
+static void cache_reload_cb(void*) {
+	cache_clear();
+}
+
+static MimeCacheEntry* cache_find(const char* path, unsigned int h) {
+	if(!cache_table)
+		return NULL;
+
+	for(MimeCacheEntry* e = cache_table[h & (cache_table_size - 1)]; e; e = e->hnext) {
+		if(e->hash == h && e->path == path)
+			return e;
+	}
+
+	return NULL;
+}
+
+static bool cache_entry_valid(MimeCacheEntry* e, struct stat* st) {
+	return e->ino == st->st_ino && e->dev == st->st_dev && e->mode == st->st_mode &&
+		e->size == st->st_size && e->mtime == st->st_mtime && e->ctime == st->st_ctime;
+}
+
+static void cache_entry_fill(MimeCacheEntry* e, struct stat* st, const char* type) {
+	e->dev = st->st_dev;
+	e->ino = st->st_ino;
+	e->mode = st->st_mode;
+	e->size = st->st_size;
+	e->mtime = st->st_mtime;
+	e->ctime = st->st_ctime;
+	e->type = type;
+}
+
+static void cache_add(const char* path, unsigned int h, struct stat* st, const char* type) {
+	if(!cache_max)
+		return;
+
+	if(!cache_table) {
+		/* table is sized for the maximum, so it never needs rehashing */
+		cache_table_size = 64;
+		while(cache_table_size < cache_max) cache_table_size *= 2;
+
+		cache_table = new MimeCacheEntry*[cache_table_size];
+		for(unsigned int i = 0; i < cache_table_size; i++)
+			cache_table[i] = NULL;
+	}
+
+	while(cache_count >= cache_max)
+		cache_remove(cache_lru.tail);
+
+	MimeCacheEntry* e = new MimeCacheEntry;
+	e->path = path;
+	e->hash = h;
+	cache_entry_fill(e, st, type);
+
+	unsigned int b = h & (cache_table_size - 1);
+	e->hnext = cache_table[b];
+	cache_table[b] = e;
+
+	cache_lru.push_front(e);
+	cache_count++;
+}
+
+/* 
+ * Return type for given file, consulting cache first. Returned value is valid until next call.
+ */
+static const char* cached_type_for_file(const char* path) {
+	struct stat st;
+
+	/* assume if it can't be stat()-ed, it can't be opened */
+	if(stat(path, &st) != 0) 
+		return NULL;
+
+	if(!cache_callback_registered) {
+		xdg_mime_register_reload_callback(cache_reload_cb, NULL, NULL);
+		cache_callback_registered = true;
+	}
+
+	unsigned int h = str_hash(path);
+	MimeCacheEntry* e = cache_find(path, h);
+
+	if(e) {
+		if(!cache_entry_valid(e, &st)) {
+			const char* res = xdg_mime_get_mime_type_for_stat(path, &st);
+			if(!res) {
+				cache_remove(e);
+				return NULL;
+			}
+
+			/* xdgmime could reload database and clear the cache; look again */
+			if(cache_find(path, h) != e) {
+				cache_add(path, h, &st, res);
+				return res;
+			}
+
+			cache_entry_fill(e, &st, res);
+		}
+
+		cache_lru.touch(e);
+
+		return e->type.c_str();
+	}
+
+	const char* res = xdg_mime_get_mime_type_for_stat(path, &st);
+	if(res)
+		cache_add(path, h, &st, res);
+
+	return res;
+}
+
+/*
+ * mime_types_for_files() does what set() does for each file, but in steps, so slow parts (stat() and
+ * reading file content) can run in parallel. Database is accessed only from the calling thread, except
+ * magic matching which workers do holding bulk_db_lock.
+ */
+struct MimeBulkItem {
+	const char*  path;
+	struct stat  st;
+	bool         stat_ok;
+	bool         cached;
+	const char*  candidates[BULK_CANDIDATES];
+	int          ncandidates;
+	const char*  type;   // from database
+	String       ctype;  // from cache
+};
+
+struct MimeBulkJob {
+	MimeBulkItem* items;
+	unsigned int* order;   // indices of items to process; NULL means all
+	unsigned int  nitems;
+	unsigned int  next;
+	int           extent;
+	void        (*func)(MimeBulkJob* job, MimeBulkItem* item);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t bulk_db_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void bulk_stat(MimeBulkJob*, MimeBulkItem* item) {
+	item->stat_ok = (stat(item->path, &item->st) == 0);
+}
+
+static void bulk_sniff(MimeBulkJob* job, MimeBulkItem* item) {
+	item->type = XDG_MIME_TYPE_UNKNOWN;
+
+	unsigned char* data = (unsigned char*)malloc(job->extent);
+	if(!data)
+		return;
+
+	int fd = open(item->path, O_RDONLY);
+	if(fd < 0) {
+		free(data);
+		return;
+	}
+
+	/* read only prefix magic rules can look at */
+	int len = 0, n = 0;
+	while(len < job->extent) {
+		n = read(fd, data + len, job->extent - len);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			break;
+		len += n;
+	}
+
+	close(fd);
+
+	if(n >= 0) {
+#ifdef HAVE_PTHREAD
+		pthread_mutex_lock(&bulk_db_lock);
+#endif
+		item->type = xdg_mime_get_mime_type_for_data_candidates(data, len, item->candidates, item->ncandidates);
+#ifdef HAVE_PTHREAD
+		pthread_mutex_unlock(&bulk_db_lock);
+#endif
+	}
+
+	free(data);
+}
+
+static void* bulk_worker(void* data) {
+	MimeBulkJob* job = (MimeBulkJob*)data;
+	unsigned int i;
+
+	while(1) {
+#ifdef HAVE_PTHREAD
+		pthread_mutex_lock(&job->lock);
+#endif
+		i = job->next++;
+#ifdef HAVE_PTHREAD
+		pthread_mutex_unlock(&job->lock);
+#endif
+		if(i >= job->nitems)
+			break;
+
+		job->func(job, &job->items[job->order ? job->order[i] : i]);
+	}
+
+	return NULL;
+}
+
+/* run func on job items; calling thread is one of the workers */
+static void bulk_run(MimeBulkJob* job, void (*func)(MimeBulkJob*, MimeBulkItem*), unsigned int nthreads) {
+	job->func = func;
+	job->next = 0;
+
+#ifdef HAVE_PTHREAD
+	pthread_t threads[BULK_THREADS_MAX];
+	unsigned int started = 0;
+
+	if(job->nitems >= BULK_SERIAL_MAX) {
+		for(; started + 1 < nthreads; started++) {
+			if(pthread_create(&threads[started], NULL, bulk_worker, job) != 0)
+				break;
+		}
+	}
+
+	bulk_worker(job);
+
+	for(unsigned int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+#else
+	bulk_worker(job);
+#endif
+}
+
+unsigned int mime_types_for_files(const list<String>& files, list<String>& types, unsigned int nthreads) {
+	types.clear();
+	if(files.empty())
+		return 0;
+
+	if(nthreads == 0) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		/* mostly waiting for disk, so use more threads than processors */
+		nthreads = (ncpu > 0) ? (unsigned int)ncpu * 2 : 4;
+	}
+
+	if(nthreads > BULK_THREADS_MAX)
+		nthreads = BULK_THREADS_MAX;
+
+	unsigned int nitems = files.size();
+	MimeBulkItem* items = new MimeBulkItem[nitems];
+	MimeBulkItem* item;
+	unsigned int  i;
+
+	list<String>::const_iterator it = files.begin(), ite = files.end();
+	for(i = 0; it != ite; ++it, i++) {
+		items[i].path = (*it).c_str();
+		items[i].cached = false;
+		items[i].type = NULL;
+	}
+
+	MimeBulkJob job;
+	job.items = items;
+	job.order = NULL;
+	job.nitems = nitems;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_init(&job.lock, NULL);
+#endif
+
+	bulk_run(&job, bulk_stat, nthreads);
+
+	if(!cache_callback_registered) {
+		xdg_mime_register_reload_callback(cache_reload_cb, NULL, NULL);
+		cache_callback_registered = true;
+	}
+
+	/* 
+	 * Load (or reload) database. Functions used below will not reload it, so types returned
+	 * from it stay valid until we are done.
+	 */
+	job.extent = xdg_mime_get_max_buffer_extents();
+
+	/* check cache and match file names; files recognized by name will not be opened */
+	unsigned int*   sniff = new unsigned int[nitems];
+	unsigned int    nsniff = 0;
+	MimeCacheEntry* e;
+
+	for(i = 0; i < nitems; i++) {
+		item = &items[i];
+		if(!item->stat_ok)
+			continue;
+
+		e = cache_find(item->path, str_hash(item->path));
+		if(e && cache_entry_valid(e, &item->st)) {
+			item->ctype = e->type;
+			item->cached = true;
+			continue;
+		}
+
+		if(!S_ISREG(item->st.st_mode)) {
+			item->type = xdg_mime_get_mime_type_for_stat(item->path, &item->st);
+			continue;
+		}
+
+		item->ncandidates = xdg_mime_get_mime_type_candidates(item->path, item->candidates, BULK_CANDIDATES);
+		if(item->ncandidates < 0) {
+			/* set() does not accept names that are not valid UTF-8 */
+			item->stat_ok = false;
+			continue;
+		}
+
+		if(item->ncandidates == 1)
+			item->type = item->candidates[0];
+		else
+			sniff[nsniff++] = i;
+	}
+
+	job.order = sniff;
+	job.nitems = nsniff;
+	bulk_run(&job, bulk_sniff, nthreads);
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&job.lock);
+#endif
+
+	unsigned int found = 0;
+
+	for(i = 0; i < nitems; i++) {
+		item = &items[i];
+
+		if(!item->stat_ok) {
+			types.push_back("");
+			continue;
+		}
+
+		if(item->cached) {
+			types.push_back(item->ctype);
+		} else {
+			types.push_back(item->type);
+			cache_add(item->path, str_hash(item->path), &item->st, item->type);
+		}
+
+		found++;
+	}
+
+	delete [] sniff;
+	delete [] items;
+	return found;
+}
+
+/*
+ * Comments and icons are read from shared-mime-info packages (<datadir>/mime/packages/ *.xml) and written to
+ * the index in user_cache_dir(), with one line per type: "type<TAB>comment<TAB>icon<TAB>generic-icon". Index is
+ * built for the current language, once, and rebuilt when packages are changed. When it is loaded, lookups are
+ * only hash probes.
+ */
+struct MimeIndexEntry {
+	const char*     type;
+	const char*     comment;
+	const char*     icon;
+	const char*     generic_icon;
+	unsigned int    hash;
+	MimeIndexEntry* next;
+};
+
+/* used while index is built */
+struct MimeIndexRecord {
+	String type;
+	String comment;
+	int    comment_rank;
+	String icon;
+	String generic_icon;
+};
+
+static bool             index_loaded = false;
+static char*            index_data = NULL;
+static MimeIndexEntry*  index_entries = NULL;
+static MimeIndexEntry** index_table = NULL;
+static unsigned int     index_table_size = 0;
+
+/*
+ * Rank xml:lang value against LANG; lower is better. The order is the same as in Config::get_localized():
+ * lc_CC@modifier, lc_CC, lc@modifier, lc, then comment without language.
+ */
+static int lang_rank(const char* lang, const char* xml_lang) {
+	if(!xml_lang)
+		return LANG_RANK_DEFAULT;
+
+	if(!lang || !*lang || lang[0] == 'C' || strcmp(lang, "POSIX") == 0)
+		return LANG_RANK_NONE;
+
+	/* split lc_CC.encoding@modifier */
+	String lc, cc, mod;
+	const char* p = lang;
+
+	while(*p && *p != '_' && *p != '.' && *p != '@') lc += *p++;
+	if(*p == '_') {
+		p++;
+		while(*p && *p != '.' && *p != '@') cc += *p++;
+	}
+	while(*p && *p != '@') p++;
+	if(*p == '@') mod = p + 1;
+
+	String v;
+	for(int i = 0; i < 4; i++) {
+		v = lc;
+		if(i < 2) {
+			if(cc.empty()) continue;
+			v += '_';
+			v += cc;
+		}
+
+		if(i == 0 || i == 2) {
+			if(mod.empty()) continue;
+			v += '@';
+			v += mod;
+		}
+
+		if(v == xml_lang)
+			return i;
+	}
+
+	return LANG_RANK_NONE;
+}
+
+static const char* index_lang(void) {
+	const char* lang = getenv("LC_ALL");
+	if(!lang || !*lang) lang = getenv("LC_MESSAGES");
+	if(!lang || !*lang) lang = getenv("LANG");
+	return lang;
+}
+
+static void index_clear(void) {
+	delete [] index_table;
+	delete [] index_entries;
+	free(index_data);
+
+	index_table = NULL;
+	index_entries = NULL;
+	index_data = NULL;
+	index_table_size = 0;
+	index_loaded = false;
+}
+
+/* package directories, from the most important one */
+static void index_package_dirs(list<String>& dirs) {
+	list<String> sys;
+	system_data_dirs(sys);
+	sys.push_front(user_data_dir());
+
+	list<String>::iterator it = sys.begin(), ite = sys.end();
+	for(; it != ite; ++it)
+		dirs.push_back(build_filename((*it).c_str(), "mime", "packages"));
+}
+
+/* files and their modification times, so changed packages can be detected */
+static unsigned long index_stamp(list<String>& dirs, list<String>* files) {
+	unsigned long stamp = 0;
+	struct stat st;
+	String path;
+
+	list<String>::iterator it = dirs.begin(), ite = dirs.end();
+	for(; it != ite; ++it) {
+		DIR* d = opendir((*it).c_str());
+		if(!d) continue;
+
+		dirent* dp;
+		while((dp = readdir(d)) != NULL) {
+			if(!str_ends(dp->d_name, ".xml"))
+				continue;
+
+			path = build_filename((*it).c_str(), dp->d_name);
+			if(stat(path.c_str(), &st) != 0)
+				continue;
+
+			stamp = stamp * 31 + (unsigned long)st.st_mtime + (unsigned long)st.st_size + str_hash(path.c_str());
+			if(files)
+				files->push_back(path);
+		}
+
+		closedir(d);
+	}
+
+	return stamp;
+}
+
+static String index_path(void) {
+	String name = "edelib-mime-index-";
+	const char* lang = index_lang();
+
+	if(!lang || !*lang) {
+		name += 'C';
+	} else {
+		for(; *lang; lang++)
+			name += (*lang == E_DIR_SEPARATOR) ? '_' : *lang;
+	}
+
+	return build_filename(user_cache_dir().c_str(), name.c_str());
+}
+
+static void index_field_append(String& out, const String& val) {
+	/* tabs and newlines are separators */
+	for(String::size_type i = 0; i < val.length(); i++) {
+		char c = val[i];
+		out += (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+	}
+}
+
+static MimeIndexRecord* index_record_get(vector<MimeIndexRecord*>& recs, vector<int>& table, const char* type) {
+	unsigned int h = str_hash(type), mask = table.size() - 1, i = h & mask;
+	int idx;
+
+	while((idx = table[i]) != -1) {
+		if(recs[idx]->type == type)
+			return recs[idx];
+		i = (i + 1) & mask;
+	}
+
+	/* grow when half full */
+	if(recs.size() * 2 >= table.size()) {
+		unsigned int nsize = table.size() * 2;
+		table.clear();
+		for(unsigned int j = 0; j < nsize; j++)
+			table.push_back(-1);
+
+		for(unsigned int j = 0; j < recs.size(); j++) {
+			i = str_hash(recs[j]->type.c_str()) & (nsize - 1);
+			while(table[i] != -1) i = (i + 1) & (nsize - 1);
+			table[i] = j;
+		}
+
+		mask = nsize - 1;
+		i = h & mask;
+		while(table[i] != -1) i = (i + 1) & mask;
+	}
+
+	MimeIndexRecord* r = new MimeIndexRecord;
+	r->type = type;
+	r->comment_rank = LANG_RANK_NONE;
+
+	table[i] = recs.size();
+	recs.push_back(r);
+	return r;
+}
+
+/* packages are streamed, since freedesktop.org.xml alone has a few megabytes of translations */
+class MimePackageReader : public TiXmlSaxHandler {
+private:
+	const char*              lang;
+	vector<MimeIndexRecord*>& recs;
+	vector<int>&              table;
+	MimeIndexRecord*         rec;
+	int                      depth;
+	int                      rank;
+	bool                     in_comment;
+public:
+	MimePackageReader(const char* l, vector<MimeIndexRecord*>& r, vector<int>& t) :
+		lang(l), recs(r), table(t), rec(NULL), depth(0), rank(0), in_comment(false) { }
+
+	bool StartElement(const char* name, const char** attrs) {
+		const char* val;
+		depth++;
+
+		if(depth == 1)
+			return strcmp(name, "mime-info") == 0;
+
+		if(depth == 2) {
+			rec = NULL;
+			if(strcmp(name, "mime-type") == 0 && (val = TiXmlSaxParser::Attribute(attrs, "type")) != NULL)
+				rec = index_record_get(recs, table, val);
+			return true;
+		}
+
+		if(depth != 3 || !rec)
+			return true;
+
+		if(strcmp(name, "comment") == 0) {
+			rank = lang_rank(lang, TiXmlSaxParser::Attribute(attrs, "xml:lang"));
+			/* packages are read from the most important one, so keep the first on the same rank */
+			in_comment = (rank < rec->comment_rank);
+		} else if(strcmp(name, "icon") == 0) {
+			if(rec->icon.empty() && (val = TiXmlSaxParser::Attribute(attrs, "name")) != NULL)
+				rec->icon = val;
+		} else if(strcmp(name, "generic-icon") == 0) {
+			if(rec->generic_icon.empty() && (val = TiXmlSaxParser::Attribute(attrs, "name")) != NULL)
+				rec->generic_icon = val;
+		}
+
+		return true;
+	}
+
+	bool EndElement(const char*) {
+		depth--;
+		in_comment = false;
+		return true;
+	}
+
+	bool Text(const char* text, bool) {
+		if(in_comment && depth == 3) {
+			rec->comment = text;
+			rec->comment_rank = rank;
+			in_comment = false;
+		}
+		return true;
+	}
+};
+
+static void index_read_package(const char* path, const char* lang, vector<MimeIndexRecord*>& recs, vector<int>& table) {
+	MimePackageReader reader(lang, recs, table);
+	TiXmlSaxParser parser(&reader);
+
+	if(!parser.ParseFile(path) && parser.Error())
+		E_DEBUG(E_STRLOC ": %s malformed (%s at line %i)\n", path, parser.ErrorDesc(), parser.ErrorRow());
+}
+
+/* build index content, in the same form as it is written to the file */
+static void index_build(list<String>& files, unsigned long stamp, String& out) {
+	vector<MimeIndexRecord*> recs;
+	vector<int> table;
+	for(int i = 0; i < 1024; i++)
+		table.push_back(-1);
+
+	const char* lang = index_lang();
+
+	list<String>::iterator it = files.begin(), ite = files.end();
+	for(; it != ite; ++it)
+		index_read_package((*it).c_str(), lang, recs, table);
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s %lu\n", INDEX_MAGIC, stamp);
+	out = buf;
+
+	for(unsigned int i = 0; i < recs.size(); i++) {
+		MimeIndexRecord* r = recs[i];
+		if(r->comment_rank < LANG_RANK_NONE || !r->icon.empty() || !r->generic_icon.empty()) {
+			index_field_append(out, r->type);
+			out += '\t';
+			index_field_append(out, r->comment);
+			out += '\t';
+			index_field_append(out, r->icon);
+			out += '\t';
+			index_field_append(out, r->generic_icon);
+			out += '\n';
+		}
+
+		delete r;
+	}
+}
+
+/* data must start with header line; it is modified in place and owned by index */
+static bool index_parse(char* data, unsigned long stamp) {
+	char* p = strchr(data, '\n');
+	if(!p)
+		return false;
+
+	*p++ = '\0';
+
+	char header[64];
+	snprintf(header, sizeof(header), "%s %lu", INDEX_MAGIC, stamp);
+	if(strcmp(data, header) != 0)
+		return false;
+
+	unsigned int n = 0;
+	for(char* s = p; *s; s++)
+		if(*s == '\n') n++;
+
+	index_entries = new MimeIndexEntry[n ? n : 1];
+	index_table_size = 64;
+	while(index_table_size < n * 2) index_table_size *= 2;
+
+	index_table = new MimeIndexEntry*[index_table_size];
+	for(unsigned int i = 0; i < index_table_size; i++)
+		index_table[i] = NULL;
+
+	char* fields[4];
+	unsigned int count = 0, b;
+	int f;
+
+	while(*p && count < n) {
+		for(f = 0; f < 4; f++) {
+			fields[f] = p;
+			while(*p && *p != '\t' && *p != '\n') p++;
+
+			if(f < 3 && *p != '\t')
+				break;
+			if(f == 3 && *p != '\n')
+				break;
+
+			*p++ = '\0';
+		}
+
+		/* damaged line; skip the rest of it */
+		if(f < 4) {
+			while(*p && *p++ != '\n')
+				;
+			continue;
+		}
+
+		MimeIndexEntry* e = &index_entries[count++];
+		e->type = fields[0];
+		e->comment = fields[1];
+		e->icon = fields[2];
+		e->generic_icon = fields[3];
+		e->hash = str_hash(e->type);
+
+		b = e->hash & (index_table_size - 1);
+		e->next = index_table[b];
+		index_table[b] = e;
+	}
+
+	index_data = data;
+	return true;
+}
+
+static char* index_read_file(const char* path) {
+	FILE* f = fopen(path, "r");
+	if(!f)
+		return NULL;
+
+	struct stat st;
+	if(fstat(fileno(f), &st) != 0 || st.st_size <= 0) {
+		fclose(f);
+		return NULL;
+	}
+
+	char* data = (char*)malloc(st.st_size + 1);
+	if(!data) {
+		fclose(f);
+		return NULL;
+	}
+
+	size_t n = fread(data, 1, st.st_size, f);
+	fclose(f);
+
+	data[n] = '\0';
+	return data;
+}
+
+static void index_write_file(const char* path, const String& content) {
+	String dir = user_cache_dir();
+	if(!file_test(dir.c_str(), FILE_TEST_IS_DIR) && !dir_create_with_parents(dir.c_str()))
+		return;
+
+	/* write to temporary file first, so other processes never see half written index */
+	char tmp[1024];
+	snprintf(tmp, sizeof(tmp), "%s.%i", path, (int)getpid());
+
+	FILE* f = fopen(tmp, "w");
+	if(!f)
+		return;
+
+	bool ok = (fwrite(content.c_str(), 1, content.length(), f) == content.length());
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || rename(tmp, path) != 0)
+		unlink(tmp);
+}
+
+static void index_load(void) {
+	if(index_loaded)
+		return;
+
+	/* if anything fails, lookups go to per-type files */
+	index_loaded = true;
+
+	list<String> dirs;
+	index_package_dirs(dirs);
+
+	unsigned long stamp = index_stamp(dirs, NULL);
+	String path = index_path();
+
+	char* data = index_read_file(path.c_str());
+	if(data) {
+		if(index_parse(data, stamp))
+			return;
+
+		/* stale */
+		free(data);
+	}
+
+	list<String> files;
+	stamp = index_stamp(dirs, &files);
+	if(files.empty())
+		return;
+
+	String content;
+	index_build(files, stamp, content);
+	index_write_file(path.c_str(), content);
+
+	data = strdup(content.c_str());
+	if(data && !index_parse(data, stamp))
+		free(data);
+}
+
+static MimeIndexEntry* index_find(const char* type) {
+	index_load();
+	if(!index_table)
+		return NULL;
+
+	unsigned int h = str_hash(type);
+	for(MimeIndexEntry* e = index_table[h & (index_table_size - 1)]; e; e = e->next) {
+		if(e->hash == h && strcmp(e->type, type) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
 MimeType::MimeType() : status(0)
 {
 }
 
 MimeType::~MimeType()
 {
+	/* database and cache are shared by all objects; they are released with MimeType::shutdown() */
+}
+
+void MimeType::shutdown(void) {
 	xdg_mime_shutdown();
+	cache_clear();
+	index_clear();
+
+	delete [] cache_table;
+	cache_table = NULL;
+	cache_table_size = 0;
+}
+
+void MimeType::cache_size(unsigned int n) {
+	/* table size depends on maximum, so it will be created again */
+	cache_clear();
+
+	delete [] cache_table;
+	cache_table = NULL;
+	cache_table_size = 0;
+	cache_max = n;
 }
 
 bool MimeType::set(const char* filename) {
 	E_ASSERT(filename != NULL);
-	/*
-	 * Call on the same file again check.
-	 * FIXME: some stamp check would be nice here so if file  with the same name change content, can be inspected.
-	 */
-	if(mtype == filename)
-		return true;
-
-	mcmt.clear(); mtype.clear(); micon.clear();
 
-	const char* res = xdg_mime_get_mime_type_for_file2(filename);
+	const char* res = cached_type_for_file(filename);
 
 	if(!res) {
+		mcmt.clear(); mtype.clear(); micon.clear(); mgicon.clear();
 		status = 0;
 		return false;
 	}
 
+	/* the same type again; keep already loaded comment and icon */
+	if((status & MIME_LOADED) && mtype == res)
+		return true;
+
+	mcmt.clear(); micon.clear(); mgicon.clear();
 	mtype.assign(res);
 	status = MIME_LOADED;
 	return true;
@@ -78,6 +982,13 @@ const String& MimeType::comment(void) {
 	if(status & COMMENT_LOADED)
 		return mcmt;
 
+	MimeIndexEntry* e = index_find(mtype.c_str());
+	if(e && *e->comment) {
+		mcmt = e->comment;
+		status |= COMMENT_LOADED;
+		return mcmt;
+	}
+
 	String ttype = mtype;
 	ttype += ".xml";
 
@@ -95,24 +1006,31 @@ const String& MimeType::comment(void) {
 	}
 
 	TiXmlNode* el = doc.FirstChild("mime-type");
+	if(!el)
+		return mcmt;
 
 	/*
-	 * First element which does not have "xml:lang" attribute
-	 * is default one. So hunt that one :)
+	 * Element without "xml:lang" attribute is default one; use it if there is
+	 * nothing for current language.
 	 *
 	 * Btw. TinyXML does not handle XML namespaces and will return
 	 * "<namespace>:<attribute>" value. This is not big deal as long
 	 * as correctly fetch attribute values.
 	 */
+	const char* lang = index_lang();
+	int rank, best = LANG_RANK_NONE;
+
 	for(el = el->FirstChildElement(); el; el = el->NextSibling()) {
 		if(strncmp(el->Value(), "comment", 7) == 0) {
-			// TODO: add locale here
-			if(!el->ToElement()->Attribute("xml:lang")) {
-				TiXmlText* data = el->FirstChild()->ToText();
-				if(data) {
-					mcmt = data->Value();
-					break;
-				}
+			rank = lang_rank(lang, el->ToElement()->Attribute("xml:lang"));
+			if(rank >= best)
+				continue;
+
+			TiXmlNode* n = el->FirstChild();
+			TiXmlText* data = n ? n->ToText() : NULL;
+			if(data) {
+				mcmt = data->Value();
+				best = rank;
 			}
 		}
 	}
@@ -139,6 +1057,12 @@ const String& MimeType::icon_name(void) {
 
 	/* check first for user aliases */
 	const char* ic = xdg_mime_get_icon(mtype.c_str());
+	if(!ic) {
+		MimeIndexEntry* e = index_find(mtype.c_str());
+		if(e && *e->icon)
+			ic = e->icon;
+	}
+
 	if(ic) {
 		micon = ic;
 
@@ -172,4 +1096,34 @@ const String& MimeType::icon_name(void) {
 	return micon;
 }
 
+const String& MimeType::generic_icon_name(void) {
+	if(!(status & MIME_LOADED))
+		return mgicon;
+
+	if(status & GICON_LOADED)
+		return mgicon;
+
+	const char* ic = xdg_mime_get_generic_icon(mtype.c_str());
+	if(!ic) {
+		MimeIndexEntry* e = index_find(mtype.c_str());
+		if(e && *e->generic_icon)
+			ic = e->generic_icon;
+	}
+
+	if(ic) {
+		mgicon = ic;
+	} else {
+		/* by the spec, it is media type with '-x-generic' suffix */
+		String::size_type pos = mtype.find('/', 0);
+		if(pos == String::npos)
+			return mgicon;
+
+		mgicon = mtype.substr(0, pos);
+		mgicon += "-x-generic";
+	}
+
+	status |= GICON_LOADED;
+	return mgicon;
+}
+
 EDELIB_NS_END
@@ -49,18 +49,16 @@
 #include <edelib/Debug.h>
 #include <edelib/PtyProcess.h>
 #include <edelib/Pty.h>
+#include <edelib/Listener.h>
 
 EDELIB_NS_BEGIN
 
-static int strpos(const char *str, char c) {
-	unsigned int len = strlen(str);
+/* initial size of pending output buffer and minimal free space before read() */
+#define INBUF_INITIAL 1024
+#define INBUF_READ    4096
 
-	for(unsigned int i = 0; i < len; i++)
-		if(str[i] == c) 
-			return i;
-
-	return -1;
-}
+/* how often to check if program exited, after it closed the terminal */
+#define EXIT_POLL_INTERVAL 0.05
 
 int PtyProcess::wait_ms(int fd,int ms) {
 	struct timeval tv;
@@ -99,12 +97,165 @@ class PtyProcess::PtyProcessPrivate {
 public:
 	char **env;
 
+	/* 
+	 * Pending program output, kept in ring buffer with power of 2 capacity, so reading line by
+	 * line does not move the rest of the data.
+	 */
+	char *inbuf;
+	unsigned int inbuf_cap, inbuf_head, inbuf_len;
+
+	/* async mode */
+	PtyProcessDataCallback data_cb;
+	PtyProcessExitCallback exit_cb;
+	void *cb_arg;
+	bool  fd_watched;
+
+	PtyProcessPrivate() : env(0), inbuf(0), inbuf_cap(0), inbuf_head(0), inbuf_len(0), 
+		data_cb(0), exit_cb(0), cb_arg(0), fd_watched(false) { }
+
 	~PtyProcessPrivate() {
+		free(inbuf);
+
 		if(!env)
 			return;
 		for(int i = 0; env[i]; i++)
 			free(env[i]);
 	}
+
+	void inbuf_clear(void) { inbuf_head = inbuf_len = 0; }
+
+	/* copy pending data to 'dst' as single block */
+	void inbuf_copy(char *dst, unsigned int n) {
+		if(!n)
+			return;
+
+		unsigned int first = inbuf_cap - inbuf_head;
+		if(first > n)
+			first = n;
+
+		memcpy(dst, inbuf + inbuf_head, first);
+		memcpy(dst + first, inbuf, n - first);
+	}
+
+	/* reallocate buffer, placing pending data at the start */
+	void inbuf_resize(unsigned int cap) {
+		char *n = (char*)malloc(cap);
+		E_ASSERT(n != NULL);
+
+		inbuf_copy(n, inbuf_len);
+		free(inbuf);
+
+		inbuf = n;
+		inbuf_cap = cap;
+		inbuf_head = 0;
+	}
+
+	/* make sure there is room for 'n' more bytes */
+	void inbuf_reserve(unsigned int n) {
+		if(inbuf_len + n <= inbuf_cap)
+			return;
+
+		unsigned int cap = inbuf_cap ? inbuf_cap : INBUF_INITIAL;
+		while(cap < inbuf_len + n)
+			cap *= 2;
+
+		inbuf_resize(cap);
+	}
+
+	/* contiguous free space after pending data */
+	char *inbuf_tail(unsigned int *n) {
+		unsigned int tail = (inbuf_head + inbuf_len) & (inbuf_cap - 1);
+
+		*n = inbuf_cap - tail;
+		if(*n > inbuf_cap - inbuf_len)
+			*n = inbuf_cap - inbuf_len;
+
+		return inbuf + tail;
+	}
+
+	void inbuf_prepend(const char *data, unsigned int n) {
+		if(!n)
+			return;
+
+		inbuf_reserve(n);
+		inbuf_head = (inbuf_head - n) & (inbuf_cap - 1);
+		inbuf_len += n;
+
+		unsigned int first = inbuf_cap - inbuf_head;
+		if(first > n)
+			first = n;
+
+		memcpy(inbuf + inbuf_head, data, first);
+		memcpy(inbuf, data + first, n - first);
+	}
+
+	/* offset of the first 'c' in pending data or -1 */
+	int inbuf_find(char c) {
+		if(!inbuf_len)
+			return -1;
+
+		unsigned int first = inbuf_cap - inbuf_head;
+		if(first > inbuf_len)
+			first = inbuf_len;
+
+		const char *p = (const char*)memchr(inbuf + inbuf_head, c, first);
+		if(p)
+			return p - (inbuf + inbuf_head);
+
+		p = (const char*)memchr(inbuf, c, inbuf_len - first);
+		if(p)
+			return first + (p - inbuf);
+
+		return -1;
+	}
+
+	/* 
+	 * Return the first 'n' pending bytes and remove them from the buffer. Data is not moved unless it 
+	 * wraps around the buffer end, and it stays there until the next read.
+	 */
+	const char *inbuf_take(unsigned int n) {
+		if(inbuf_head + n > inbuf_cap)
+			inbuf_resize(inbuf_cap);
+
+		const char *ret = inbuf + inbuf_head;
+
+		inbuf_len -= n;
+		inbuf_head = inbuf_len ? ((inbuf_head + n) & (inbuf_cap - 1)) : 0;
+		return ret;
+	}
+
+	/* read once from 'fd' into pending data; returns read() result */
+	int inbuf_fill(int fd, bool block) {
+		int flags = fcntl(fd, F_GETFL);
+		if(flags < 0) {
+			E_WARNING(E_STRLOC ": fcntl not working - %d\n", errno);
+			return -1;
+		}
+
+		int nflags = block ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+
+		// We get an error here when the child process has closed 
+		// the file descriptor already.
+		if(nflags != flags && fcntl(fd, F_SETFL, nflags) < 0)
+			return -1;
+
+		inbuf_reserve(INBUF_READ);
+
+		unsigned int room;
+		char *tail = inbuf_tail(&room);
+		int nbytes;
+
+		while(1) {
+			nbytes = read(fd, tail, room);
+			if(nbytes == -1 && errno == EINTR && block)
+				continue;
+			break;
+		}
+
+		if(nbytes > 0)
+			inbuf_len += nbytes;
+		return nbytes;
+	}
 };
 
 PtyProcess::PtyProcess() {
@@ -112,12 +263,13 @@ PtyProcess::PtyProcess() {
 	m_bErase = false;
 	m_pPTY = 0L;
 	d = new PtyProcessPrivate;
-	d->env = 0;
 	m_Pid = 0;
-	m_Inbuf = m_TTY = m_Exit = m_Command = 0;
+	m_Fd = -1;
+	m_TTY = m_Exit = m_Command = 0;
 }
 
 int PtyProcess::init() {
+	async_watch(false);
 	delete m_pPTY;
 
 	m_pPTY = new PTY();
@@ -136,10 +288,7 @@ int PtyProcess::init() {
 
 	m_TTY = strdup(m_pPTY->ptsname());
 
-	if(m_Inbuf) 
-		free(m_Inbuf);
-
-	m_Inbuf = 0;
+	d->inbuf_clear();
 	return 0;
 }
 
@@ -150,8 +299,8 @@ PtyProcess::~PtyProcess() {
 		kill(m_Pid, SIGSTOP); // Terminate child process - Vedran
 
 	if(m_TTY) free(m_TTY);
-	if(m_Inbuf) free(m_Inbuf);
 
+	async_watch(false);
 	delete m_pPTY;
 	delete d;
 }
@@ -187,116 +336,130 @@ char **PtyProcess::environment() const {
  * Read one line of input. The terminal is in canonical mode, so you always
  * read a line at at time
  */
-char *PtyProcess::read_line(bool block) {
-	int pos;
-	char *ret = 0;
+int PtyProcess::read_line_span(const char **line, bool block) {
+	if(!d->inbuf_len && d->inbuf_fill(m_Fd, block) <= 0)
+		return 0;
 
-	if(m_Inbuf && strlen(m_Inbuf)>0) {
-		pos = strpos(m_Inbuf,'\n');
+	int pos = d->inbuf_find('\n');
 
-		if(pos == -1) {
-			ret = strdup(m_Inbuf);
-			free(m_Inbuf);
-			m_Inbuf = 0;
-		} else {
-			// ret = part of m_Inbuf before \n
-			// m_Inbuf = part of m_Inbuf after \n
-			ret = strdup(m_Inbuf);
-			free(m_Inbuf);
-			m_Inbuf = strdup(ret + pos + 1);
-			ret[pos+1] = '\0';
-		}
+	// only one line...
+	unsigned int len = (pos == -1) ? d->inbuf_len : (unsigned int)pos + 1;
+	*line = d->inbuf_take(len);
+	return len;
+}
 
-		return ret;
-	}
+char *PtyProcess::read_line(bool block) {
+	const char *line;
+	int len = read_line_span(&line, block);
 
-	int flags = fcntl(m_Fd, F_GETFL);
-	if(flags < 0) {
-		E_WARNING(E_STRLOC ": fcntl not working - %d\n", errno);
-		return ret;
-	}
+	if(len <= 0)
+		return 0;
 
-	if(block)
-		flags &= ~O_NONBLOCK;
-	else
-		flags |= O_NONBLOCK;
+	char *ret = (char*)malloc(len + 1);
+	memcpy(ret, line, len);
+	ret[len] = '\0';
+	return ret;
+}
 
-	if(fcntl(m_Fd, F_SETFL, flags) < 0) {
-	   // We get an error here when the child process has closed 
-	   // the file descriptor already.
-	   return ret;
-	}
+int PtyProcess::read_available(const char **data) {
+	while(d->inbuf_fill(m_Fd, false) > 0)
+		;
 
-	int nbytes;
-	char buf[256];
+	int len = d->inbuf_len;
+	if(len > 0)
+		*data = d->inbuf_take(len);
+	return len;
+}
 
-	while(1) {
-		nbytes = read(m_Fd, buf, 255);
+void PtyProcess::write_line(const char *line, bool addnl) {
+	if(!line)
+		return;
 
-		if(nbytes == -1) {
-			if (errno == EINTR && block)
-				continue;
-			break; 
-		}
+	int len = strlen(line);
 
-		if(nbytes == 0)
-			break;
+	if(len > 0)
+		write(m_Fd, line, len);
 
-		buf[nbytes] = '\000';
+	if(addnl)
+		write(m_Fd, "\n", 1);
+}
 
-		if (m_Inbuf) 
-			m_Inbuf = (char*)realloc(m_Inbuf, strlen(m_Inbuf) + nbytes + 1);
-		else {
-			m_Inbuf = (char*)malloc(nbytes + 1);
-			m_Inbuf[0] = 0;
-		}
+void PtyProcess::unread_line(const char *line, bool addnl) {
+	E_RETURN_IF_FAIL(line != NULL);
+
+	if(addnl)
+		d->inbuf_prepend("\n", 1);
+	d->inbuf_prepend(line, strlen(line));
+}
+
+void PtyProcess::set_async(PtyProcessDataCallback data_cb, PtyProcessExitCallback exit_cb, void *arg) {
+	d->data_cb = data_cb;
+	d->exit_cb = exit_cb;
+	d->cb_arg = arg;
 
-		strcat(m_Inbuf, buf);
-		ret = strdup(m_Inbuf);
+	async_watch(data_cb || exit_cb);
+}
 
-		// only one line...
-		pos = strpos(ret,'\n');
-		if (pos != -1) { 
-			free (m_Inbuf);
-			m_Inbuf = strdup(ret + pos + 1);
-			ret[pos+1] = '\0';
+void PtyProcess::async_watch(bool on) {
+	if(on) {
+		if(!d->fd_watched && m_Fd >= 0 && m_Pid > 0) {
+			listener_add_fd(m_Fd, async_fd_cb, this);
+			d->fd_watched = true;
 		}
 
-		break;
+		return;
 	}
 
-	return ret;
+	if(d->fd_watched) {
+		listener_remove_fd(m_Fd);
+		d->fd_watched = false;
+	}
+
+	listener_remove_timeout(async_exit_cb, this);
 }
 
-void PtyProcess::write_line(const char *line, bool addnl) {
-	if(!line)
-		return;
+void PtyProcess::async_fd_cb(int fd, void *arg) {
+	PtyProcess *self = (PtyProcess*)arg;
+	PtyProcessPrivate *d = self->d;
+	int ret;
 
-	int len = strlen(line);
+	while((ret = d->inbuf_fill(fd, false)) > 0)
+		;
 
-	if(len > 0)
-		write(m_Fd, line, len);
+	/* EIO or EOF means all slave descriptors were closed */
+	bool hangup = (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR));
 
-	if(addnl)
-		write(m_Fd, "\n", 1);
+	if(d->data_cb && d->inbuf_len) {
+		int len = d->inbuf_len;
+		const char *data = d->inbuf_take(len);
+
+		d->data_cb(self, data, len, d->cb_arg);
+	}
+
+	if(hangup) {
+		listener_remove_fd(fd);
+		d->fd_watched = false;
+
+		async_exit_cb(self);
+	}
 }
 
-void PtyProcess::unread_line(const char *line, bool addnl) {
-	char *tmp = (char*) malloc(strlen(line) + 1);
-	strcpy(tmp,line);
-	if(addnl)
-		strcat(tmp, "\n");
-
-	if (m_Inbuf) {
-		char *tmp2 = (char*)malloc(strlen(m_Inbuf) + strlen(tmp) + 1);
-		strcpy(tmp2,tmp);
-		strcat(tmp2,m_Inbuf);
-
-		free(m_Inbuf);
-		m_Inbuf = tmp2;
-		free(tmp);
-	} else 
-		m_Inbuf = tmp;
+void PtyProcess::async_exit_cb(void *arg) {
+	PtyProcess *self = (PtyProcess*)arg;
+
+	/* program can still run for a short time after terminal was closed */
+	int status = check_pid_exited(self->m_Pid);
+	if(status == NotExited) {
+		listener_add_timeout(EXIT_POLL_INTERVAL, async_exit_cb, self);
+		return;
+	}
+
+	/* reaped, so destructor must not signal it */
+	self->m_Pid = 0;
+
+	/* must be the last thing, as callback can delete us */
+	if(self->d->exit_cb)
+		self->d->exit_cb(self, status, self->d->cb_arg);
 }
 
 /*
@@ -325,6 +488,9 @@ int PtyProcess::exec(const char *command, const char **args) {
 	// Parent
 	if(m_Pid) {
 		close(slave);
+
+		if(d->data_cb || d->exit_cb)
+			async_watch(true);
 		return 0;
 	}
 
@@ -447,18 +613,15 @@ int PtyProcess::wait_for_child(void) {
 		}
 		
 		if(ret) {
-			int len;
-
-			for(char* line = read_line(false); line && strlen(line) > 0; line = read_line(false)) {
-				if(m_Exit) {
-					len = strlen(m_Exit);
+			const char *line;
+			int len, exit_len = m_Exit ? strlen(m_Exit) : 0;
 
-					if(len > 0 && !strncasecmp(line, m_Exit, len))
-						kill(m_Pid, SIGTERM);
-				}
+			for(len = read_line_span(&line, false); len > 0; len = read_line_span(&line, false)) {
+				if(exit_len > 0 && len >= exit_len && !strncasecmp(line, m_Exit, exit_len))
+					kill(m_Pid, SIGTERM);
 
 				if(m_bTerminal) {
-					fputs(line, stdout);
+					fwrite(line, 1, len, stdout);
 					fputc('\n', stdout);
 				}
 			}
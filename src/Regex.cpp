@@ -16,24 +16,128 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <string.h>
 #include <stdio.h>
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 #include <edelib/Regex.h>
+#include <edelib/StrUtil.h>
 #include <edelib/Debug.h>
 
 #include "pcre/pcre.h"
+#include "HashTable.h"
 
 #define VECTOR_COUNT 48 /* max sub expressions in PCRE, 16 * 3 */
 
+#define CACHE_SIZE_DEFAULT 64
+#define CACHE_TABLE_SIZE   128 /* power of 2 */
+
 EDELIB_NS_BEGIN
 
+/* compiled and studied pattern; shared between Regex objects compiled with the same pattern and flags */
+struct RegexPattern {
+	String        pattern;
+	int           mode;
+	unsigned int  hash;
+	pcre*         re;
+	pcre_extra*   extra;
+	int           refs;
+
+	RegexPattern* hnext;
+	RegexPattern* prev;
+	RegexPattern* next;
+};
+
 struct RegexData {
-	pcre*  ppattern;
-	String error;
-	int    ovector[VECTOR_COUNT];
+	RegexPattern* pat;
+	String        error;
+	int           ovector[VECTOR_COUNT];
 };
 
+/* 
+ * Process-wide cache of compiled patterns. Patterns are kept in the most recently used order;
+ * the cache holds one reference to each of them, so patterns in use survive eviction.
+ */
+static RegexPattern* cache_table[CACHE_TABLE_SIZE];
+static unsigned int  cache_count;
+static unsigned int  cache_max = CACHE_SIZE_DEFAULT;
+
+static LruList<RegexPattern> cache_lru;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+# define CACHE_LOCK   pthread_mutex_lock(&cache_lock)
+# define CACHE_UNLOCK pthread_mutex_unlock(&cache_lock)
+#else
+# define CACHE_LOCK
+# define CACHE_UNLOCK
+#endif
+
+static unsigned int pattern_hash(const char* pattern, int mode) {
+	return str_hash(pattern) ^ ((unsigned int)mode * 2654435761U);
+}
+
+/* must be called with lock held */
+static void pattern_unref(RegexPattern* p) {
+	if(--p->refs > 0)
+		return;
+
+	if(p->extra)
+		pcre_free(p->extra);
+	pcre_free(p->re);
+	delete p;
+}
+
+static void cache_unlink(RegexPattern* p) {
+	RegexPattern** pp = &cache_table[p->hash & (CACHE_TABLE_SIZE - 1)];
+	while(*pp != p)
+		pp = &(*pp)->hnext;
+	*pp = p->hnext;
+
+	cache_lru.unlink(p);
+	cache_count--;
+}
+
+static RegexPattern* cache_find(const char* pattern, int mode, unsigned int hash) {
+	RegexPattern* p = cache_table[hash & (CACHE_TABLE_SIZE - 1)];
+
+	for(; p; p = p->hnext) {
+		if(p->hash == hash && p->mode == mode && p->pattern == pattern)
+			break;
+	}
+
+	if(p)
+		cache_lru.touch(p);
+
+	return p;
+}
+
+static void cache_add(RegexPattern* p) {
+	if(cache_max == 0)
+		return;
+
+	while(cache_count >= cache_max) {
+		RegexPattern* old = cache_lru.tail;
+		cache_unlink(old);
+		pattern_unref(old);
+	}
+
+	RegexPattern** bucket = &cache_table[p->hash & (CACHE_TABLE_SIZE - 1)];
+	p->hnext = *bucket;
+	*bucket = p;
+
+	cache_lru.push_front(p);
+	cache_count++;
+	p->refs++;
+}
+
 static int convert_match_mode(int match_mode) {
 	if(match_mode == 0)
 		return match_mode;
@@ -56,21 +160,43 @@ Regex::Regex() : data(0) { }
 
 Regex::~Regex() {
 	if(data) {
-		if(data->ppattern)
-			pcre_free(data->ppattern);
+		clear();
 		delete data;
 	}
 }
 
+void Regex::clear(void) {
+	if(!data->pat)
+		return;
+
+	CACHE_LOCK;
+	pattern_unref(data->pat);
+	CACHE_UNLOCK;
+
+	data->pat = 0;
+}
+
+void Regex::cache_size(unsigned int n) {
+	CACHE_LOCK;
+
+	while(cache_lru.tail) {
+		RegexPattern* old = cache_lru.tail;
+		cache_unlink(old);
+		pattern_unref(old);
+	}
+
+	cache_max = n;
+	CACHE_UNLOCK;
+}
+
 bool Regex::compile(const char* pattern, int m) {
 	E_ASSERT(pattern != NULL);
 
 	if(!data) {
 		data = new RegexData;
-		data->ppattern = 0;
+		data->pat = 0;
 	} else {
-		if(data->ppattern)
-			pcre_free(data->ppattern);
+		clear();
 	}
 
 	int mode = 0;
@@ -88,34 +214,64 @@ bool Regex::compile(const char* pattern, int m) {
 	if(m & RX_UNGREEDY)
 		mode |= PCRE_UNGREEDY;
 
+	unsigned int hash = pattern_hash(pattern, mode);
+
+	CACHE_LOCK;
+	RegexPattern* p = cache_find(pattern, mode, hash);
+	if(p)
+		p->refs++;
+	CACHE_UNLOCK;
+
+	if(p) {
+		data->pat = p;
+		return true;
+	}
+
 	const char* errstr;
 	int			erroffset;
 
-	data->ppattern = pcre_compile(pattern, mode, &errstr, &erroffset, NULL);
+	pcre* re = pcre_compile(pattern, mode, &errstr, &erroffset, NULL);
 
-	if(data->ppattern == NULL) {
+	if(re == NULL) {
 		data->error = errstr;
 		return false;
 	}
 
+	/* 
+	 * study will find the set of possible starting bytes, so pcre_exec() can skip to them
+	 * directly; NULL is returned for patterns that don't benefit from it (e.g. anchored)
+	 */
+	p = new RegexPattern;
+	p->pattern = pattern;
+	p->mode = mode;
+	p->hash = hash;
+	p->re = re;
+	p->extra = pcre_study(re, 0, &errstr);
+	p->refs = 1;
+
+	CACHE_LOCK;
+	cache_add(p);
+	CACHE_UNLOCK;
+
+	data->pat = p;
 	return true;
 }
 
 Regex::operator bool(void) const {
-	return (data != NULL && data->ppattern != NULL);
+	return (data != NULL && data->pat != NULL);
 }
 
 int Regex::match(const char* str, int match_mode, int start, int len, MatchVec* matches) {
 	E_ASSERT(data != NULL && "Did you run compile() first?");
 	E_ASSERT(str  != NULL);
 
-	E_RETURN_VAL_IF_FAIL(data->ppattern != NULL, -1);
+	E_RETURN_VAL_IF_FAIL(data->pat != NULL, -1);
 
 	if(len < 0)
 		len = strlen(str);
 
 	int mode = convert_match_mode(match_mode);
-	int ret = pcre_exec(data->ppattern, NULL, str, len, start, mode, data->ovector, VECTOR_COUNT);
+	int ret = pcre_exec(data->pat->re, data->pat->extra, str, len, start, mode, data->ovector, VECTOR_COUNT);
 
 	if(ret < 1)
 		return ret;
@@ -133,27 +289,93 @@ int Regex::match(const char* str, int match_mode, int start, int len, MatchVec*
 	return ret;
 }
 
-int Regex::split(const char* str, list<String>& ls, int match_mode) {
-	MatchVec matches;
-	MatchVec::iterator it;
-	String   s;
-	int      ret;
-	int      len = strlen(str);
+int Regex::match(const char* str, int match_mode, int start, int len, RegexMatch* matches, int n) {
+	E_ASSERT(data != NULL && "Did you run compile() first?");
+	E_ASSERT(str  != NULL);
+
+	E_RETURN_VAL_IF_FAIL(data->pat != NULL, -1);
+
+	if(len < 0)
+		len = strlen(str);
+
+	int mode = convert_match_mode(match_mode);
+	int ret = pcre_exec(data->pat->re, data->pat->extra, str, len, start, mode, data->ovector, VECTOR_COUNT);
+
+	for(int i = 0; i < ret && i < n; i++) {
+		matches[i].offset = data->ovector[i * 2];
+		matches[i].length = data->ovector[i * 2 + 1] - matches[i].offset;
+	}
+
+	return ret;
+}
+
+int Regex::match_all(const char* str, RegexMatchCallback* cb, void* udata, int match_mode, int start, int len) {
+	E_ASSERT(data != NULL && "Did you run compile() first?");
+	E_ASSERT(str  != NULL);
+	E_ASSERT(cb   != NULL);
+
+	E_RETURN_VAL_IF_FAIL(data->pat != NULL, 0);
+
+	if(len < 0)
+		len = strlen(str);
+
+	RegexMatch m[VECTOR_COUNT / 3];
+	int mode = convert_match_mode(match_mode), retry = 0, ret, count = 0;
+
+	while(start <= len) {
+		ret = pcre_exec(data->pat->re, data->pat->extra, str, len, start, mode | retry, data->ovector, VECTOR_COUNT);
+
+		if(ret == PCRE_ERROR_NOMATCH && retry) {
+			/* there is no non-empty match at the place of empty one, so move forward */
+			retry = 0;
+			start++;
+			continue;
+		}
+
+		if(ret < 0)
+			break;
+
+		/* more groups than ovector can hold; report those we have */
+		if(ret == 0)
+			ret = VECTOR_COUNT / 3;
+
+		for(int i = 0; i < ret; i++) {
+			m[i].offset = data->ovector[i * 2];
+			m[i].length = data->ovector[i * 2 + 1] - m[i].offset;
+		}
+
+		count++;
+		if(!cb(str, m, ret, udata))
+			break;
+
+		/* after empty match, try non-empty one at the same place (as perl does), or it will loop forever */
+		retry = (m[0].length == 0) ? (PCRE_NOTEMPTY | PCRE_ANCHORED) : 0;
+		start = m[0].offset + m[0].length;
+	}
+
+	return count;
+}
+
+typedef void (SplitFunc)(const char* str, int offset, int length, void* data);
+
+/* find items split by pattern and report them to func; returns number of items */
+static int split_items(Regex& rx, const char* str, int match_mode, SplitFunc* func, void* data) {
+	RegexMatch m;
+	int        ret, count = 0;
+	int        len = strlen(str);
 	/*
 	 * ppos is used to protect loop against nasty expressions which could put it to infinity 
 	 * (eg. '[a-zA-Z]*' on 'abc 234 abc') -10 is random value since search() return -2 >=
 	 */
-	int      pos = 0, ppos = -10;
+	int        pos = 0, ppos = -10;
 
 	while(1) {
-		matches.clear();
-
-		ret = match(str, match_mode, pos, len, &matches);
+		ret = rx.match(str, match_mode, pos, len, &m, 1);
 		if(ret < 1) {
 			/* pick up the last match */
 			if(pos > 0) {
-				s.assign(&str[pos]);
-				ls.push_back(s);
+				func(str, pos, len - pos, data);
+				count++;
 			}
 
 			break;
@@ -164,24 +386,60 @@ int Regex::split(const char* str, list<String>& ls, int match_mode) {
 		else
 			ppos = pos;
 
-		/* now pickup the first mach because it is the full match */
-		it = matches.begin();
-
 		/* should never happen, but you never know */
-		if((*it).offset < pos) {
-			E_WARNING(E_STRLOC ": Unable to correctly calculate length of the match (%i %i)\n", (*it).offset, pos);
+		if(m.offset < pos) {
+			E_WARNING(E_STRLOC ": Unable to correctly calculate length of the match (%i %i)\n", m.offset, pos);
 			continue;
 		}
 
-		s.assign(&str[pos], (*it).offset - pos);
-		ls.push_back(s);
+		func(str, pos, m.offset - pos, data);
+		count++;
+
+		pos = m.offset + m.length;
+	}
+
+	return count;
+}
+
+static void split_to_list(const char* str, int offset, int length, void* data) {
+	list<String>* ls = (list<String>*)data;
+	String s;
+
+	s.assign(str + offset, length);
+	ls->push_back(s);
+}
+
+struct SplitSpans {
+	RegexMatch* spans;
+	int         n;
+	int         count;
+};
+
+static void split_to_spans(const char*, int offset, int length, void* data) {
+	SplitSpans* sp = (SplitSpans*)data;
 
-		pos = (*it).offset + (*it).length;
+	if(sp->count < sp->n) {
+		sp->spans[sp->count].offset = offset;
+		sp->spans[sp->count].length = length;
 	}
 
+	sp->count++;
+}
+
+int Regex::split(const char* str, list<String>& ls, int match_mode) {
+	split_items(*this, str, match_mode, split_to_list, &ls);
 	return ls.size();
 }
 
+int Regex::split(const char* str, RegexMatch* spans, int n, int match_mode) {
+	SplitSpans sp;
+	sp.spans = spans;
+	sp.n = n;
+	sp.count = 0;
+
+	return split_items(*this, str, match_mode, split_to_spans, &sp);
+}
+
 const char* Regex::strerror(void) const {
 	E_ASSERT(data != NULL && "Did you run compile() first?");
 	return data->error.c_str();
@@ -17,6 +17,10 @@
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -40,11 +44,27 @@
 # include <signal.h>      /* signal() */
 #endif
 
+#include <signal.h>
+
+#ifdef HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif
+
+extern char** environ;
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 #include <edelib/Run.h>
+#include <edelib/String.h>
+#include <edelib/List.h>
+#include <edelib/Listener.h>
 #include <edelib/Missing.h>
 #include <edelib/Debug.h>
 
 #define CMD_BUFSZ 128
+#define PATH_CACHE_SIZE 32
 
 EDELIB_NS_BEGIN
 
@@ -103,6 +123,7 @@ static void close_and_invalidate(int* fd) {
 	*fd = -1;
 }
 
+#ifndef HAVE_POSIX_SPAWN
 static void write_int(int fd, int val) {
 	E_RETURN_IF_FAIL(fd != -1);
 
@@ -120,6 +141,7 @@ static void write_int(int fd, int val) {
 		}
 	}
 }
+#endif
 
 static bool read_ints(int fd, int* buf, int bufsz, int* int_read) {
 	E_RETURN_VAL_IF_FAIL(fd != -1, false);
@@ -153,6 +175,309 @@ static bool read_ints(int fd, int* buf, int bufsz, int* int_read) {
 	return true;
 }
 
+/* 
+ * Programs found in PATH; launchers start the same programs over and over, so PATH is not scanned
+ * each time. Cache is dropped when PATH is changed, and entry is checked before use.
+ */
+struct PathCacheEntry {
+	String name;
+	String path;
+};
+
+static PathCacheEntry path_cache[PATH_CACHE_SIZE];
+static unsigned int   path_cache_next;
+static String         path_cache_env;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t path_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+# define PATH_CACHE_LOCK   pthread_mutex_lock(&path_cache_lock)
+# define PATH_CACHE_UNLOCK pthread_mutex_unlock(&path_cache_lock)
+#else
+# define PATH_CACHE_LOCK
+# define PATH_CACHE_UNLOCK
+#endif
+
+static bool path_cache_find(const char* path_env, const char* name, char* out, int outsz) {
+	bool found = false;
+
+	PATH_CACHE_LOCK;
+
+	if(path_cache_env != path_env) {
+		for(int i = 0; i < PATH_CACHE_SIZE; i++) {
+			path_cache[i].name.clear();
+			path_cache[i].path.clear();
+		}
+
+		path_cache_env = path_env;
+	}
+
+	for(int i = 0; i < PATH_CACHE_SIZE; i++) {
+		if(path_cache[i].name == name) {
+			/* program can be removed in the meantime */
+			if(access(path_cache[i].path.c_str(), X_OK) == 0) {
+				strncpy(out, path_cache[i].path.c_str(), outsz);
+				out[outsz - 1] = '\0';
+				found = true;
+			} else {
+				path_cache[i].name.clear();
+			}
+
+			break;
+		}
+	}
+
+	PATH_CACHE_UNLOCK;
+	return found;
+}
+
+static void path_cache_add(const char* path_env, const char* name, const char* path) {
+	PATH_CACHE_LOCK;
+
+	if(path_cache_env == path_env) {
+		PathCacheEntry& e = path_cache[path_cache_next];
+		e.name = name;
+		e.path = path;
+		path_cache_next = (path_cache_next + 1) % PATH_CACHE_SIZE;
+	}
+
+	PATH_CACHE_UNLOCK;
+}
+
+/* find full path of program, the same way exec_cmd() did by trying each PATH component; returns 0 or errno */
+static int program_resolve(const char* name, char* out, int outsz) {
+	if(strchr(name, '/') != NULL) {
+		strncpy(out, name, outsz);
+		out[outsz - 1] = '\0';
+		return 0;
+	}
+
+	const char* path = getenv("PATH");
+	if(!path) {
+		/* in glib was stated that '.' is put last for security so I'm using that here too */
+		path = "/bin:/usr/bin:.";
+	}
+
+	if(path_cache_find(path, name, out, outsz))
+		return 0;
+
+	int         err = ENOENT;
+	struct stat st;
+	const char* p = path, *sep;
+	int         len;
+
+	for(; *p; p = sep + 1) {
+		sep = strchr(p, ':');
+		if(!sep)
+			sep = p + strlen(p);
+
+		len = sep - p;
+		if(len > 0) {
+			snprintf(out, outsz, "%.*s/%s", len, p, name);
+
+			if(access(out, X_OK) == 0 && stat(out, &st) == 0 && !S_ISDIR(st.st_mode)) {
+				path_cache_add(path, name, out);
+				return 0;
+			}
+
+			/* not executable here; remember it, but look further as execvp() does */
+			if(errno == EACCES)
+				err = EACCES;
+		}
+
+		if(!*sep)
+			break;
+	}
+
+	return err;
+}
+
+/* 
+ * child is created with vfork() when possible, as it only calls async-signal-safe functions and
+ * exec or exit, so parent page tables are not copied
+ */
+#ifdef HAVE_VFORK
+# define SPAWN_FORK vfork
+#else
+# define SPAWN_FORK fork
+#endif
+
+static int open_null_dev(void) {
+	int fd = open("/dev/null", O_RDWR);
+	if(fd != -1)
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+}
+
+/*
+ * Programs started without waiting for them are our children and they are reaped from SIGCHLD
+ * handler. Handler only touches registered children and then calls previous handler, so children
+ * started by application itself are left to it.
+ *
+ * Nodes are never freed, only reused, so handler can walk the list while it is changed; node is
+ * taken by setting its pid as the last thing. Nodes are changed only with SIGCHLD blocked.
+ */
+struct ReapNode {
+	volatile pid_t        pid;      /* 0 if node is free */
+	volatile int          status;   /* waitpid() status or -1 if it is unknown */
+	volatile sig_atomic_t done;     /* set by handler when child is reaped */
+	volatile sig_atomic_t detached; /* nobody waits for the child; node is freed when it is reaped */
+	RunProcessPrivate    *owner;
+	ReapNode             *next;
+};
+
+static ReapNode* volatile reap_list = NULL;
+static struct sigaction  reap_old_action;
+static bool              reap_ready = false;
+
+/* handler wakes up listener through this pipe when RunProcess program exits */
+static int               reap_pipe[2] = {-1, -1};
+static unsigned int      reap_watched = 0;
+
+static void reap_pipe_cb(int fd, void*);
+
+static void reap_sweep(void) {
+	int   status;
+	pid_t pid, ret;
+	bool  found = false;
+
+	for(ReapNode* n = reap_list; n; n = n->next) {
+		pid = n->pid;
+		if(pid <= 0 || n->done)
+			continue;
+
+		while((ret = waitpid(pid, &status, WNOHANG)) == -1 && errno == EINTR)
+			;
+
+		if(ret == 0)
+			continue;
+
+		/* reaped by someone else; exit status is lost */
+		if(ret == -1)
+			status = -1;
+
+		if(n->detached) {
+			n->pid = 0;
+		} else {
+			n->status = status;
+			n->done = 1;
+			found = true;
+		}
+	}
+
+	/* wake up listener for RunProcess; if pipe is full, it is already woken */
+	if(found && reap_pipe[1] != -1) {
+		char c = 0;
+		ssize_t wret = write(reap_pipe[1], &c, 1);
+		(void)wret;
+	}
+}
+
+static void reap_sigchld(int sig, siginfo_t* info, void* ctx) {
+	int saved = errno;
+
+	reap_sweep();
+
+	if(reap_old_action.sa_flags & SA_SIGINFO) {
+		if(reap_old_action.sa_sigaction)
+			reap_old_action.sa_sigaction(sig, info, ctx);
+	} else if(reap_old_action.sa_handler != SIG_DFL && reap_old_action.sa_handler != SIG_IGN) {
+		reap_old_action.sa_handler(sig);
+	}
+
+	errno = saved;
+}
+
+static bool reap_init(void) {
+	if(reap_ready)
+		return true;
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sigaction(SIGCHLD, NULL, &reap_old_action);
+
+	sa.sa_sigaction = reap_sigchld;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_SIGINFO | SA_RESTART | (reap_old_action.sa_flags & (SA_NOCLDSTOP | SA_NOCLDWAIT));
+
+	if(!(reap_old_action.sa_flags & SA_SIGINFO)) {
+		/* children application ignored must not become zombies */
+		if(reap_old_action.sa_handler == SIG_IGN)
+			sa.sa_flags |= SA_NOCLDWAIT;
+
+		if(reap_old_action.sa_handler == SIG_IGN || reap_old_action.sa_handler == SIG_DFL)
+			sa.sa_flags |= SA_NOCLDSTOP;
+	}
+
+	if(sigaction(SIGCHLD, &sa, NULL) != 0) {
+		E_WARNING(E_STRLOC ": unable to install SIGCHLD handler (%s)\n", strerror(errno));
+		return false;
+	}
+
+	reap_ready = true;
+	return true;
+}
+
+/* start reporting exits of RunProcess programs to listener */
+static bool reap_watch_start(void) {
+	if(reap_pipe[0] == -1) {
+		if(pipe(reap_pipe) != 0) {
+			E_WARNING(E_STRLOC ": pipe() failed with '%s'\n", strerror(errno));
+			return false;
+		}
+
+		for(int i = 0; i < 2; i++) {
+			fcntl(reap_pipe[i], F_SETFD, FD_CLOEXEC);
+			fcntl(reap_pipe[i], F_SETFL, fcntl(reap_pipe[i], F_GETFL) | O_NONBLOCK);
+		}
+	}
+
+	/* registered only while there are programs, so listener_wait() is not woken for nothing */
+	if(reap_watched++ == 0)
+		listener_add_fd(reap_pipe[0], reap_pipe_cb, NULL);
+
+	return true;
+}
+
+static void reap_watch_stop(void) {
+	E_RETURN_IF_FAIL(reap_watched > 0);
+
+	if(--reap_watched == 0)
+		listener_remove_fd(reap_pipe[0]);
+}
+
+/* register child to be reaped; must be called with SIGCHLD blocked */
+static ReapNode* reap_add(pid_t pid, RunProcessPrivate* owner) {
+	ReapNode* n;
+
+	for(n = reap_list; n; n = n->next) {
+		if(n->pid == 0)
+			break;
+	}
+
+	if(!n) {
+		n = (ReapNode*)malloc(sizeof(ReapNode));
+		if(!n) {
+			E_WARNING(E_STRLOC ": unable to register child %i\n", (int)pid);
+			return NULL;
+		}
+
+		n->pid = 0;
+		n->next = reap_list;
+		reap_list = n;
+	}
+
+	n->owner = owner;
+	n->status = 0;
+	n->done = 0;
+	n->detached = owner ? 0 : 1;
+	n->pid = pid;
+
+	/* child could exit before it was registered, while signal was delivered to another thread */
+	reap_sweep();
+	return n;
+}
+
+#ifndef HAVE_POSIX_SPAWN
 static void exec_cmd_via_shell(char* program, char** args, int count) {
 	char** new_args = (char**)malloc(sizeof(char*) * count + 2);
 
@@ -434,6 +759,180 @@ static int fork_child_sync(const char* cmd) {
 	return ret;
 }
 
+#else /* HAVE_POSIX_SPAWN */
+
+/* everything needed to start a program, prepared before posix_spawn() */
+struct SpawnData {
+	char   path[PATH_MAX];
+	char** args;
+	char** sh_args;
+	int    count;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t          attr;
+	bool                       actions_init;
+	bool                       attr_init;
+};
+
+static void spawn_data_free(SpawnData* sd) {
+	if(sd->args) {
+		for(int i = 0; sd->args[i]; i++)
+			free(sd->args[i]);
+		free(sd->args);
+	}
+
+	free(sd->sh_args);
+
+	if(sd->actions_init)
+		posix_spawn_file_actions_destroy(&sd->actions);
+	if(sd->attr_init)
+		posix_spawnattr_destroy(&sd->attr);
+}
+
+static int spawn_data_init(const char* cmd, SpawnData* sd, int null_dev, const sigset_t* mask) {
+	sd->sh_args = NULL;
+	sd->count = 0;
+	sd->actions_init = sd->attr_init = false;
+	sd->args = cmd_split(cmd, &sd->count);
+
+	if(!sd->args || !sd->args[0])
+		return sd->args ? ENOENT : ENOMEM;
+
+	int err = program_resolve(sd->args[0], sd->path, sizeof(sd->path));
+	if(err)
+		return err;
+
+	/* in case it is a script without '#!' */
+	sd->sh_args = (char**)malloc(sizeof(char*) * (sd->count + 2));
+	if(!sd->sh_args)
+		return ENOMEM;
+
+	sd->sh_args[0] = (char*)"/bin/sh";
+	sd->sh_args[1] = sd->path;
+
+	int i, j;
+	for(i = 1, j = 2; sd->args[i]; i++, j++)
+		sd->sh_args[j] = sd->args[i];
+	sd->sh_args[j] = NULL;
+
+	/* just send stdin, stdout, stderr to null dev */
+	if((err = posix_spawn_file_actions_init(&sd->actions)) != 0)
+		return err;
+	sd->actions_init = true;
+
+	for(i = 0; i < 3; i++) {
+		if((err = posix_spawn_file_actions_adddup2(&sd->actions, null_dev, i)) != 0)
+			return err;
+	}
+
+	if((err = posix_spawnattr_init(&sd->attr)) != 0)
+		return err;
+	sd->attr_init = true;
+
+	sigset_t def;
+	sigemptyset(&def);
+	sigaddset(&def, SIGPIPE);
+
+	posix_spawnattr_setsigdefault(&sd->attr, &def);
+	posix_spawnattr_setsigmask(&sd->attr, mask);
+	posix_spawnattr_setflags(&sd->attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+	return 0;
+}
+
+static int spawn_program(SpawnData* sd, pid_t* pid) {
+	int err = posix_spawn(pid, sd->path, &sd->actions, &sd->attr, sd->args, environ);
+
+	/* execute it then via shell if failed */
+	if(err == ENOEXEC)
+		err = posix_spawn(pid, sd->sh_args[0], &sd->actions, &sd->attr, sd->sh_args, environ);
+
+	return err;
+}
+
+static int fork_child_async(const char* cmd, int* child_pid) {
+	if(!reap_init())
+		return RUN_FORK_FAILED;
+
+	int null_dev = open_null_dev();
+	if(null_dev == -1)
+		return convert_from_errno(errno, RUN_FORK_FAILED);
+
+	/* program must be registered before its SIGCHLD is handled */
+	sigset_t chld, old;
+	sigemptyset(&chld);
+	sigaddset(&chld, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &chld, &old);
+
+	SpawnData sd;
+	pid_t     pid;
+	int       err = spawn_data_init(cmd, &sd, null_dev, &old);
+
+	/*
+	 * Program is started directly, so it is our child and it is reaped from SIGCHLD handler. There is
+	 * no need for double fork, which would copy our page tables.
+	 */
+	if(!err)
+		err = spawn_program(&sd, &pid);
+
+	if(!err)
+		reap_add(pid, NULL);
+
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	close(null_dev);
+	spawn_data_free(&sd);
+
+	if(err)
+		return convert_from_errno(err, RUN_EXECVE_FAILED);
+
+	if(child_pid)
+		*child_pid = pid;
+
+	return 0;
+}
+
+static int fork_child_sync(const char* cmd) {
+	int null_dev = open_null_dev();
+	if(null_dev == -1)
+		return RUN_FORK_FAILED;
+
+	sigset_t mask;
+	sigprocmask(SIG_SETMASK, NULL, &mask);
+
+	SpawnData sd;
+	pid_t     pid;
+	int       err = spawn_data_init(cmd, &sd, null_dev, &mask);
+
+	if(!err)
+		err = spawn_program(&sd, &pid);
+
+	close(null_dev);
+	spawn_data_free(&sd);
+
+	/* report it the same way as child exited with errno */
+	if(err)
+		return convert_from_errno(err, err);
+
+	/* parent */
+	int status, ret = -1;
+	while(waitpid(pid, &status, 0) == -1) {
+		if(errno != EINTR)
+			return RUN_WAITPID_FAILED;
+	}
+
+	if(!WIFEXITED(status))
+		ret = WEXITSTATUS(status);
+	else if(WIFSIGNALED(status))
+		ret = WTERMSIG(status);
+	else {
+		int s = WEXITSTATUS(status);
+		ret = convert_from_errno(s, s);
+	}
+
+	return ret;
+}
+
+#endif /* HAVE_POSIX_SPAWN */
+
 static int run_internal(bool async, int *child_pid, const char *fmt, va_list args) {
 	E_ASSERT(fmt != NULL);
 
@@ -476,4 +975,680 @@ int run_async(const char *fmt, ...) {
 	return ret;
 }
 
+typedef list<RunProcessPrivate*> RunJobList;
+typedef list<RunProcessPrivate*>::iterator RunJobListIter;
+
+struct RunProcessPrivate {
+	RunProcess *self;
+	char      **argv;
+	char      **envp;
+	char       *dir;
+	int         which;
+
+	RunOutputCallback output_cb;
+	RunExitCallback   exit_cb;
+	void             *arg;
+
+	pid_t pid;
+	int   status;
+
+	/* parent ends of stdin, stdout and stderr pipes or -1 */
+	int   fds[3];
+
+	/* data queued for stdin; closed when everything is written if stdin_close is set */
+	String       inbuf;
+	unsigned int inbuf_pos;
+	bool         stdin_close;
+
+	/* output collected when there is no output callback */
+	String out[2];
+
+	RunQueuePrivate *queue;
+
+	/* reaper entry while program is running */
+	ReapNode *reap;
+};
+
+struct RunQueuePrivate {
+	unsigned int max_jobs;
+	bool         scheduling;
+	RunJobList   waiting;
+	RunJobList   active;
+};
+
+static void queue_job_done(RunQueuePrivate *q, RunProcessPrivate *p);
+
+static char **strv_dup(const char **v) {
+	if(!v)
+		return NULL;
+
+	int n = 0;
+	while(v[n])
+		n++;
+
+	char **ret = (char**)malloc(sizeof(char*) * (n + 1));
+	for(int i = 0; i < n; i++)
+		ret[i] = strdup(v[i]);
+	ret[n] = NULL;
+
+	return ret;
+}
+
+static void strv_free(char **v) {
+	if(!v)
+		return;
+
+	for(int i = 0; v[i]; i++)
+		free(v[i]);
+	free(v);
+}
+
+/* write to pipe without getting SIGPIPE if program closed its end */
+static int write_nosigpipe(int fd, const char *data, unsigned int len) {
+	sigset_t pipe_set, old, pending;
+	sigemptyset(&pipe_set);
+	sigaddset(&pipe_set, SIGPIPE);
+
+	sigprocmask(SIG_BLOCK, &pipe_set, &old);
+	sigpending(&pending);
+
+	bool was_pending = sigismember(&pending, SIGPIPE);
+	int  ret = write(fd, data, len);
+	int  err = errno;
+
+	/* discard SIGPIPE we generated */
+	if(ret == -1 && err == EPIPE && !was_pending) {
+		struct timespec ts = {0, 0};
+		sigtimedwait(&pipe_set, NULL, &ts);
+	}
+
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	errno = err;
+	return ret;
+}
+
+static void process_close_stdin(RunProcessPrivate *p) {
+	if(p->fds[0] != -1) {
+		listener_remove_fd(p->fds[0], LISTENER_WRITE);
+		close_and_invalidate(&p->fds[0]);
+	}
+
+	p->inbuf.clear();
+	p->inbuf_pos = 0;
+}
+
+/* stop monitoring program and close pipes */
+static void process_unwatch(RunProcessPrivate *p) {
+	process_close_stdin(p);
+
+	for(int i = 1; i < 3; i++) {
+		if(p->fds[i] != -1) {
+			listener_remove_fd(p->fds[i]);
+			close_and_invalidate(&p->fds[i]);
+		}
+	}
+}
+
+static void process_finish(RunProcessPrivate *p, int status) {
+	process_unwatch(p);
+
+	p->pid = 0;
+	p->status = status;
+
+	RunQueuePrivate *q = p->queue;
+	p->queue = NULL;
+
+	if(q)
+		queue_job_done(q, p);
+
+	/* must be the last thing, as callback can delete us */
+	if(p->exit_cb)
+		p->exit_cb(p->self, status, p->arg);
+}
+
+/* read once from stdout or stderr; returns number of bytes, 0 if pipe was closed or -1 if it is empty */
+static int process_read(RunProcessPrivate *p, int idx) {
+	char buf[16384];
+	int  n;
+
+	while((n = read(p->fds[idx], buf, sizeof(buf))) == -1 && errno == EINTR)
+		;
+
+	if(n > 0) {
+		if(p->output_cb)
+			p->output_cb(p->self, idx == 1 ? RUN_PIPE_STDOUT : RUN_PIPE_STDERR, buf, n, p->arg);
+		else
+			p->out[idx - 1].append(buf, n);
+		return n;
+	}
+
+	if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return -1;
+
+	listener_remove_fd(p->fds[idx]);
+	close_and_invalidate(&p->fds[idx]);
+	return 0;
+}
+
+static void process_read_cb(int fd, void *arg) {
+	RunProcessPrivate *p = (RunProcessPrivate*)arg;
+
+	/* listener will call us again if there is more */
+	process_read(p, (fd == p->fds[1]) ? 1 : 2);
+}
+
+/* program was reaped; 'status' is from waitpid() or -1 if it is unknown */
+static void process_exited(RunProcessPrivate *p, int status) {
+	p->reap = NULL;
+
+	if(status == -1)
+		status = RUN_WAITPID_FAILED;
+	else if(WIFSIGNALED(status))
+		status = 128 + WTERMSIG(status);
+	else
+		status = WEXITSTATUS(status);
+
+	/* output written before exit is still in pipes */
+	for(int i = 1; i < 3; i++) {
+		while(p->fds[i] != -1 && process_read(p, i) > 0)
+			;
+	}
+
+	process_finish(p, status);
+}
+
+static void reap_pipe_cb(int fd, void*) {
+	char buf[64];
+	while(read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	sigset_t chld, old;
+	sigemptyset(&chld);
+	sigaddset(&chld, SIGCHLD);
+
+	/* take one program at a time, since exit callback can start or destroy others */
+	while(1) {
+		RunProcessPrivate *p = NULL;
+		int status = 0;
+
+		sigprocmask(SIG_BLOCK, &chld, &old);
+
+		for(ReapNode *n = reap_list; n; n = n->next) {
+			if(n->pid > 0 && n->done && n->owner) {
+				p = n->owner;
+				status = n->status;
+
+				n->owner = NULL;
+				n->pid = 0;
+				reap_watch_stop();
+				break;
+			}
+		}
+
+		sigprocmask(SIG_SETMASK, &old, NULL);
+
+		if(!p)
+			break;
+
+		process_exited(p, status);
+	}
+}
+
+/* object is destroyed while program is running; stop it and leave it to reaper */
+static void process_kill(RunProcessPrivate *p) {
+	ReapNode *n = p->reap;
+
+	kill(p->pid, SIGTERM);
+
+	/* give it a moment to exit cleanly */
+	for(int i = 0; i < 10 && !n->done; i++)
+		usleep(5000);
+
+	sigset_t chld, old;
+	sigemptyset(&chld);
+	sigaddset(&chld, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &chld, &old);
+
+	if(!n->done) {
+		kill(p->pid, SIGKILL);
+		n->owner = NULL;
+		n->detached = 1;
+		reap_sweep();
+	}
+
+	/* already reaped, before or after it was detached */
+	if(n->done) {
+		n->owner = NULL;
+		n->pid = 0;
+	}
+
+	reap_watch_stop();
+	sigprocmask(SIG_SETMASK, &old, NULL);
+
+	p->reap = NULL;
+	p->pid = 0;
+}
+
+static void process_write_cb(int fd, void *arg) {
+	RunProcessPrivate *p = (RunProcessPrivate*)arg;
+	unsigned int left = p->inbuf.length() - p->inbuf_pos;
+
+	if(left) {
+		int n = write_nosigpipe(fd, p->inbuf.c_str() + p->inbuf_pos, left);
+
+		if(n > 0) {
+			p->inbuf_pos += n;
+		} else if(n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			/* program does not read any more */
+			process_close_stdin(p);
+			return;
+		}
+	}
+
+	if(p->inbuf_pos < p->inbuf.length())
+		return;
+
+	p->inbuf.clear();
+	p->inbuf_pos = 0;
+
+	if(p->stdin_close)
+		process_close_stdin(p);
+	else
+		listener_remove_fd(fd, LISTENER_WRITE);
+}
+
+/* 
+ * Runs in child; it can share memory with parent so only async-signal-safe functions are used.
+ * Error is reported via 'err_fd', which is closed on successful exec.
+ */
+static void process_child(const char *path, char **argv, char **sh_args, char **envp, const char *dir, 
+						  int *child_fds, int err_fd, const sigset_t *mask)
+{
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		if(child_fds[i] == i)
+			fcntl(i, F_SETFD, 0);
+		else if(dup2(child_fds[i], i) == -1)
+			goto fail;
+	}
+
+	if(dir && chdir(dir) != 0)
+		goto fail;
+
+	signal(SIGPIPE, SIG_DFL);
+	sigprocmask(SIG_SETMASK, mask, NULL);
+
+	execve(path, argv, envp);
+
+	/* execute it then via shell if failed */
+	if(errno == ENOEXEC)
+		execve(sh_args[0], sh_args, envp);
+
+fail:
+	i = errno;
+	write(err_fd, &i, sizeof(i));
+	_exit(127);
+}
+
+static int process_start(RunProcessPrivate *p) {
+	E_RETURN_VAL_IF_FAIL(p->argv && p->argv[0], RUN_EMPTY);
+	E_RETURN_VAL_IF_FAIL(p->pid == 0, RUN_FORK_FAILED);
+
+	char path[PATH_MAX];
+	int  err = program_resolve(p->argv[0], path, sizeof(path));
+
+	if(err)
+		return convert_from_errno(err, RUN_EXECVE_FAILED);
+
+	int pipes[3][2] = { {-1, -1}, {-1, -1}, {-1, -1} };
+	int err_pipe[2] = { -1, -1 };
+	int child_fds[3], null_dev = -1, ret, i, n;
+	pid_t pid;
+
+	/* child must not allocate memory, so shell arguments are prepared here */
+	for(n = 0; p->argv[n]; n++)
+		;
+
+	char **sh_args = (char**)malloc(sizeof(char*) * (n + 2));
+	if(!sh_args)
+		return RUN_FORK_FAILED;
+
+	sh_args[0] = (char*)"/bin/sh";
+	sh_args[1] = path;
+	for(i = 1; i <= n; i++)
+		sh_args[i + 1] = p->argv[i];
+
+	sigset_t all, old, chld_mask;
+	bool     masked = false, watching = false;
+
+	if(!reap_init() || !reap_watch_start()) {
+		ret = RUN_FORK_FAILED;
+		goto done;
+	}
+
+	watching = true;
+
+	if((p->which & (RUN_PIPE_STDIN | RUN_PIPE_STDOUT | RUN_PIPE_STDERR)) != (RUN_PIPE_STDIN | RUN_PIPE_STDOUT | RUN_PIPE_STDERR)) {
+		null_dev = open_null_dev();
+		if(null_dev == -1) {
+			ret = convert_from_errno(errno, RUN_FORK_FAILED);
+			goto done;
+		}
+	}
+
+	for(i = 0; i < 3; i++) {
+		if(!(p->which & (1 << i))) {
+			child_fds[i] = null_dev;
+			continue;
+		}
+
+		if(pipe(pipes[i]) != 0) {
+			E_WARNING(E_STRLOC ": pipe() failed with '%s'\n", strerror(errno));
+			ret = RUN_PIPE_FAILED;
+			goto done;
+		}
+
+		fcntl(pipes[i][0], F_SETFD, FD_CLOEXEC);
+		fcntl(pipes[i][1], F_SETFD, FD_CLOEXEC);
+
+		/* child reads stdin and writes the rest */
+		child_fds[i] = (i == 0) ? pipes[i][0] : pipes[i][1];
+	}
+
+	if(pipe(err_pipe) != 0) {
+		E_WARNING(E_STRLOC ": pipe() failed with '%s'\n", strerror(errno));
+		ret = RUN_PIPE_FAILED;
+		goto done;
+	}
+
+	fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(err_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	/* no signal handler should run in child, since it can share memory with us */
+	sigfillset(&all);
+	sigprocmask(SIG_BLOCK, &all, &old);
+
+	pid = SPAWN_FORK();
+	if(pid == 0)
+		process_child(path, p->argv, sh_args, p->envp ? p->envp : environ, p->dir, child_fds, err_pipe[1], &old);
+
+	/* SIGCHLD stays blocked until program is registered for reaping */
+	chld_mask = old;
+	sigaddset(&chld_mask, SIGCHLD);
+	sigprocmask(SIG_SETMASK, &chld_mask, NULL);
+	masked = true;
+
+	if(pid < 0) {
+		E_WARNING(E_STRLOC ": fork() failed with '%s'\n", strerror(errno));
+		ret = RUN_FORK_FAILED;
+		goto done;
+	}
+
+	close_and_invalidate(&err_pipe[1]);
+
+	int child_err;
+	if(read_ints(err_pipe[0], &child_err, 1, &n) && n == 1) {
+		/* exec failed; reap child so it does not become a zombie */
+		while(waitpid(pid, NULL, 0) < 0) {
+			if(errno != EINTR)
+				break;
+		}
+
+		ret = convert_from_errno(child_err, RUN_EXECVE_FAILED);
+		goto done;
+	}
+
+	p->reap = reap_add(pid, p);
+	if(!p->reap) {
+		kill(pid, SIGKILL);
+		while(waitpid(pid, NULL, 0) < 0) {
+			if(errno != EINTR)
+				break;
+		}
+
+		ret = RUN_FORK_FAILED;
+		goto done;
+	}
+
+	p->pid = pid;
+	p->status = 0;
+	p->stdin_close = false;
+	p->out[0].clear();
+	p->out[1].clear();
+
+	/* take parent ends */
+	for(i = 0; i < 3; i++) {
+		if(pipes[i][0] == -1)
+			continue;
+
+		if(i == 0) {
+			p->fds[i] = pipes[i][1];
+			pipes[i][1] = -1;
+		} else {
+			p->fds[i] = pipes[i][0];
+			pipes[i][0] = -1;
+			listener_add_fd(p->fds[i], process_read_cb, p);
+		}
+
+		fcntl(p->fds[i], F_SETFL, fcntl(p->fds[i], F_GETFL) | O_NONBLOCK);
+	}
+
+	ret = 0;
+
+done:
+	if(masked)
+		sigprocmask(SIG_SETMASK, &old, NULL);
+
+	if(ret != 0 && watching)
+		reap_watch_stop();
+
+	for(i = 0; i < 3; i++) {
+		close_and_invalidate(&pipes[i][0]);
+		close_and_invalidate(&pipes[i][1]);
+	}
+
+	close_and_invalidate(&err_pipe[0]);
+	close_and_invalidate(&err_pipe[1]);
+	close_and_invalidate(&null_dev);
+	free(sh_args);
+
+	return ret;
+}
+
+static void queue_schedule(RunQueuePrivate *q) {
+	/* job failing to start will call us again via queue_job_done() */
+	if(q->scheduling)
+		return;
+
+	q->scheduling = true;
+
+	while(q->active.size() < q->max_jobs && !q->waiting.empty()) {
+		RunProcessPrivate *p = *q->waiting.begin();
+
+		q->waiting.erase(q->waiting.begin());
+		q->active.push_back(p);
+
+		int ret = process_start(p);
+		if(ret != 0)
+			process_finish(p, ret);
+	}
+
+	q->scheduling = false;
+}
+
+static void queue_remove(RunJobList &lst, RunProcessPrivate *p) {
+	RunJobListIter it = lst.begin(), it_end = lst.end();
+
+	for(; it != it_end; ++it) {
+		if(*it == p) {
+			lst.erase(it);
+			return;
+		}
+	}
+}
+
+static void queue_job_done(RunQueuePrivate *q, RunProcessPrivate *p) {
+	queue_remove(q->active, p);
+	queue_schedule(q);
+}
+
+RunProcess::RunProcess() {
+	priv = new RunProcessPrivate;
+	priv->self = this;
+	priv->argv = priv->envp = NULL;
+	priv->dir = NULL;
+	priv->which = 0;
+	priv->output_cb = NULL;
+	priv->exit_cb = NULL;
+	priv->arg = NULL;
+	priv->pid = 0;
+	priv->status = 0;
+	priv->fds[0] = priv->fds[1] = priv->fds[2] = -1;
+	priv->inbuf_pos = 0;
+	priv->stdin_close = false;
+	priv->queue = NULL;
+	priv->reap = NULL;
+}
+
+RunProcess::~RunProcess() {
+	if(priv->queue) {
+		queue_remove(priv->queue->waiting, priv);
+		queue_job_done(priv->queue, priv);
+	}
+
+	process_unwatch(priv);
+
+	if(priv->reap)
+		process_kill(priv);
+
+	strv_free(priv->argv);
+	strv_free(priv->envp);
+	free(priv->dir);
+	delete priv;
+}
+
+void RunProcess::args(const char **argv) {
+	strv_free(priv->argv);
+	priv->argv = strv_dup(argv);
+}
+
+void RunProcess::env(const char **envp) {
+	strv_free(priv->envp);
+	priv->envp = strv_dup(envp);
+}
+
+void RunProcess::cwd(const char *dir) {
+	free(priv->dir);
+	priv->dir = dir ? strdup(dir) : NULL;
+}
+
+void RunProcess::pipes(int which) {
+	priv->which = which;
+}
+
+void RunProcess::callback(RunOutputCallback output_cb, RunExitCallback exit_cb, void *arg) {
+	priv->output_cb = output_cb;
+	priv->exit_cb = exit_cb;
+	priv->arg = arg;
+}
+
+int RunProcess::start(void) {
+	return process_start(priv);
+}
+
+bool RunProcess::write(const char *data, int len) {
+	E_RETURN_VAL_IF_FAIL(data != NULL, false);
+
+	if(!priv->pid || priv->fds[0] == -1 || priv->stdin_close)
+		return false;
+
+	if(len <= 0)
+		return true;
+
+	if(priv->inbuf.length() == priv->inbuf_pos)
+		listener_add_fd(priv->fds[0], LISTENER_WRITE, process_write_cb, priv);
+
+	priv->inbuf.append(data, len);
+	return true;
+}
+
+void RunProcess::close_stdin(void) {
+	if(priv->fds[0] == -1)
+		return;
+
+	if(priv->inbuf.length() == priv->inbuf_pos)
+		process_close_stdin(priv);
+	else
+		priv->stdin_close = true;
+}
+
+const char *RunProcess::output(int stream, int *len) const {
+	const String &s = priv->out[stream == RUN_PIPE_STDERR ? 1 : 0];
+
+	if(len)
+		*len = s.length();
+	return s.c_str();
+}
+
+int RunProcess::pid(void) const {
+	return priv->pid;
+}
+
+bool RunProcess::running(void) const {
+	return priv->pid > 0;
+}
+
+int RunProcess::wait(void) {
+	while(priv->pid > 0 || priv->queue)
+		listener_wait();
+
+	return priv->status;
+}
+
+RunQueue::RunQueue(unsigned int max_jobs) {
+	if(!max_jobs) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		max_jobs = (n > 0) ? (unsigned int)n : 1;
+	}
+
+	priv = new RunQueuePrivate;
+	priv->max_jobs = max_jobs;
+	priv->scheduling = false;
+}
+
+RunQueue::~RunQueue() {
+	RunJobListIter it, it_end;
+
+	for(it = priv->waiting.begin(), it_end = priv->waiting.end(); it != it_end; ++it)
+		(*it)->queue = NULL;
+
+	for(it = priv->active.begin(), it_end = priv->active.end(); it != it_end; ++it)
+		(*it)->queue = NULL;
+
+	delete priv;
+}
+
+void RunQueue::add(RunProcess *p) {
+	E_RETURN_IF_FAIL(p != NULL);
+	E_RETURN_IF_FAIL(p->priv->queue == NULL && p->priv->pid == 0);
+
+	p->priv->queue = priv;
+	priv->waiting.push_back(p->priv);
+	queue_schedule(priv);
+}
+
+unsigned int RunQueue::pending(void) const {
+	return priv->waiting.size();
+}
+
+unsigned int RunQueue::running(void) const {
+	return priv->active.size();
+}
+
+void RunQueue::wait(void) {
+	while(!priv->waiting.empty() || !priv->active.empty())
+		listener_wait();
+}
+
 EDELIB_NS_END
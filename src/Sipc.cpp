@@ -19,8 +19,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <errno.h>
 #include <pwd.h>
 #include <stdio.h>
 #include <string.h>
@@ -35,18 +37,33 @@
 # define UNIX_PATH_MAX 108
 #endif
 
-/* max message length without ending '\n' */
-#define MSG_LEN_MAX 1024
+/*
+ * Framed message starts with this byte, followed by 4 bytes of message length (big endian) and
+ * message itself. Plain text messages are terminated with '\n' and can't start with '\0', so server
+ * can accept both kinds on the same connection.
+ */
+#define SIPC_FRAME_MARK   '\0'
+#define SIPC_FRAME_HEADER 5
+
+/* minimal free space in connection buffer before read() */
+#define SIPC_READ_CHUNK   4096
+
+/* largest accepted message; connection sending more is closed */
+#define SIPC_MSG_LEN_MAX  (1024 * 1024)
 
 EDELIB_NS_BEGIN
 
-typedef list<SipcClientPrivate*> ConnectionList;
-typedef list<SipcClientPrivate*>::iterator ConnectionListIter;
+struct SipcConnection;
+
+typedef list<SipcConnection*> ConnectionList;
+typedef list<SipcConnection*>::iterator ConnectionListIter;
 
 static void server_cb(int fd, void* data);
+static void connection_cb(int fd, void* data);
 
 struct SipcClientPrivate {
 	int   fd;
+	bool  framed;
 	char *path;
 
 	~SipcClientPrivate() {
@@ -56,6 +73,16 @@ struct SipcClientPrivate {
 	}
 };
 
+/* accepted connection; received data is kept until whole message arrives */
+struct SipcConnection {
+	int                fd;
+	SipcServerPrivate *server;
+	char              *buf;
+	unsigned int       len;
+	unsigned int       cap;
+	bool               busy;
+};
+
 struct SipcServerPrivate {
 	int            fd;
 	char          *path;
@@ -63,19 +90,40 @@ struct SipcServerPrivate {
 	void          *arg;
 	ConnectionList accepted_connections;
 
+	/*
+	 * callback can destroy the server; while messages are dispatched, destruction is
+	 * only marked and done after callback returns
+	 */
+	int            dispatching;
+	bool           destroyed;
+
 	~SipcServerPrivate();
 };
 
+static void server_private_free(SipcServerPrivate* p) {
+	if(p->dispatching)
+		p->destroyed = true;
+	else
+		delete p;
+}
+
+static void connection_free(SipcConnection* c) {
+	listener_remove_fd(c->fd);
+	close(c->fd);
+	free(c->buf);
+	delete c;
+}
+
 SipcServerPrivate::~SipcServerPrivate() {
 	ConnectionListIter it = accepted_connections.begin(), it_end = accepted_connections.end();
-	for(; it != it_end; ++it) {
-		listener_remove_fd((*it)->fd);
-		close((*it)->fd);
-		free((*it)->path);
-	}
+	for(; it != it_end; ++it)
+		connection_free(*it);
 
-	if(fd > -1)
+	if(fd > -1) {
+		listener_remove_fd(fd);
 		close(fd);
+	}
+
 	unlink(path);
 	free(path);
 }
@@ -114,71 +162,197 @@ static bool file_is_socket(const char* path) {
 }
 
 static void accept_new_connection(SipcServerPrivate* p) {
-	socklen_t alen;
+	int fd = accept(p->fd, NULL, NULL);
+	if(fd == -1) {
+		E_WARNING(E_STRLOC ": accept() failed (%s)\n", strerror(errno));
+		return;
+	}
 
-	SipcClientPrivate* cp = new SipcClientPrivate;
-	cp->path = 0;
-	cp->fd = accept(p->fd, NULL, &alen);
+	SipcConnection* c = new SipcConnection;
+	c->fd = fd;
+	c->server = p;
+	c->buf = 0;
+	c->len = c->cap = 0;
+	c->busy = false;
 
-	p->accepted_connections.push_back(cp);
+	p->accepted_connections.push_back(c);
 
 	/* listen accepted clients */
-	listener_add_fd(cp->fd, server_cb, p);
+	listener_add_fd(fd, connection_cb, c);
 }
 
-static void server_cb(int fd, void* data) {
-	SipcServerPrivate* priv = (SipcServerPrivate*)data;
-
-	if(priv->fd == fd) {
-		accept_new_connection(priv);
+static void server_cb(int, void* data) {
+	SipcServerPrivate* p = (SipcServerPrivate*)data;
+	if(p->destroyed)
 		return;
+
+	accept_new_connection(p);
+}
+
+static void connection_close(SipcConnection* c) {
+	ConnectionList& lst = c->server->accepted_connections;
+	ConnectionListIter it = lst.begin(), it_end = lst.end();
+
+	for(; it != it_end; ++it) {
+		if(*it == c) {
+			lst.erase(it);
+			break;
+		}
 	}
 
-	char c;
-	int  nc, i = 0;
-	char buf[MSG_LEN_MAX];
-	memset(buf, 0, sizeof(buf));
+	connection_free(c);
+}
 
-	nc = ::read(fd, &c, 1);
-	while(nc > 0 && c != '\n' && i < MSG_LEN_MAX) {
-		buf[i] = c;
-		i = i + nc;
-		nc = ::read(fd, &c, 1);
+/* returns false if server was destroyed inside callback; connection is not valid then */
+static bool message_dispatch(SipcServerPrivate* priv, char* msg, unsigned int len) {
+	/* there is always one spare byte after the data, see connection_cb() */
+	char saved = msg[len];
+	msg[len] = '\0';
+
+	if(priv->cb) {
+		priv->dispatching++;
+		priv->cb(msg, priv->arg);
+		priv->dispatching--;
+
+		if(priv->destroyed) {
+			if(!priv->dispatching)
+				delete priv;
+			return false;
+		}
 	}
 
-	if(nc <= 0) {
-		ConnectionListIter it = priv->accepted_connections.begin();
-		ConnectionListIter it_end = priv->accepted_connections.end();
-
-		for(; it != it_end; ++it) {
-			if((*it)->fd == fd) {
-				listener_remove_fd(fd);
-				close(fd);
-				free((*it)->path);
-				delete *it;
-				priv->accepted_connections.erase(it);
+	msg[len] = saved;
+	return true;
+}
+
+/*
+ * Call callback for each complete message in buffer. Returns number of consumed bytes, or -1
+ * if connection should not be used any more: either message is too large (connection is closed)
+ * or server was destroyed from callback.
+ */
+static int connection_parse(SipcConnection* c) {
+	unsigned int pos = 0, left, mlen;
+	unsigned char *h;
+	char *nl;
+
+	while(pos < c->len) {
+		left = c->len - pos;
+
+		if(c->buf[pos] == SIPC_FRAME_MARK) {
+			if(left < SIPC_FRAME_HEADER)
+				break;
+
+			h = (unsigned char*)c->buf + pos + 1;
+			mlen = ((unsigned int)h[0] << 24) | ((unsigned int)h[1] << 16) | ((unsigned int)h[2] << 8) | h[3];
+
+			if(mlen > SIPC_MSG_LEN_MAX) {
+				E_WARNING(E_STRLOC ": message too large (%u bytes), closing connection\n", mlen);
+				connection_close(c);
+				return -1;
+			}
+
+			if(left - SIPC_FRAME_HEADER < mlen)
+				break;
+
+			if(!message_dispatch(c->server, c->buf + pos + SIPC_FRAME_HEADER, mlen))
+				return -1;
+			pos += SIPC_FRAME_HEADER + mlen;
+		} else {
+			nl = (char*)memchr(c->buf + pos, '\n', left);
+			if(!nl) {
+				if(left > SIPC_MSG_LEN_MAX) {
+					E_WARNING(E_STRLOC ": message line too large, closing connection\n");
+					connection_close(c);
+					return -1;
+				}
 				break;
 			}
+
+			mlen = nl - (c->buf + pos);
+			if(!message_dispatch(c->server, c->buf + pos, mlen))
+				return -1;
+			pos += mlen + 1;
 		}
+	}
+
+	return (int)pos;
+}
 
+static void connection_cb(int fd, void* data) {
+	SipcConnection* c = (SipcConnection*)data;
+
+	/* callback is running listener loop; buffer is in use, so leave data for later */
+	if(c->busy || c->server->destroyed)
 		return;
+
+	/* keep one byte spare, so message can be terminated in place */
+	if(c->cap - c->len < SIPC_READ_CHUNK + 1) {
+		unsigned int ncap = c->cap ? c->cap : SIPC_READ_CHUNK * 2;
+		while(ncap - c->len < SIPC_READ_CHUNK + 1) {
+			/* can't happen with SIPC_MSG_LEN_MAX checks, but never let it wrap */
+			if(ncap > SIPC_MSG_LEN_MAX * 4) {
+				connection_close(c);
+				return;
+			}
+			ncap *= 2;
+		}
+
+		char* tmp = (char*)realloc(c->buf, ncap);
+		if(!tmp) {
+			E_WARNING(E_STRLOC ": unable to allocate %i bytes for message\n", ncap);
+			connection_close(c);
+			return;
+		}
+
+		c->buf = tmp;
+		c->cap = ncap;
 	}
 
-	buf[i] = '\0';
+	ssize_t nc = ::read(fd, c->buf + c->len, c->cap - c->len - 1);
+	if(nc < 0 && (errno == EINTR || errno == EAGAIN))
+		return;
+
+	if(nc <= 0) {
+		connection_close(c);
+		return;
+	}
+
+	c->len += nc;
+
+	c->busy = true;
+	int ret = connection_parse(c);
+	if(ret < 0)
+		return;
+	c->busy = false;
+
+	unsigned int used = (unsigned int)ret;
+	if(used == 0)
+		return;
+
+	c->len -= used;
+	if(c->len > 0)
+		memmove(c->buf, c->buf + used, c->len);
 
-	if(priv->cb)
-		priv->cb(buf, priv->arg);
+	/* do not keep large buffers around after big messages */
+	if(c->len == 0 && c->cap > SIPC_READ_CHUNK * 16) {
+		free(c->buf);
+		c->buf = 0;
+		c->cap = 0;
+	}
 }
 
 SipcServer::SipcServer() : priv(0) { }
 
 SipcServer::~SipcServer() {
-	delete priv;
+	if(priv)
+		server_private_free(priv);
 }
 
 bool SipcServer::request_name(const char* prefix) {
-	if(priv)
-		delete priv;
+	if(priv) {
+		server_private_free(priv);
+		priv = 0;
+	}
    
 	char* sname = make_socket_filename(prefix);
 	if(!sname)
@@ -193,6 +367,8 @@ bool SipcServer::request_name(const char* prefix) {
 	priv->path = sname;
 	priv->cb = 0;
 	priv->arg = 0;
+	priv->dispatching = 0;
+	priv->destroyed = false;
 
 	struct sockaddr_un addr;
 	addr.sun_family = AF_UNIX;
@@ -204,7 +380,7 @@ bool SipcServer::request_name(const char* prefix) {
 		return false;
 	}
 
-	::listen(priv->fd, 5);
+	::listen(priv->fd, SOMAXCONN);
 
 	listener_add_fd(priv->fd, server_cb, priv);
 	return true;
@@ -239,6 +415,7 @@ bool SipcClient::connect(const char* prefix) {
 
 	priv = new SipcClientPrivate;
 	priv->path = sname;
+	priv->framed = false;
 
 	struct sockaddr_un addr;
 	addr.sun_family = AF_UNIX;
@@ -253,16 +430,70 @@ bool SipcClient::connect(const char* prefix) {
 	return true;
 }
 
+void SipcClient::set_framed(bool f) {
+	E_RETURN_IF_FAIL(priv != NULL);
+	priv->framed = f;
+}
+
 void SipcClient::send(const char* msg) {
 	E_RETURN_IF_FAIL(priv != NULL);
 	E_RETURN_IF_FAIL(priv->fd != -1);
 
-	int len = strlen(msg);
-	if(len > MSG_LEN_MAX)
-		len = MSG_LEN_MAX;
+	size_t        len = strlen(msg);
+	unsigned char header[SIPC_FRAME_HEADER];
+	struct iovec  iov[2];
+	int           n = 0;
 
-	::write(priv->fd, msg, len);
-	::write(priv->fd, "\n", 1);
+	if(len > SIPC_MSG_LEN_MAX) {
+		E_WARNING(E_STRLOC ": message too large (%lu bytes), not sent\n", (unsigned long)len);
+		return;
+	}
+
+	if(priv->framed) {
+		header[0] = SIPC_FRAME_MARK;
+		header[1] = (unsigned char)(len >> 24);
+		header[2] = (unsigned char)(len >> 16);
+		header[3] = (unsigned char)(len >> 8);
+		header[4] = (unsigned char)len;
+
+		iov[n].iov_base = header;
+		iov[n].iov_len  = SIPC_FRAME_HEADER;
+		n++;
+		iov[n].iov_base = (void*)msg;
+		iov[n].iov_len  = len;
+		n++;
+	} else {
+		iov[n].iov_base = (void*)msg;
+		iov[n].iov_len  = len;
+		n++;
+		iov[n].iov_base = (void*)"\n";
+		iov[n].iov_len  = 1;
+		n++;
+	}
+
+	/* send whole message with one call; loop only if socket buffer was full */
+	struct iovec *v = iov;
+	ssize_t ret;
+
+	while(n > 0) {
+		ret = ::writev(priv->fd, v, n);
+		if(ret < 0) {
+			if(errno == EINTR) continue;
+			E_WARNING(E_STRLOC ": unable to send message (%s)\n", strerror(errno));
+			return;
+		}
+
+		while(n > 0 && (size_t)ret >= v->iov_len) {
+			ret -= v->iov_len;
+			v++;
+			n--;
+		}
+
+		if(n > 0) {
+			v->iov_base = (char*)v->iov_base + ret;
+			v->iov_len -= ret;
+		}
+	}
 }
 
 EDELIB_NS_END
@@ -28,27 +28,65 @@
 
 EDELIB_NS_BEGIN
 
+/*
+ * Allocated buffers are prefixed with StringRep, holding the number of strings sharing it. If
+ * count is REP_UNSHAREABLE, buffer has only one owner and reference to its content was given
+ * out via operator[], so it must not be shared any more.
+ */
+struct StringRep {
+	unsigned int refs;
+};
+
+#define REP_UNSHAREABLE 0
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+# define REP_REF(r)   __sync_add_and_fetch(&(r)->refs, 1)
+# define REP_UNREF(r) __sync_sub_and_fetch(&(r)->refs, 1)
+#else
+# define REP_REF(r)   (++(r)->refs)
+# define REP_UNREF(r) (--(r)->refs)
+#endif
+
+static char* rep_new(String::size_type cap) {
+	char* block = new char[sizeof(StringRep) + cap + 1];
+	((StringRep*)block)->refs = 1;
+	return block + sizeof(StringRep);
+}
+
+static inline StringRep* rep_get(const char* chars) {
+	return (StringRep*)(chars - sizeof(StringRep));
+}
+
+static void rep_release(char* chars) {
+	StringRep* r = rep_get(chars);
+
+	if(r->refs == REP_UNSHAREABLE || REP_UNREF(r) == 0)
+		delete [] (char*)r;
+}
+
 // copy character num times into dest
 static void chcpy(char* dest, const char& ch, String::size_type num) {
 	for(char* ptr = dest; num > 0; ptr++, num--)
 		*ptr = ch;
 }
 
-String::StringData String::null_data = {0, 0, (char*)""};
 const String::size_type  String::npos = ~(String::size_type)0;
 
-String::String() : sdata(&null_data)
-{ }
+String::String()
+{
+	init_empty();
+}
 
-String::String(const char* str) : sdata(&null_data) 
-{ 
+String::String(const char* str)
+{
+	init_empty();
 	assign(str); 
 }
 
-String::String(const String& str) : sdata(&null_data)
+String::String(const String& str)
 { 
-	if(str.length())
-		assign(str.c_str()); 
+	init_empty();
+	share(str);
 }
 
 String::~String()
@@ -56,37 +94,75 @@ String::~String()
 	dispose();
 }
 
-void String::init(size_type len, size_type cap) {
-	E_ASSERT(len <= cap);
+void String::dispose(void) {
+	if(!is_inline())
+		rep_release(schars);
+	init_empty();
+}
+
+/* make this (empty) string copy of 'from', sharing the buffer when possible */
+void String::share(const String& from) {
+	E_ASSERT(is_inline() && slength == 0);
 
-	sdata = new StringData;
-	sdata->chars = new char[cap + 1];
-	sdata->chars[0] = STERM;
-	sdata->length = len;
-	sdata->capacity = cap;
+	if(from.is_inline() || rep_get(from.schars)->refs == REP_UNSHAREABLE) {
+		if(from.slength)
+			assign(from.schars, from.slength);
+		return;
+	}
+
+	REP_REF(rep_get(from.schars));
+	schars = from.schars;
+	slength = from.slength;
+	scapacity = from.scapacity;
 }
 
-void String::dispose(void) {
-	if(sdata != &null_data) {
-		delete [] sdata->chars;
-		delete sdata;
-		sdata = &null_data;
+/* make sure we are the only owner of the buffer before it gets modified */
+void String::unshare(void) {
+	if(is_inline() || rep_get(schars)->refs <= 1)
+		return;
+
+	char* p = rep_new(scapacity);
+	memcpy(p, schars, slength + 1);
+	rep_release(schars);
+	schars = p;
+}
+
+/* move content of 'from' to this (empty) string, leaving 'from' empty */
+void String::take(String& from) {
+	E_ASSERT(is_inline() && slength == 0);
+
+	if(from.is_inline()) {
+		memcpy(sbuf, from.sbuf, from.slength + 1);
+	} else {
+		schars = from.schars;
+		scapacity = from.scapacity;
 	}
+
+	slength = from.slength;
+	from.init_empty();
 }
 
 void String::reserve(size_type cap) {
 	if(cap > capacity()) {
-		String tmp;
-		tmp.init(length(), cap);
-		memcpy(tmp.sdata->chars, data(), length());
-		swap(tmp);
+		char* p = rep_new(cap);
+		memcpy(p, schars, slength + 1);
+
+		if(!is_inline())
+			rep_release(schars);
+
+		schars = p;
+		scapacity = cap;
 	}
 }
 
 void String::swap(String& from) {
-	StringData* d = sdata;
-	sdata = from.sdata;
-	from.sdata = d;
+	if(&from == this)
+		return;
+
+	String tmp;
+	tmp.take(*this);
+	take(from);
+	from.take(tmp);
 }
 
 String& String::assign(const char* str, size_type len) {
@@ -104,17 +180,25 @@ String& String::assign(const char* str, size_type len) {
 	 * since std::string will have:
 	 *    foo.length() == 3;
 	 *    foo.capacity() == 20;
+	 *
+	 * so current buffer is reused when content fits in it and is not shared. Data is
+	 * moved, as 'str' can point inside own buffer.
 	 */
-	size_type cap = capacity();
-	dispose();
+	if(len <= capacity() && (is_inline() || rep_get(schars)->refs <= 1)) {
+		memmove(schars, str, len);
+	} else {
+		char* p = rep_new(len);
+		memcpy(p, str, len);
 
-	if(len < cap)
-		init(len, cap);
-	else
-		init(len, len);
-	memcpy(sdata->chars, str, len);
-	sdata->chars[len] = STERM;
+		if(!is_inline())
+			rep_release(schars);
+
+		schars = p;
+		scapacity = len;
+	}
 
+	slength = len;
+	schars[len] = STERM;
 	return *this;
 }
 
@@ -124,6 +208,16 @@ String& String::assign(const char* str) {
 }
 
 String& String::assign(const String& str) {
+	if(str.schars == schars)
+		return *this;
+
+	/* share allocated buffer instead of copying it */
+	if(!str.is_inline() && rep_get(str.schars)->refs != REP_UNSHAREABLE) {
+		dispose();
+		share(str);
+		return *this;
+	}
+
 	assign(str.c_str(), str.length());
 	return *this;
 }
@@ -132,33 +226,36 @@ String& String::append(const char* str, size_type len) {
 	if(len == 0)
 		return *this;
 
-	if(len + length() <= capacity()) {
-		memcpy(sdata->chars + length(), str, len);
-		sdata->length += len;
-		sdata->chars[sdata->length] = STERM;
+	if(len + length() > capacity()) {
+		/* 'str' can point inside own buffer, which reserve() will release */
+		if(str >= schars && str <= schars + slength) {
+			size_type off = str - schars;
+			reserve((capacity() + len) * 2);
+			str = schars + off;
+		} else {
+			reserve((capacity() + len) * 2);
+		}
 	} else {
-		reserve((capacity() + len) * 2);
-		memcpy(sdata->chars + length(), str, len);
-		sdata->length += len;
-		sdata->chars[sdata->length] = STERM;
+		/* if 'str' points inside shared buffer, it stays valid, as other owner still holds it */
+		unshare();
 	}
 
+	memmove(schars + slength, str, len);
+	slength += len;
+	schars[slength] = STERM;
 	return *this;
 }
 
 String& String::append(size_type num, const char& ch) {
-	if(num + length() <= capacity()) {
-		chcpy(sdata->chars + length(), ch, num);
-		sdata->length += num;
-		sdata->chars[sdata->length] = STERM;
-	} else {
-		char* buff = new char[num];
-		chcpy(buff, ch, num);
-		append(buff, num);
-		delete[] buff;
-	}
+	if(num + length() > capacity())
+		reserve((capacity() + num) * 2);
+	else
+		unshare();
 
-	return* this;
+	chcpy(schars + slength, ch, num);
+	slength += num;
+	schars[slength] = STERM;
+	return *this;
 }
 
 String& String::append(const char* str) {
@@ -189,25 +286,28 @@ void String::printf(const char* fmt, ...) {
 
 void String::trim_left(void) {
 	if(length()) {
-		str_trimleft(sdata->chars);
+		unshare();
+		str_trimleft(schars);
 		/* update length */
-		sdata->length = strlen(sdata->chars);
+		slength = strlen(schars);
 	}
 }
 
 void String::trim_right(void) {
 	if(length()) {
-		str_trimright(sdata->chars);
+		unshare();
+		str_trimright(schars);
 		/* update length */
-		sdata->length = strlen(sdata->chars);
+		slength = strlen(schars);
 	}
 }
 
 void String::trim(void) {
 	if(length()) {
-		str_trim(sdata->chars);
+		unshare();
+		str_trim(schars);
 		/* update length */
-		sdata->length = strlen(sdata->chars);
+		slength = strlen(schars);
 	}
 }
 
@@ -238,13 +338,19 @@ String& String::operator+=(const char& ch) {
 char& String::operator[](size_type index) {
 	E_ASSERT(index < length());
 
-	return sdata->chars[index];
+	/* returned reference can be used to change the content, so the buffer must not be shared again */
+	if(!is_inline()) {
+		unshare();
+		rep_get(schars)->refs = REP_UNSHAREABLE;
+	}
+
+	return schars[index];
 }
 
 char String::operator[](size_type index) const {
 	E_ASSERT(index < length());
 
-	return sdata->chars[index];
+	return schars[index];
 }
 
 String String::substr(size_type index, size_type num) const {
@@ -296,6 +402,8 @@ String& String::replace(char c1, char c2) {
 	if(c1 == c2)
 		return *this;
 
+	unshare();
+
 	size_type i = 0;
 	for(char* p = (char*)data(); *p != STERM && i < length(); p++, i++) {
 		if(*p == c1)
@@ -309,7 +417,7 @@ String operator+(const String& s1, const String& s2) {
 	String tmp;
 
 	String::size_type len = s1.length();
-	len += s1.length();
+	len += s2.length();
 	/*
 	 * Do not allocate anything if sum of lenghts of 
 	 * s1 and s2 are 0.
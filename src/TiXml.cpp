@@ -23,6 +23,7 @@ distribution.
 */
 
 #include <ctype.h>
+#include <stdlib.h>
 
 #ifdef TIXML_USE_STL
 #include <sstream>
@@ -34,6 +35,160 @@ distribution.
 
 bool TiXmlBase::condenseWhiteSpace = true;
 
+// Every node and attribute is prefixed with a pointer to the arena it came from, or null if it
+// is on the heap, so operator delete knows what to do. Union keeps objects properly aligned.
+union TiXmlAllocHeader
+{
+	TiXmlArena*	arena;
+	double		alignDouble;
+	long		alignLong;
+};
+
+#define TIXML_ARENA_BLOCK 32768
+
+// Allocation operators are kept out of line, so compiler pairs 'new' with our operator delete instead of
+// seeing malloc() behind the header and reporting mismatched deallocation (-Wmismatched-new-delete).
+#ifdef __GNUC__
+# define TIXML_NOINLINE __attribute__ ((noinline))
+#else
+# define TIXML_NOINLINE
+#endif
+
+// Bump allocator for document nodes. Memory is never returned to the arena on delete; it is
+// released when arena is destroyed, or reused after Reset() once all objects are gone.
+class TiXmlArena
+{
+public:
+	TiXmlArena() : blocks( 0 ), ptr( 0 ), left( 0 ), live( 0 ) {}
+	~TiXmlArena()	{ Free( blocks ); }
+
+	void* Alloc( size_t size )
+	{
+		size = ( size + sizeof( TiXmlAllocHeader ) - 1 ) / sizeof( TiXmlAllocHeader ) * sizeof( TiXmlAllocHeader );
+
+		if ( size > left )
+		{
+			size_t bsize = size > TIXML_ARENA_BLOCK ? size : TIXML_ARENA_BLOCK;
+			Block* b = (Block*)malloc( sizeof( Block ) + bsize );
+			if ( !b )
+				return 0;
+
+			b->hdr.next = blocks;
+			blocks = b;
+			ptr = (char*)( b + 1 );
+			left = bsize;
+		}
+
+		void* ret = ptr;
+		ptr += size;
+		left -= size;
+		live++;
+		return ret;
+	}
+
+	void Release()	{ live--; }
+
+	// Start again from the first block, dropping the rest; only when nothing is allocated from it.
+	void Reset()
+	{
+		if ( live || !blocks )
+			return;
+
+		Block* last = blocks;
+		while ( last->hdr.next )
+			last = last->hdr.next;
+
+		if ( last != blocks )
+		{
+			// the first block is the last one in the list
+			Block* b = blocks;
+			while ( b->hdr.next != last )
+				b = b->hdr.next;
+			b->hdr.next = 0;
+
+			Free( blocks );
+			blocks = last;
+		}
+
+		ptr = (char*)( blocks + 1 );
+		left = TIXML_ARENA_BLOCK;
+	}
+
+private:
+	union Block
+	{
+		struct { Block* next; } hdr;
+		TiXmlAllocHeader align;
+	};
+
+	Block*	blocks;
+	char*	ptr;
+	size_t	left;
+	int		live;
+
+	static void Free( Block* b )
+	{
+		while ( b )
+		{
+			Block* next = b->hdr.next;
+			free( b );
+			b = next;
+		}
+	}
+};
+
+
+TIXML_NOINLINE void* TiXmlBase::operator new( size_t size ) throw()
+{
+	TiXmlAllocHeader* h = (TiXmlAllocHeader*)malloc( sizeof( TiXmlAllocHeader ) + size );
+	if ( !h )
+		return 0;
+
+	h->arena = 0;
+	return h + 1;
+}
+
+
+TIXML_NOINLINE void* TiXmlBase::operator new( size_t size, TiXmlDocument* doc ) throw()
+{
+	if ( !doc || !doc->useArena )
+		return operator new( size );
+
+	if ( !doc->arena )
+	{
+		doc->arena = new TiXmlArena;
+		if ( !doc->arena )
+			return 0;
+	}
+
+	TiXmlAllocHeader* h = (TiXmlAllocHeader*)doc->arena->Alloc( sizeof( TiXmlAllocHeader ) + size );
+	if ( !h )
+		return 0;
+
+	h->arena = doc->arena;
+	return h + 1;
+}
+
+
+void TiXmlBase::operator delete( void* p )
+{
+	if ( !p )
+		return;
+
+	TiXmlAllocHeader* h = (TiXmlAllocHeader*)p - 1;
+	if ( h->arena )
+		h->arena->Release();
+	else
+		free( h );
+}
+
+
+void TiXmlBase::operator delete( void* p, TiXmlDocument* )
+{
+	operator delete( p );
+}
+
+
 void TiXmlBase::PutString( const TIXML_STRING& str, TIXML_STRING* outString )
 {
 	int i=0;
@@ -717,14 +872,14 @@ void TiXmlElement::SetAttribute( const char * cname, const char * cvalue )
 		return;
 	}
 
-	TiXmlAttribute* attrib = new TiXmlAttribute( cname, cvalue );
+	TiXmlDocument* document = GetDocument();
+	TiXmlAttribute* attrib = new ( document ) TiXmlAttribute( cname, cvalue );
 	if ( attrib )
 	{
 		attributeSet.Add( attrib );
 	}
 	else
 	{
-		TiXmlDocument* document = GetDocument();
 		if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, 0, 0, TIXML_ENCODING_UNKNOWN );
 	}
 }
@@ -871,6 +1026,8 @@ TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::DOCUMENT )
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
 	ClearError();
 }
 
@@ -878,6 +1035,8 @@ TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
 	value = documentName;
 	ClearError();
 }
@@ -888,6 +1047,8 @@ TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiX
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
     value = documentName;
 	ClearError();
 }
@@ -896,10 +1057,27 @@ TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiX
 
 TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::DOCUMENT )
 {
+	useArena = false;
+	arena = 0;
 	copy.CopyTo( this );
 }
 
 
+TiXmlDocument::~TiXmlDocument()
+{
+	// nodes must go before the memory they live in
+	Clear();
+	delete arena;
+}
+
+
+void TiXmlDocument::ArenaReset()
+{
+	if ( arena )
+		arena->Reset();
+}
+
+
 void TiXmlDocument::operator=( const TiXmlDocument& copy )
 {
 	Clear();
@@ -966,6 +1144,7 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 
 	// Delete the existing data:
 	Clear();
+	ArenaReset();
 	location.Clear();
 
 	// Get the file size, so we can pre-allocate the string. HUGE speed impact.
@@ -1108,6 +1287,7 @@ void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
 
 	target->error = error;
 	target->errorDesc = errorDesc.c_str ();
+	target->useArena = useArena;
 
 	TiXmlNode* node = 0;
 	for ( node = firstChild; node; node = node->NextSibling() )
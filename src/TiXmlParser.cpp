@@ -870,21 +870,21 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Declaration\n" );
 		#endif
-		returnNode = new TiXmlDeclaration();
+		returnNode = new ( doc ) TiXmlDeclaration();
 	}
 	else if ( StringEqual( p, commentHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Comment\n" );
 		#endif
-		returnNode = new TiXmlComment();
+		returnNode = new ( doc ) TiXmlComment();
 	}
 	else if ( StringEqual( p, cdataHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing CDATA\n" );
 		#endif
-		TiXmlText* text = new TiXmlText( "" );
+		TiXmlText* text = new ( doc ) TiXmlText( "" );
 		text->SetCDATA( true );
 		returnNode = text;
 	}
@@ -893,7 +893,7 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(1)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = new ( doc ) TiXmlUnknown();
 	}
 	else if (    IsAlpha( *(p+1), encoding )
 			  || *(p+1) == '_' )
@@ -901,14 +901,14 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Element\n" );
 		#endif
-		returnNode = new TiXmlElement( "" );
+		returnNode = new ( doc ) TiXmlElement( "" );
 	}
 	else
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(2)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = new ( doc ) TiXmlUnknown();
 	}
 
 	if ( returnNode )
@@ -1152,7 +1152,7 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		else
 		{
 			// Try to read an attribute:
-			TiXmlAttribute* attrib = new TiXmlAttribute();
+			TiXmlAttribute* attrib = new ( document ) TiXmlAttribute();
 			if ( !attrib )
 			{
 				if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, pErr, data, encoding );
@@ -1203,7 +1203,7 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 		if ( *p != '<' )
 		{
 			// Take what we have, make a text element.
-			TiXmlText* textNode = new TiXmlText( "" );
+			TiXmlText* textNode = new ( document ) TiXmlText( "" );
 
 			if ( !textNode )
 			{
@@ -1305,8 +1305,20 @@ const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 	++p;
     value = "";
 
-	while ( p && *p && *p != '>' )
+	// DOCTYPE can have internal subset with declarations in brackets; '>' ends it only outside of them
+	int depth = 0;
+	bool doctype = StringEqual( p, "!DOCTYPE", false, encoding );
+
+	while ( p && *p && ( *p != '>' || depth > 0 ) )
 	{
+		if ( doctype )
+		{
+			if ( *p == '[' )
+				++depth;
+			else if ( *p == ']' && depth > 0 )
+				--depth;
+		}
+
 		value += *p;
 		++p;
 	}
@@ -1624,3 +1636,613 @@ bool TiXmlText::Blank() const
 	return true;
 }
 
+
+// Streaming parser. Data is read in chunks into a buffer which holds only the markup being
+// parsed; tokens are found first and then parsed with the same functions the document uses.
+#define TIXML_SAX_CHUNK 16384
+
+struct TiXmlSaxParserData
+{
+	FILE*			file;
+	char*			buf;		// file data, with normalized newlines
+	size_t			cap;
+	const char*		base;		// buf or data given to Parse()
+	size_t			len;
+	size_t			pos;		// start of current token
+	bool			eof;
+	bool			lastCR;
+	int				rowBase;	// lines dropped from the buffer
+
+	TIXML_STRING*	stack;		// names of open elements
+	int				depth;
+	int				stackCap;
+
+	TIXML_STRING*	attrs;		// name/value pairs of current element
+	int				attrsCap;
+	const char**	attrPtrs;
+
+	TIXML_STRING	name;
+	TIXML_STRING	text;
+};
+
+static void SaxGrowStrings( TIXML_STRING*& arr, int& cap, int need )
+{
+	if ( need <= cap )
+		return;
+
+	int ncap = cap ? cap * 2 : 16;
+	while ( ncap < need ) ncap *= 2;
+
+	TIXML_STRING* narr = new TIXML_STRING[ ncap ];
+	for ( int i = 0; i < cap; ++i )
+		narr[i] = arr[i];
+
+	delete [] arr;
+	arr = narr;
+	cap = ncap;
+}
+
+TiXmlSaxParser::TiXmlSaxParser( TiXmlSaxHandler* h ) : handler( h ), errorId( 0 ), errorRow( 0 )
+{
+	data = new TiXmlSaxParserData;
+	data->file = 0;
+	data->buf = 0;
+	data->cap = 0;
+	data->stack = 0;
+	data->stackCap = 0;
+	data->attrs = 0;
+	data->attrsCap = 0;
+	data->attrPtrs = 0;
+}
+
+TiXmlSaxParser::~TiXmlSaxParser()
+{
+	delete [] data->buf;
+	delete [] data->stack;
+	delete [] data->attrs;
+	delete [] data->attrPtrs;
+	delete data;
+}
+
+const char* TiXmlSaxParser::ErrorDesc() const
+{
+	if ( errorId < 0 || errorId >= TiXmlBase::TIXML_ERROR_STRING_COUNT )
+		return "";
+	return TiXmlBase::errorString[ errorId ];
+}
+
+const char* TiXmlSaxParser::Attribute( const char** attrs, const char* name )
+{
+	for ( ; attrs && *attrs; attrs += 2 )
+	{
+		if ( strcmp( attrs[0], name ) == 0 )
+			return attrs[1];
+	}
+	return 0;
+}
+
+void TiXmlSaxParser::SetError( int err, const char* p )
+{
+	errorId = err;
+	errorRow = data->rowBase + 1;
+
+	if ( p && data->base )
+	{
+		for ( const char* s = data->base; s < p && *s; ++s )
+		{
+			if ( *s == '\n' )
+				++errorRow;
+		}
+	}
+}
+
+// Drop everything before current token and append next chunk. Returns false if there is no more data.
+bool TiXmlSaxParser::Fill( void )
+{
+	if ( !data->file || data->eof )
+		return false;
+
+	for ( size_t i = 0; i < data->pos; ++i )
+	{
+		if ( data->buf[i] == '\n' )
+			++data->rowBase;
+	}
+
+	data->len -= data->pos;
+	if ( data->len )
+		memmove( data->buf, data->buf + data->pos, data->len );
+	data->pos = 0;
+
+	if ( data->cap < data->len + TIXML_SAX_CHUNK + 1 )
+	{
+		size_t ncap = data->cap ? data->cap * 2 : TIXML_SAX_CHUNK * 2;
+		while ( ncap < data->len + TIXML_SAX_CHUNK + 1 ) ncap *= 2;
+
+		char* nbuf = new char[ ncap ];
+		if ( data->len )
+			memcpy( nbuf, data->buf, data->len );
+		delete [] data->buf;
+		data->buf = nbuf;
+		data->cap = ncap;
+	}
+
+	char* in = data->buf + data->len;
+	size_t n = fread( in, 1, TIXML_SAX_CHUNK, data->file );
+
+	if ( n == 0 )
+	{
+		data->eof = true;
+		data->buf[ data->len ] = 0;
+		data->base = data->buf;
+		return false;
+	}
+
+	// normalize line breaks as TiXmlDocument::LoadFile() does; it is done in place, since output is never longer
+	char* out = in;
+	for ( size_t i = 0; i < n; ++i )
+	{
+		char c = in[i];
+
+		if ( c == 0 )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_EMBEDDED_NULL, 0 );
+			data->eof = true;
+			break;
+		}
+
+		if ( data->lastCR && c == '\n' )
+		{
+			data->lastCR = false;
+			continue;
+		}
+
+		data->lastCR = ( c == '\r' );
+		*out++ = data->lastCR ? '\n' : c;
+	}
+
+	data->len = out - data->buf;
+	data->buf[ data->len ] = 0;
+	data->base = data->buf;
+	return !errorId;
+}
+
+bool TiXmlSaxParser::ParseFile( const char* filename, TiXmlEncoding encoding )
+{
+	FILE* f = fopen( filename, "rb" );
+	if ( !f )
+	{
+		errorId = TiXmlBase::TIXML_ERROR_OPENING_FILE;
+		errorRow = 0;
+		return false;
+	}
+
+	bool ret = ParseFile( f, encoding );
+	fclose( f );
+	return ret;
+}
+
+bool TiXmlSaxParser::ParseFile( FILE* file, TiXmlEncoding encoding )
+{
+	errorId = errorRow = 0;
+
+	if ( !file )
+	{
+		errorId = TiXmlBase::TIXML_ERROR_OPENING_FILE;
+		return false;
+	}
+
+	data->file = file;
+	data->base = data->buf;
+	data->len = data->pos = 0;
+	data->eof = data->lastCR = false;
+
+	bool ret = Run( encoding );
+	data->file = 0;
+	return ret;
+}
+
+bool TiXmlSaxParser::Parse( const char* str, TiXmlEncoding encoding )
+{
+	errorId = errorRow = 0;
+
+	if ( !str )
+	{
+		errorId = TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY;
+		return false;
+	}
+
+	data->file = 0;
+	data->base = str;
+	data->len = strlen( str );
+	data->pos = 0;
+	data->eof = true;
+
+	return Run( encoding );
+}
+
+// Parse start or end tag; the whole tag up to '>' is in the buffer.
+bool TiXmlSaxParser::ParseTag( const char* p, TiXmlEncoding encoding, bool* stop )
+{
+	if ( p[1] == '/' )
+	{
+		p = TiXmlBase::ReadName( p + 2, &data->name, encoding );
+		if ( p )
+			p = TiXmlBase::SkipWhiteSpace( p, encoding );
+
+		if ( !p || *p != '>' || data->depth == 0 || data->stack[ data->depth - 1 ] != data->name )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, p );
+			return false;
+		}
+
+		--data->depth;
+		*stop = !handler->EndElement( data->name.c_str() );
+		return true;
+	}
+
+	const char* pErr = p;
+	p = TiXmlBase::ReadName( p + 1, &data->name, encoding );
+	if ( !p || data->name.empty() )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr );
+		return false;
+	}
+
+	int n = 0;
+	bool empty = false;
+
+	while ( 1 )
+	{
+		p = TiXmlBase::SkipWhiteSpace( p, encoding );
+		if ( !p || !*p )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, pErr );
+			return false;
+		}
+
+		if ( *p == '>' )
+			break;
+
+		if ( *p == '/' )
+		{
+			if ( p[1] != '>' )
+			{
+				SetError( TiXmlBase::TIXML_ERROR_PARSING_EMPTY, p );
+				return false;
+			}
+
+			empty = true;
+			break;
+		}
+
+		// the same rules as in TiXmlAttribute::Parse()
+		SaxGrowStrings( data->attrs, data->attrsCap, n * 2 + 2 );
+
+		pErr = p;
+		p = TiXmlBase::ReadName( p, &data->attrs[ n * 2 ], encoding );
+		if ( p )
+			p = TiXmlBase::SkipWhiteSpace( p, encoding );
+
+		if ( !p || *p != '=' )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+			return false;
+		}
+
+		p = TiXmlBase::SkipWhiteSpace( p + 1, encoding );
+		TIXML_STRING& value = data->attrs[ n * 2 + 1 ];
+
+		if ( *p == '\'' )
+		{
+			p = TiXmlBase::ReadText( p + 1, &value, false, "\'", false, encoding );
+		}
+		else if ( *p == '\"' )
+		{
+			p = TiXmlBase::ReadText( p + 1, &value, false, "\"", false, encoding );
+		}
+		else
+		{
+			value = "";
+			while ( *p && !TiXmlBase::IsWhiteSpace( *p ) && *p != '/' && *p != '>' )
+			{
+				if ( *p == '\'' || *p == '\"' )
+				{
+					SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+					return false;
+				}
+
+				value += *p;
+				++p;
+			}
+		}
+
+		if ( !p )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+			return false;
+		}
+
+		++n;
+	}
+
+	delete [] data->attrPtrs;
+	data->attrPtrs = new const char*[ n * 2 + 1 ];
+	for ( int i = 0; i < n * 2; ++i )
+		data->attrPtrs[i] = data->attrs[i].c_str();
+	data->attrPtrs[ n * 2 ] = 0;
+
+	if ( !handler->StartElement( data->name.c_str(), data->attrPtrs ) )
+	{
+		*stop = true;
+		return true;
+	}
+
+	if ( empty )
+	{
+		*stop = !handler->EndElement( data->name.c_str() );
+		return true;
+	}
+
+	SaxGrowStrings( data->stack, data->stackCap, data->depth + 1 );
+	data->stack[ data->depth++ ] = data->name;
+	return true;
+}
+
+bool TiXmlSaxParser::Run( TiXmlEncoding encoding )
+{
+	TiXmlSaxParserData* d = data;
+	d->depth = 0;
+	d->rowBase = 0;
+
+	bool sawElement = false;
+	bool stop = false;
+
+	// enough for BOM and the longest prefix checked below
+	while ( d->len - d->pos < 9 && Fill() )
+		;
+
+	if ( errorId )
+		return false;
+
+	const unsigned char* u = (const unsigned char*)d->base + d->pos;
+	if ( u[0] == TIXML_UTF_LEAD_0 && u[1] == TIXML_UTF_LEAD_1 && u[2] == TIXML_UTF_LEAD_2 )
+	{
+		d->pos += 3;
+		if ( encoding == TIXML_ENCODING_UNKNOWN )
+			encoding = TIXML_ENCODING_UTF8;
+	}
+
+	while ( !stop )
+	{
+		size_t off = 0;
+		const char* end;
+
+		if ( d->pos >= d->len && !Fill() )
+			break;
+
+		// text up to the next tag
+		if ( d->base[ d->pos ] != '<' )
+		{
+			while ( ( end = strchr( d->base + d->pos + off, '<' ) ) == 0 )
+			{
+				off = d->len - d->pos;
+				if ( !Fill() )
+					break;
+			}
+
+			if ( errorId )
+				return false;
+
+			if ( !end )
+			{
+				// trailing white space after root element is fine; anything else is unclosed element
+				if ( d->depth > 0 )
+				{
+					SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, d->base + d->len );
+					return false;
+				}
+				break;
+			}
+
+			if ( d->depth > 0 )
+			{
+				if ( encoding == TIXML_ENCODING_UNKNOWN )
+					encoding = TIXML_ENCODING_UTF8;
+
+				TiXmlBase::ReadText( d->base + d->pos, &d->text, true, "<", false, encoding );
+
+				bool blank = true;
+				for ( size_t i = 0; i < d->text.length() && blank; ++i )
+					blank = TiXmlBase::IsWhiteSpace( d->text[i] );
+
+				if ( !blank && !handler->Text( d->text.c_str(), false ) )
+					break;
+			}
+
+			d->pos = end - d->base;
+			continue;
+		}
+
+		while ( d->len - d->pos < 9 && Fill() )
+			;
+
+		if ( errorId )
+			return false;
+
+		const char* p = d->base + d->pos;
+		const char* endTag;
+		size_t start;
+
+		if ( TiXmlBase::StringEqual( p, "<!--", false, encoding ) )
+		{
+			start = 4;
+			endTag = "-->";
+		}
+		else if ( TiXmlBase::StringEqual( p, "<![CDATA[", false, encoding ) )
+		{
+			start = 9;
+			endTag = "]]>";
+		}
+		else if ( p[1] == '?' )
+		{
+			start = 2;
+			endTag = "?>";
+		}
+		else
+		{
+			start = 1;
+			endTag = 0;
+		}
+
+		if ( endTag )
+		{
+			size_t tlen = strlen( endTag );
+
+			off = start;
+			while ( ( end = strstr( d->base + d->pos + off, endTag ) ) == 0 )
+			{
+				// keep searching from where it stopped; the end can be split between chunks
+				size_t have = d->len - d->pos;
+				off = ( have > start + tlen ) ? have - tlen + 1 : start;
+				if ( !Fill() )
+					break;
+			}
+
+			if ( errorId )
+				return false;
+
+			p = d->base + d->pos;
+			if ( !end )
+			{
+				SetError( start == 2 ? TiXmlBase::TIXML_ERROR_PARSING_DECLARATION :
+						  start == 4 ? TiXmlBase::TIXML_ERROR_PARSING_COMMENT : TiXmlBase::TIXML_ERROR_PARSING_CDATA, p );
+				return false;
+			}
+
+			if ( start == 4 )
+			{
+				d->text.assign( p + 4, end - p - 4 );
+				stop = !handler->Comment( d->text.c_str() );
+			}
+			else if ( start == 9 )
+			{
+				if ( d->depth > 0 )
+				{
+					d->text.assign( p + 9, end - p - 9 );
+					stop = !handler->Text( d->text.c_str(), true );
+				}
+			}
+			else if ( encoding == TIXML_ENCODING_UNKNOWN && TiXmlBase::StringEqual( p, "<?xml", true, encoding ) )
+			{
+				// the same check as in TiXmlDocument::Parse()
+				encoding = TIXML_ENCODING_UTF8;
+
+				d->text.assign( p, end - p );
+				const char* enc = strstr( d->text.c_str(), "encoding" );
+				if ( enc )
+				{
+					enc = TiXmlBase::SkipWhiteSpace( enc + 8, encoding );
+					if ( *enc == '=' )
+					{
+						enc = TiXmlBase::SkipWhiteSpace( enc + 1, encoding );
+						if ( *enc == '\"' || *enc == '\'' )
+							++enc;
+
+						if ( !TiXmlBase::StringEqual( enc, "UTF-8", true, encoding ) && 
+							 !TiXmlBase::StringEqual( enc, "UTF8", true, encoding ) )
+							encoding = TIXML_ENCODING_LEGACY;
+					}
+				}
+			}
+
+			d->pos = ( end - d->base ) + tlen;
+			continue;
+		}
+
+		// element tag or DOCTYPE; find '>' outside of quoted values and DOCTYPE internal subset
+		bool markup = ( p[1] == '!' );
+		char quote = 0;
+		int brackets = 0;
+		const char* s;
+
+		off = start;
+		end = 0;
+
+		while ( 1 )
+		{
+			for ( s = d->base + d->pos + off; *s; ++s )
+			{
+				if ( quote )
+				{
+					if ( *s == quote ) quote = 0;
+				}
+				else if ( markup )
+				{
+					if ( *s == '[' ) ++brackets;
+					else if ( *s == ']' && brackets > 0 ) --brackets;
+					else if ( *s == '>' && brackets == 0 ) break;
+				}
+				else if ( *s == '\"' || *s == '\'' )
+				{
+					quote = *s;
+				}
+				else if ( *s == '>' )
+				{
+					break;
+				}
+			}
+
+			if ( *s )
+			{
+				end = s;
+				break;
+			}
+
+			off = d->len - d->pos;
+			if ( !Fill() )
+				break;
+		}
+
+		if ( errorId )
+			return false;
+
+		p = d->base + d->pos;
+		if ( !end )
+		{
+			SetError( markup ? TiXmlBase::TIXML_ERROR_PARSING_UNKNOWN : TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, p );
+			return false;
+		}
+
+		if ( !markup )
+		{
+			if ( encoding == TIXML_ENCODING_UNKNOWN )
+				encoding = TIXML_ENCODING_UTF8;
+
+			sawElement = true;
+			if ( !ParseTag( p, encoding, &stop ) )
+				return false;
+		}
+
+		d->pos = ( end - d->base ) + 1;
+	}
+
+	if ( errorId )
+		return false;
+
+	if ( stop )
+		return false;
+
+	if ( d->depth > 0 )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, d->base + d->len );
+		return false;
+	}
+
+	if ( !sawElement )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+		return false;
+	}
+
+	return true;
+}
@@ -579,26 +579,73 @@ xdg_mime_get_mime_type_for_file2 (const char *file_name)
   if (stat (file_name, &buf) != 0)
     return XDG_MIME_TYPE_UNKNOWN;
 
-  if (S_ISDIR (buf.st_mode))
+  return xdg_mime_get_mime_type_for_stat (file_name, &buf);
+}
+
+const char *
+xdg_mime_get_mime_type_for_stat (const char  *file_name,
+                                 struct stat *statbuf)
+{
+  if (S_ISDIR (statbuf->st_mode))
     return xdg_mime_type_folder;
 
-  if (S_ISCHR (buf.st_mode))
+  if (S_ISCHR (statbuf->st_mode))
     return xdg_mime_type_chardev;
 
-  if (S_ISBLK (buf.st_mode))
+  if (S_ISBLK (statbuf->st_mode))
     return xdg_mime_type_blockdev;
 
-  if (S_ISFIFO (buf.st_mode))
+  if (S_ISFIFO (statbuf->st_mode))
     return xdg_mime_type_fifo;
 
-  if (S_ISSOCK (buf.st_mode))
+  if (S_ISSOCK (statbuf->st_mode))
     return xdg_mime_type_socket;
 
-  if (S_ISLNK (buf.st_mode))
+  if (S_ISLNK (statbuf->st_mode))
     return xdg_mime_type_symlink;
 
   /* now do real checks */
-  return xdg_mime_get_mime_type_for_file (file_name, &buf);
+  return xdg_mime_get_mime_type_for_file (file_name, statbuf);
+}
+
+int
+xdg_mime_get_mime_type_candidates (const char *file_name,
+                                   const char *mime_types[],
+                                   int         n_mime_types)
+{
+  const char *base_name;
+
+  if (file_name == NULL)
+    return -1;
+  if (! _xdg_utf8_validate (file_name))
+    return -1;
+
+  base_name = _xdg_get_base_name (file_name);
+
+  if (_caches)
+    return _xdg_mime_cache_get_mime_types_from_file_name (base_name, mime_types, n_mime_types);
+
+  return _xdg_glob_hash_lookup_file_name (global_hash, base_name, mime_types, n_mime_types);
+}
+
+const char *
+xdg_mime_get_mime_type_for_data_candidates (const void *data,
+                                            size_t      len,
+                                            const char *mime_types[],
+                                            int         n_mime_types)
+{
+  const char *mime_type;
+
+  if (_caches)
+    return _xdg_mime_cache_get_mime_type_for_data_candidates (data, len, mime_types, n_mime_types);
+
+  mime_type = _xdg_mime_magic_lookup_data (global_magic, data, len, NULL,
+					   mime_types, n_mime_types);
+
+  if (mime_type)
+    return mime_type;
+
+  return XDG_MIME_TYPE_UNKNOWN;
 }
 
 const char *
@@ -72,6 +72,9 @@ typedef void (*XdgMimeDestroy)  (void *user_data);
 #define xdg_mime_get_generic_icon             XDG_ENTRY(get_generic_icon)
 
 #define xdg_mime_get_mime_type_for_file2      XDG_ENTRY(get_mime_type_for_file2)
+#define xdg_mime_get_mime_type_for_stat       XDG_ENTRY(get_mime_type_for_stat)
+#define xdg_mime_get_mime_type_candidates     XDG_ENTRY(get_mime_type_candidates)
+#define xdg_mime_get_mime_type_for_data_candidates XDG_ENTRY(get_mime_type_for_data_candidates)
 #define xdg_mime_find_data                    XDG_ENTRY(find_data)
 
 #define _xdg_mime_mime_type_equal             XDG_RESERVED_ENTRY(mime_type_equal)
@@ -137,6 +140,26 @@ const char  *xdg_mime_find_data                    (const char *name);
  */
 const char  *xdg_mime_get_mime_type_for_file2      (const char *file_name);
 
+/* The same as xdg_mime_get_mime_type_for_file2(), but with already stat()-ed file. */
+const char  *xdg_mime_get_mime_type_for_stat       (const char  *file_name,
+                                                    struct stat *statbuf);
+
+/* 
+ * xdg_mime_get_mime_type_for_file() split in two steps, so file content can be read elsewhere (e.g. in
+ * other threads). First one returns number of types matched by file name (-1 if name is not valid UTF-8);
+ * if it is not exactly one, content is needed and is checked with the second one, using the same candidates.
+ *
+ * They will not check for changed database, so returned values are valid until xdg_mime_shutdown(). Database
+ * must be already loaded, e.g. with xdg_mime_get_max_buffer_extents().
+ */
+int          xdg_mime_get_mime_type_candidates     (const char *file_name,
+                                                    const char *mime_types[],
+                                                    int         n_mime_types);
+const char  *xdg_mime_get_mime_type_for_data_candidates (const void *data,
+                                                    size_t      len,
+                                                    const char *mime_types[],
+                                                    int         n_mime_types);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -660,6 +660,15 @@ _xdg_mime_cache_get_mime_type_for_data (const void *data,
   return cache_get_mime_type_for_data (data, len, result_prio, NULL, 0);
 }
 
+const char *
+_xdg_mime_cache_get_mime_type_for_data_candidates (const void *data,
+						   size_t      len,
+						   const char *mime_types[],
+						   int         n_mime_types)
+{
+  return cache_get_mime_type_for_data (data, len, NULL, mime_types, n_mime_types);
+}
+
 const char *
 _xdg_mime_cache_get_mime_type_for_file (const char  *file_name,
 					struct stat *statbuf)
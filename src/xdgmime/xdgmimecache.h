@@ -38,6 +38,7 @@ typedef struct _XdgMimeCache XdgMimeCache;
 #define _xdg_mime_cache_get_max_buffer_extents        XDG_RESERVED_ENTRY(cache_get_max_buffer_extents)
 #define _xdg_mime_cache_get_mime_type_for_data        XDG_RESERVED_ENTRY(cache_get_mime_type_for_data)
 #define _xdg_mime_cache_get_mime_type_for_file        XDG_RESERVED_ENTRY(cache_get_mime_type_for_file)
+#define _xdg_mime_cache_get_mime_type_for_data_candidates XDG_RESERVED_ENTRY(cache_get_mime_type_for_data_candidates)
 #define _xdg_mime_cache_get_mime_type_from_file_name  XDG_RESERVED_ENTRY(cache_get_mime_type_from_file_name)
 #define _xdg_mime_cache_get_mime_types_from_file_name XDG_RESERVED_ENTRY(cache_get_mime_types_from_file_name)
 #define _xdg_mime_cache_list_mime_parents             XDG_RESERVED_ENTRY(cache_list_mime_parents)
@@ -60,6 +61,10 @@ const char  *_xdg_mime_cache_get_mime_type_for_data       (const void *data,
 							   int        *result_prio);
 const char  *_xdg_mime_cache_get_mime_type_for_file       (const char  *file_name,
 							   struct stat *statbuf);
+const char  *_xdg_mime_cache_get_mime_type_for_data_candidates (const void *data,
+								size_t      len,
+								const char *mime_types[],
+								int         n_mime_types);
 int          _xdg_mime_cache_get_mime_types_from_file_name (const char *file_name,
 							    const char  *mime_types[],
 							    int          n_mime_types);
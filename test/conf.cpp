@@ -279,3 +279,135 @@ UT_FUNC(ConfigGetlineTest2, "Test allocated config_getline")
 	fclose(f);
 	delete [] buff;
 }
+
+UT_FUNC(ConfigTestManyKeys, "Test Config with many keys")
+{
+	Config c;
+	char key[32], val[32];
+	int i, dummy;
+
+	for(i = 0; i < 2000; i++) {
+		snprintf(key, sizeof(key), "key%i", i);
+		snprintf(val, sizeof(val), "%i", i);
+		c.set("Section", key, val);
+
+		snprintf(key, sizeof(key), "Section%i", i % 50);
+		c.set(key, "Key", i);
+	}
+
+	UT_VERIFY( c.num_sections() == 51 );
+
+	for(i = 0; i < 2000; i++) {
+		snprintf(key, sizeof(key), "key%i", i);
+		UT_VERIFY( c.get("Section", key, dummy, -1) == true );
+		UT_VERIFY( dummy == i );
+	}
+
+	/* key lookups are not prefix matches */
+	UT_VERIFY( c.key_exist("Section", "key") == false );
+	UT_VERIFY( c.key_exist("Section", "key20000") == false );
+	UT_VERIFY( c.exist("Section1000") == false );
+
+	/* last set value wins */
+	UT_VERIFY( c.get("Section7", "Key", dummy, -1) == true );
+	UT_VERIFY( dummy == 1957 );
+
+	c.save("foo.conf");
+	c.clear();
+	UT_VERIFY( c.exist("Section") == false );
+
+	UT_VERIFY( c.load("foo.conf") == true );
+	UT_VERIFY( c.num_sections() == 51 );
+	UT_VERIFY( c.get("Section", "key1999", dummy, -1) == true );
+	UT_VERIFY( dummy == 1999 );
+
+	/* order of keys must be preserved on save */
+	FILE *f = fopen("foo.conf", "r");
+	if(!f) {
+		UT_FAIL("No foo.conf, but expected to be");
+		return;
+	}
+
+	char* buff = NULL;
+	int len = 0;
+
+	UT_VERIFY( config_getline(&buff, &len, f) != -1 );
+	UT_VERIFY( STR_EQUAL(buff, "[Section]\n") );
+	UT_VERIFY( config_getline(&buff, &len, f) != -1 );
+	UT_VERIFY( STR_EQUAL(buff, "key0=0\n") );
+	UT_VERIFY( config_getline(&buff, &len, f) != -1 );
+	UT_VERIFY( STR_EQUAL(buff, "key1=1\n") );
+
+	fclose(f);
+	delete [] buff;
+
+	file_remove("foo.conf");
+}
+
+UT_FUNC(ConfigTestInPlace, "Test Config in place parsing")
+{
+	FILE *f = fopen("foo.conf", "w");
+	if(!f) {
+		UT_FAIL("Unable to create foo.conf");
+		return;
+	}
+
+	fprintf(f, "# comment\n");
+	fprintf(f, "  [  Section 1  ]  \r\n");
+	fprintf(f, "  Key 1  =  value 1  \r\n");
+	fprintf(f, "Key2=\n");
+	fprintf(f, "Key3 = first\n");
+	fprintf(f, "Key3 = second\n");
+	fprintf(f, "[Section 2]\n");
+	fprintf(f, "Key = a = b");
+	fclose(f);
+
+	Config c;
+	char buff[128];
+
+	UT_VERIFY( c.load("foo.conf") == true );
+	UT_VERIFY( c.line() == 8 );
+	UT_VERIFY( c.num_sections() == 2 );
+
+	UT_VERIFY( c.get("Section 1", "Key 1", buff, sizeof(buff)) == true );
+	UT_VERIFY( STR_EQUAL(buff, "value 1") );
+	UT_VERIFY( c.get("Section 1", "Key2", buff, sizeof(buff)) == true );
+	UT_VERIFY( STR_EQUAL(buff, "") );
+	UT_VERIFY( c.get("Section 1", "Key3", buff, sizeof(buff)) == true );
+	UT_VERIFY( STR_EQUAL(buff, "second") );
+
+	/* last line without newline */
+	UT_VERIFY( c.get("Section 2", "Key", buff, sizeof(buff)) == true );
+	UT_VERIFY( STR_EQUAL(buff, "a = b") );
+
+	/* replace value loaded from the file */
+	c.set("Section 1", "Key3", "third");
+	UT_VERIFY( c.get("Section 1", "Key3", buff, sizeof(buff)) == true );
+	UT_VERIFY( STR_EQUAL(buff, "third") );
+
+	f = fopen("foo.conf", "w");
+	fprintf(f, "[Section]\nKey without delimiter\n");
+	fclose(f);
+
+	UT_VERIFY( c.load("foo.conf") == false );
+	UT_VERIFY( c.error() == CONF_ERR_BAD );
+
+	f = fopen("foo.conf", "w");
+	fprintf(f, "Key = value\n[Section]\n");
+	fclose(f);
+
+	UT_VERIFY( c.load("foo.conf") == false );
+	UT_VERIFY( c.error() == CONF_ERR_SECTION );
+
+	f = fopen("foo.conf", "w");
+	fprintf(f, "[Section\nKey = value\n");
+	fclose(f);
+
+	UT_VERIFY( c.load("foo.conf") == false );
+	UT_VERIFY( c.error() == CONF_ERR_BAD );
+
+	UT_VERIFY( c.load("this/file/should/not/exists.conf") == false );
+	UT_VERIFY( c.error() == CONF_ERR_FILE );
+
+	file_remove("foo.conf");
+}
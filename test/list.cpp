@@ -1,4 +1,5 @@
 #include <edelib/List.h>
+#include <edelib/String.h>
 #include "UnitTest.h"
 #include <stdio.h>
 
@@ -422,3 +423,39 @@ UT_FUNC(ListComparison, "Test std::list comparison")
 	for(unsigned int i = 0; i < els.size(); i++, ++eit, ++sit)
 		UT_VERIFY( *eit == *sit );
 }
+
+UT_FUNC(ListTestNodePool, "Test list node pool")
+{
+	list<String> ls;
+	ls.set_node_pool(4);
+
+	for(int n = 0; n < 3; n++) {
+		ls.push_back("first");
+		ls.push_back("second");
+		ls.push_back("third");
+		ls.push_back("fourth");
+		ls.push_back("fifth");
+
+		UT_VERIFY( ls.size() == 5 );
+		UT_VERIFY( ls.front() == "first" );
+		UT_VERIFY( ls.back() == "fifth" );
+
+		list<String>::iterator it = ls.begin();
+		++it;
+		it = ls.erase(it);
+		UT_VERIFY( *it == "third" );
+
+		ls.insert(it, "second again");
+		it = ls.begin();
+		++it;
+		UT_VERIFY( *it == "second again" );
+		UT_VERIFY( ls.size() == 5 );
+
+		ls.clear();
+		UT_VERIFY( ls.size() == 0 );
+	}
+
+	ls.push_back("last");
+	ls.set_node_pool(0);
+	UT_VERIFY( ls.front() == "last" );
+}
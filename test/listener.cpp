@@ -0,0 +1,288 @@
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <edelib/Listener.h>
+
+#include "UnitTest.h"
+
+EDELIB_NS_USE
+
+static int read_count = 0, write_count = 0, second_count = 0;
+static char last_char = 0;
+
+static void read_cb(int fd, void *arg) {
+	char c;
+	if(read(fd, &c, 1) == 1) last_char = c;
+	read_count++;
+}
+
+static void write_cb(int fd, void *arg) {
+	write_count++;
+}
+
+static void second_cb(int fd, void *arg) {
+	second_count++;
+}
+
+static int pipes[2][2];
+
+/* removes both read ends; the other callback should not be called even if it was ready */
+static void remove_cb(int fd, void *arg) {
+	read_count++;
+
+	listener_remove_fd(pipes[0][0]);
+	listener_remove_fd(pipes[1][0]);
+}
+
+UT_FUNC(ListenerTestRead, "Test listener read callback")
+{
+	int p[2];
+	UT_VERIFY( pipe(p) == 0 );
+
+	read_count = 0;
+	listener_add_fd(p[0], read_cb);
+
+	/* nothing to read */
+	UT_VERIFY( listener_wait(0.01) == 0 );
+	UT_VERIFY( read_count == 0 );
+
+	write(p[1], "a", 1);
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( read_count == 1 );
+	UT_VERIFY( last_char == 'a' );
+
+	write(p[1], "b", 1);
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( read_count == 2 );
+	UT_VERIFY( last_char == 'b' );
+
+	listener_remove_fd(p[0]);
+	write(p[1], "c", 1);
+	listener_wait(0.01);
+	UT_VERIFY( read_count == 2 );
+
+	close(p[0]);
+	close(p[1]);
+}
+
+UT_FUNC(ListenerTestReadWrite, "Test listener read/write callbacks")
+{
+	int p[2];
+	UT_VERIFY( pipe(p) == 0 );
+
+	read_count = write_count = 0;
+	listener_add_fd(p[0], LISTENER_READ, read_cb);
+	listener_add_fd(p[1], LISTENER_WRITE, write_cb);
+
+	/* pipe is writable immediately */
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( write_count == 1 );
+	UT_VERIFY( read_count == 0 );
+
+	listener_remove_fd(p[1], LISTENER_WRITE);
+	write(p[1], "x", 1);
+
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( write_count == 1 );
+	UT_VERIFY( read_count == 1 );
+	UT_VERIFY( last_char == 'x' );
+
+	listener_remove_fd(p[0]);
+	close(p[0]);
+	close(p[1]);
+}
+
+UT_FUNC(ListenerTestSameFd, "Test listener callbacks on the same descriptor")
+{
+	int p[2];
+	UT_VERIFY( pipe(p) == 0 );
+
+	read_count = second_count = 0;
+	listener_add_fd(p[0], LISTENER_READ, read_cb);
+	listener_add_fd(p[0], LISTENER_EXCEPT, second_cb);
+
+	write(p[1], "r", 1);
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( read_count == 1 );
+	UT_VERIFY( second_count == 0 );
+
+	/* replaces read_cb */
+	listener_add_fd(p[0], LISTENER_READ, second_cb);
+	write(p[1], "s", 1);
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( read_count == 1 );
+	UT_VERIFY( second_count == 1 );
+
+	listener_remove_fd(p[0], LISTENER_READ | LISTENER_EXCEPT);
+	UT_VERIFY( listener_wait(0.01) == 0 );
+
+	close(p[0]);
+	close(p[1]);
+}
+
+UT_FUNC(ListenerTestRemoveInCallback, "Test listener remove from callback")
+{
+	UT_VERIFY( pipe(pipes[0]) == 0 );
+	UT_VERIFY( pipe(pipes[1]) == 0 );
+
+	read_count = 0;
+	listener_add_fd(pipes[0][0], remove_cb);
+	listener_add_fd(pipes[1][0], remove_cb);
+
+	write(pipes[0][1], "a", 1);
+	write(pipes[1][1], "b", 1);
+
+	UT_VERIFY( listener_wait(1) > 0 );
+	UT_VERIFY( read_count == 1 );
+	UT_VERIFY( listener_wait(0.01) == 0 );
+
+	for(int i = 0; i < 2; i++) {
+		close(pipes[i][0]);
+		close(pipes[i][1]);
+	}
+}
+
+UT_FUNC(ListenerTestMany, "Test listener with many descriptors")
+{
+	int p[64][2];
+	int i, n = 0;
+
+	for(i = 0; i < 64; i++) {
+		if(pipe(p[i]) != 0) break;
+		listener_add_fd(p[i][0], read_cb);
+	}
+
+	n = i;
+	UT_VERIFY( n == 64 );
+
+	read_count = 0;
+	for(i = 0; i < n; i += 2)
+		write(p[i][1], "m", 1);
+
+	while(read_count < n / 2 && listener_wait(1) > 0)
+		;
+
+	UT_VERIFY( read_count == n / 2 );
+
+	for(i = 0; i < n; i++) {
+		listener_remove_fd(p[i][0]);
+		close(p[i][0]);
+		close(p[i][1]);
+	}
+
+	UT_VERIFY( listener_wait(0.01) == 0 );
+}
+
+static int timeout_count = 0, repeat_count = 0, idle_count = 0;
+static int order[8], norder = 0;
+
+static void timeout_cb(void *arg) {
+	timeout_count++;
+	if(arg && norder < 8) order[norder++] = *(int*)arg;
+}
+
+static void repeat_cb(void *arg) {
+	repeat_count++;
+	if(repeat_count < 5) listener_repeat_timeout(0.01, repeat_cb);
+}
+
+static void idle_cb(void *arg) {
+	idle_count++;
+	if(idle_count == 3) listener_remove_idle(idle_cb);
+}
+
+static double now(void) {
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+UT_FUNC(ListenerTestTimeout, "Test listener timeouts")
+{
+	int vals[3] = {1, 2, 3};
+	double start;
+
+	timeout_count = 0;
+	norder = 0;
+
+	listener_add_timeout(0.06, timeout_cb, &vals[2]);
+	listener_add_timeout(0.02, timeout_cb, &vals[0]);
+	listener_add_timeout(0.04, timeout_cb, &vals[1]);
+	listener_add_timeout(0.03, timeout_cb);
+	UT_VERIFY( listener_has_timeout(timeout_cb, &vals[1]) == true );
+
+	listener_remove_timeout(timeout_cb);
+	UT_VERIFY( listener_has_timeout(timeout_cb) == false );
+	UT_VERIFY( listener_has_timeout(timeout_cb, &vals[1]) == true );
+
+	start = now();
+	while(timeout_count < 3 && now() - start < 2)
+		listener_wait(10);
+
+	/* no descriptors are used, so it must wake up because of timeouts */
+	UT_VERIFY( timeout_count == 3 );
+	UT_VERIFY( now() - start >= 0.05 );
+	UT_VERIFY( norder == 3 );
+	UT_VERIFY( order[0] == 1 );
+	UT_VERIFY( order[1] == 2 );
+	UT_VERIFY( order[2] == 3 );
+
+	/* far timeout does not fire, but can be removed */
+	listener_add_timeout(3600 * 10, timeout_cb);
+	listener_wait(0.01);
+	UT_VERIFY( timeout_count == 3 );
+	UT_VERIFY( listener_has_timeout(timeout_cb) == true );
+	listener_remove_timeout(timeout_cb);
+	UT_VERIFY( listener_has_timeout(timeout_cb) == false );
+}
+
+UT_FUNC(ListenerTestRepeatTimeout, "Test listener repeat timeout")
+{
+	double start = now();
+
+	repeat_count = 0;
+	listener_add_timeout(0.01, repeat_cb);
+
+	while(repeat_count < 5 && now() - start < 2)
+		listener_wait(10);
+
+	UT_VERIFY( repeat_count == 5 );
+	UT_VERIFY( now() - start >= 0.05 );
+	UT_VERIFY( listener_has_timeout(repeat_cb) == false );
+}
+
+UT_FUNC(ListenerTestManyTimeouts, "Test listener with many timeouts")
+{
+	double start = now();
+
+	timeout_count = 0;
+	norder = 8;
+
+	for(int i = 0; i < 5000; i++)
+		listener_add_timeout((i % 100) / 1000.0, timeout_cb);
+
+	while(timeout_count < 5000 && now() - start < 2)
+		listener_wait(10);
+
+	UT_VERIFY( timeout_count == 5000 );
+	UT_VERIFY( listener_has_timeout(timeout_cb) == false );
+}
+
+UT_FUNC(ListenerTestIdle, "Test listener idle callbacks")
+{
+	double start = now();
+
+	idle_count = 0;
+	listener_add_idle(idle_cb);
+
+	/* idle callbacks make listener_wait() return immediately */
+	for(int i = 0; i < 3; i++)
+		listener_wait(10);
+
+	UT_VERIFY( now() - start < 1 );
+	UT_VERIFY( idle_count == 3 );
+
+	/* removed from itself */
+	listener_wait(0.01);
+	UT_VERIFY( idle_count == 3 );
+}
@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <edelib/MimeType.h>
 #include <edelib/Directory.h>
+#include <edelib/FileTest.h>
+#include <edelib/Missing.h>
 
 #include "UnitTest.h"
 
@@ -77,3 +80,221 @@ UT_FUNC(MimeTypeTestCaveat, "Test MimeType caveats")
 	mt.set("/");
 	UT_VERIFY( mt.type() == "inode/directory" );
 }
+
+UT_FUNC(MimeTypeTestCache, "Test MimeType cache")
+{
+	MimeType mt;
+
+	dir_create(".mime-cache");
+	UT_VERIFY( mt.set(".mime-cache") == true );
+	UT_VERIFY( mt.type() == "inode/directory" );
+
+	/* cached */
+	UT_VERIFY( mt.set(".mime-cache") == true );
+	UT_VERIFY( mt.type() == "inode/directory" );
+
+	/* the same name, but different file; must not be taken from cache */
+	dir_remove(".mime-cache");
+	FILE* f = fopen(".mime-cache", "w");
+	fputs("some content", f);
+	fclose(f);
+
+	UT_VERIFY( mt.set(".mime-cache") == true );
+	UT_VERIFY( mt.type() != "inode/directory" );
+
+	remove(".mime-cache");
+	UT_VERIFY( mt.set(".mime-cache") == false );
+	UT_VERIFY( mt.type() == "" );
+
+	/* without cache */
+	MimeType::cache_size(0);
+	dir_create(".mime-cache");
+	UT_VERIFY( mt.set(".mime-cache") == true );
+	UT_VERIFY( mt.type() == "inode/directory" );
+	dir_remove(".mime-cache");
+
+	MimeType::cache_size(1024);
+	MimeType::shutdown();
+
+	/* database is loaded again */
+	UT_VERIFY( mt.set("/") == true );
+	UT_VERIFY( mt.type() == "inode/directory" );
+}
+
+UT_FUNC(MimeTypeTestBulk, "Test bulk MimeType detection")
+{
+	const char* names[] = {
+		"mime.cpp", "Jamfile", "UnitTest.h", "perf", ".", "/", "/usr", "not-existing-file", 0
+	};
+
+	list<String> files, types, expected;
+
+	/* enough files, so threads are started */
+	for(int j = 0; j < 4; j++) {
+		for(int i = 0; names[i]; i++)
+			files.push_back(names[i]);
+	}
+
+	/* compare with set() without cache */
+	MimeType::cache_size(0);
+
+	MimeType mt;
+	list<String>::iterator it = files.begin(), ite = files.end();
+	for(; it != ite; ++it) {
+		if(mt.set((*it).c_str()))
+			expected.push_back(mt.type());
+		else
+			expected.push_back("");
+	}
+
+	MimeType::cache_size(1024);
+
+	UT_VERIFY( mime_types_for_files(files, types) == files.size() - 4 );
+	UT_VERIFY( types.size() == files.size() );
+
+	list<String>::iterator et = expected.begin();
+	for(it = types.begin(), ite = types.end(); it != ite; ++it, ++et)
+		UT_VERIFY( *it == *et );
+
+	/* now from cache */
+	UT_VERIFY( mime_types_for_files(files, types, 1) == files.size() - 4 );
+
+	et = expected.begin();
+	for(it = types.begin(), ite = types.end(); it != ite; ++it, ++et)
+		UT_VERIFY( *it == *et );
+
+	files.clear();
+	UT_VERIFY( mime_types_for_files(files, types) == 0 );
+	UT_VERIFY( types.empty() );
+}
+
+UT_FUNC(MimeTypeTestGenericIcon, "Test MimeType generic icon")
+{
+	MimeType mt;
+	UT_VERIFY( mt.generic_icon_name() == "" );
+
+	UT_VERIFY( mt.set("not-existing-file") == false );
+	UT_VERIFY( mt.generic_icon_name() == "" );
+
+	UT_VERIFY( mt.set("/") == true );
+	UT_VERIFY( mt.generic_icon_name() != "" );
+}
+
+static void mime_index_write_package(const char* path, const char* fr_comment) {
+	FILE* f = fopen(path, "w");
+	if(!f) return;
+
+	/* no comment without xml:lang, so unmatched languages are not used */
+	fprintf(f,
+		"<?xml version=\"1.0\"?>\n"
+		"<mime-info xmlns=\"http://www.freedesktop.org/standards/shared-mime-info\">\n"
+		"  <mime-type type=\"inode/directory\">\n"
+		"    <comment xml:lang=\"de\">Ordner</comment>\n"
+		"    <comment xml:lang=\"fr\">%s</comment>\n"
+		"    <icon name=\"edelib-test-folder\"/>\n"
+		"    <generic-icon name=\"edelib-test-generic\"/>\n"
+		"  </mime-type>\n"
+		"</mime-info>\n", fr_comment);
+	fclose(f);
+}
+
+static void mime_index_env(const char* name, const char* val) {
+	if(val)
+		edelib_setenv(name, val, 1);
+	else
+		edelib_unsetenv(name);
+}
+
+UT_FUNC(MimeTypeTestIndex, "Test MimeType comment/icon index")
+{
+	const char* env_names[] = { "XDG_DATA_HOME", "XDG_DATA_DIRS", "XDG_CACHE_HOME", "LC_ALL", "LC_MESSAGES", "LANG", 0 };
+	String env_saved[6];
+	bool   env_set[6];
+
+	for(int i = 0; env_names[i]; i++) {
+		const char* v = getenv(env_names[i]);
+		env_set[i] = (v != NULL);
+		if(v) env_saved[i] = v;
+	}
+
+	String base = dir_current();
+	base += "/.mime-index";
+
+	String data = base + "/data", sys = base + "/sys", cache = base + "/cache";
+	String packages = data + "/mime/packages";
+	String package = packages + "/edelib-test.xml";
+
+	dir_create_with_parents(packages.c_str());
+	dir_create(sys.c_str());
+	mime_index_write_package(package.c_str(), "dossier");
+
+	/* only our package is seen and index is written to temporary cache */
+	edelib_setenv("XDG_DATA_HOME", data.c_str(), 1);
+	edelib_setenv("XDG_DATA_DIRS", sys.c_str(), 1);
+	edelib_setenv("XDG_CACHE_HOME", cache.c_str(), 1);
+	edelib_unsetenv("LC_ALL");
+	edelib_unsetenv("LC_MESSAGES");
+	edelib_setenv("LANG", "C", 1);
+
+	MimeType::shutdown();
+
+	MimeType mt;
+	UT_VERIFY( mt.set("/") == true );
+	UT_VERIFY( mt.type() == "inode/directory" );
+	UT_VERIFY( mt.icon_name() == "edelib-test-folder" );
+	UT_VERIFY( mt.generic_icon_name() == "edelib-test-generic" );
+
+	/* comment in other language must not be used */
+	UT_VERIFY( mt.comment() == "" );
+	UT_VERIFY( file_test((cache + "/edelib-mime-index-C").c_str(), FILE_TEST_IS_REGULAR) );
+
+	/* localized; new objects, since set() keeps already loaded comment for the same type */
+	edelib_setenv("LANG", "de_DE.UTF-8", 1);
+	MimeType::shutdown();
+
+	MimeType mt_de;
+	UT_VERIFY( mt_de.set("/") == true );
+	UT_VERIFY( mt_de.comment() == "Ordner" );
+	UT_VERIFY( file_test((cache + "/edelib-mime-index-de_DE.UTF-8").c_str(), FILE_TEST_IS_REGULAR) );
+
+	/* LC_MESSAGES takes precedence over LANG */
+	edelib_setenv("LC_MESSAGES", "fr_FR", 1);
+	MimeType::shutdown();
+
+	MimeType mt_fr;
+	UT_VERIFY( mt_fr.set("/") == true );
+	UT_VERIFY( mt_fr.comment() == "dossier" );
+
+	/* changed package makes index stale, so it is built again */
+	mime_index_write_package(package.c_str(), "repertoire");
+	MimeType::shutdown();
+
+	MimeType mt_stale;
+	UT_VERIFY( mt_stale.set("/") == true );
+	UT_VERIFY( mt_stale.comment() == "repertoire" );
+
+	/* the same index is loaded from the cache */
+	MimeType::shutdown();
+
+	MimeType mt_cached;
+	UT_VERIFY( mt_cached.set("/") == true );
+	UT_VERIFY( mt_cached.comment() == "repertoire" );
+
+	for(int i = 0; env_names[i]; i++)
+		mime_index_env(env_names[i], env_set[i] ? env_saved[i].c_str() : NULL);
+
+	MimeType::shutdown();
+
+	list<String> files;
+	dir_list(cache.c_str(), files, true, true);
+	for(list<String>::iterator it = files.begin(), ite = files.end(); it != ite; ++it)
+		remove((*it).c_str());
+
+	remove(package.c_str());
+	dir_remove(cache.c_str());
+	dir_remove(packages.c_str());
+	dir_remove((data + "/mime").c_str());
+	dir_remove(data.c_str());
+	dir_remove(sys.c_str());
+	dir_remove(base.c_str());
+}
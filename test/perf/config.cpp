@@ -0,0 +1,70 @@
+#include <edelib/Config.h>
+#include <edelib/File.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+
+#include "timer.hpp"
+
+#define CONFIG_FILE "perf-config.conf"
+
+EDELIB_NS_USE
+
+static void make_config(int sections, int keys) {
+	FILE* f = fopen(CONFIG_FILE, "w");
+	if(!f) {
+		std::cout << "Unable to create " << CONFIG_FILE << std::endl;
+		exit(1);
+	}
+
+	for(int i = 0; i < sections; i++) {
+		fprintf(f, "[Section %i]\n", i);
+
+		for(int j = 0; j < keys; j++)
+			fprintf(f, "Key%i = some value for key %i\n", j, j);
+
+		fprintf(f, "\n");
+	}
+
+	fclose(f);
+}
+
+static void test_config(int sections, int keys) {
+	boost::timer tim;
+	Config c;
+	char sect[64], key[64], buf[128];
+	int found = 0;
+
+	tim.restart();
+	if(!c.load(CONFIG_FILE)) {
+		std::cout << "Unable to load " << CONFIG_FILE << std::endl;
+		return;
+	}
+	std::cout << " load   : " << tim.elapsed() << std::endl;
+
+	tim.restart();
+	for(int i = 0; i < sections; i++) {
+		snprintf(sect, sizeof(sect), "Section %i", i);
+
+		for(int j = 0; j < keys; j++) {
+			snprintf(key, sizeof(key), "Key%i", j);
+			if(c.get(sect, key, buf, sizeof(buf)))
+				found++;
+		}
+	}
+	std::cout << " get    : " << tim.elapsed() << " (found " << found << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	/* by default, one section with 50000 keys */
+	int sections = (argc > 1) ? atoi(argv[1]) : 1;
+	int keys     = (argc > 2) ? atoi(argv[2]) : 50000;
+
+	std::cout << "sections: " << sections << " keys: " << keys << "\n";
+	std::cout << "-------------------------------------------------\n";
+
+	make_config(sections, keys);
+	test_config(sections, keys);
+	file_remove(CONFIG_FILE);
+	return 0;
+}
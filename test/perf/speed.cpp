@@ -3,6 +3,10 @@
 #include <stdlib.h>
 #include <iostream>
 
+#ifdef EDELIB_HAVE_RVALUE_REFERENCES
+# include <utility>
+#endif
+
 template <typename T>
 void test_str(int repeat, int loop)
 {
@@ -106,6 +110,40 @@ void test_str(int repeat, int loop)
 	}
 	total = tt.elapsed();
 	std::cout << "total = " << total << " average = " << result / repeat << std::endl;
+
+	std::cout << " short copy   : ";
+	tt.restart();
+	result = 0;
+	for(int i = 0; i < repeat; i++) {
+		tim.restart();
+		for(int j = 0; j < loop; j++) {
+			T s1("png");
+			T s2(s1);
+			T s3 = s2;
+			s3 += "/16x16";
+			stmp1 = s3;
+		}
+		result += tim.elapsed();
+	}
+	total = tt.elapsed();
+	std::cout << "total = " << total << " average = " << result / repeat << std::endl;
+
+#ifdef EDELIB_HAVE_RVALUE_REFERENCES
+	std::cout << " move         : ";
+	tt.restart();
+	result = 0;
+	for(int i = 0; i < repeat; i++) {
+		tim.restart();
+		for(int j = 0; j < loop; j++) {
+			T s1("/usr/share/icons/hicolor/48x48/apps/sample.png");
+			T s2(std::move(s1));
+			stmp1 = std::move(s2);
+		}
+		result += tim.elapsed();
+	}
+	total = tt.elapsed();
+	std::cout << "total = " << total << " average = " << result / repeat << std::endl;
+#endif
 }
 
 int main(int argc, char** argv)
@@ -0,0 +1,139 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <edelib/PtyProcess.h>
+#include <edelib/Listener.h>
+#include <edelib/String.h>
+
+#include "UnitTest.h"
+
+EDELIB_NS_USE
+
+static const char *sh_args(const char *script, const char **args) {
+	args[0] = "sh";
+	args[1] = "-c";
+	args[2] = script;
+	args[3] = NULL;
+	return "/bin/sh";
+}
+
+UT_FUNC(PtyReadLine, "Test PtyProcess::read_line()")
+{
+	PtyProcess p;
+	const char *args[4];
+	const char *cmd = sh_args("i=0; while [ $i -lt 500 ]; do echo \"line $i\"; i=$((i+1)); done", args);
+
+	UT_VERIFY( p.exec(cmd, args) == 0 );
+
+	char expect[32];
+	const char *line;
+	int i, len;
+	bool ok = true;
+
+	for(i = 0; i < 500 && ok; i++) {
+		snprintf(expect, sizeof(expect), "line %i\n", i);
+
+		/* terminal can return partial line */
+		char buf[32];
+		int n = 0;
+		while(n == 0 || buf[n - 1] != '\n') {
+			len = p.read_line_span(&line, true);
+			if(len <= 0 || n + len >= (int)sizeof(buf)) {
+				ok = false;
+				break;
+			}
+
+			memcpy(buf + n, line, len);
+			n += len;
+		}
+
+		if(ok)
+			ok = (n == (int)strlen(expect) && strncmp(buf, expect, n) == 0);
+
+		if(i == 250) {
+			p.unread_line("foo");
+			p.unread_line("baz", false);
+
+			char *s = p.read_line(false);
+			UT_VERIFY( s != NULL );
+			UT_VERIFY( strcmp(s, "bazfoo\n") == 0 );
+			free(s);
+		}
+	}
+
+	UT_VERIFY( ok == true );
+	UT_VERIFY( i == 500 );
+
+	waitpid(p.pid(), NULL, 0);
+}
+
+UT_FUNC(PtyReadAvailable, "Test PtyProcess::read_available()")
+{
+	PtyProcess p;
+	const char *args[4];
+	const char *cmd = sh_args("echo first; echo second; printf third", args);
+
+	UT_VERIFY( p.exec(cmd, args) == 0 );
+	waitpid(p.pid(), NULL, 0);
+
+	const char *data;
+	int len = p.read_line_span(&data, true);
+
+	UT_VERIFY( len == 6 );
+	UT_VERIFY( strncmp(data, "first\n", 6) == 0 );
+
+	len = p.read_available(&data);
+	UT_VERIFY( len == 12 );
+	UT_VERIFY( strncmp(data, "second\nthird", 12) == 0 );
+
+	UT_VERIFY( p.read_available(&data) == 0 );
+}
+
+struct PtyAsyncState {
+	String output;
+	int    status;
+	bool   exited;
+};
+
+static void pty_data_cb(PtyProcess *p, const char *data, int len, void *arg) {
+	PtyAsyncState *st = (PtyAsyncState*)arg;
+	st->output.append(data, len);
+}
+
+static void pty_exit_cb(PtyProcess *p, int status, void *arg) {
+	PtyAsyncState *st = (PtyAsyncState*)arg;
+	st->status = status;
+	st->exited = true;
+}
+
+UT_FUNC(PtyAsync, "Test PtyProcess async mode")
+{
+	PtyProcess p1, p2;
+	PtyAsyncState s1, s2;
+	const char *args1[4], *args2[4];
+
+	s1.exited = s2.exited = false;
+	s1.status = s2.status = -100;
+
+	const char *cmd1 = sh_args("echo one; sleep 0.1; echo two; exit 3", args1);
+	const char *cmd2 = sh_args("printf abc", args2);
+
+	/* before and after exec() */
+	p1.set_async(pty_data_cb, pty_exit_cb, &s1);
+	UT_VERIFY( p1.exec(cmd1, args1) == 0 );
+	UT_VERIFY( p2.exec(cmd2, args2) == 0 );
+	p2.set_async(pty_data_cb, pty_exit_cb, &s2);
+
+	for(int i = 0; i < 100 && !(s1.exited && s2.exited); i++)
+		listener_wait(0.1);
+
+	UT_VERIFY( s1.exited == true );
+	UT_VERIFY( s2.exited == true );
+	UT_VERIFY( s1.status == 3 );
+	UT_VERIFY( s2.status == 0 );
+	UT_VERIFY( s1.output == "one\ntwo\n" );
+	UT_VERIFY( s2.output == "abc" );
+	UT_VERIFY( p1.pid() == 0 );
+}
@@ -84,3 +84,108 @@ UT_FUNC(RegexSplitTest2, "Test regex wrinkle split")
 	UT_VERIFY( rx.split("some random text without meaning", ls) == 2 );
 	ls.clear();
 }
+
+UT_FUNC(RegexCacheTest, "Test regex pattern cache")
+{
+	Regex r1, r2;
+	Regex::MatchVec m;
+
+	/* the same pattern with different flags must not be shared */
+	UT_VERIFY( r1.compile("ab+c") == true );
+	UT_VERIFY( r2.compile("ab+c", RX_CASELESS) == true );
+	UT_VERIFY( r1.match("xxABBC") < 0 );
+	UT_VERIFY( r2.match("xxABBC", 0, &m) == 1 );
+	UT_VERIFY( (*m.begin()).offset == 2 );
+
+	UT_VERIFY( r2.compile("ab+c") == true );
+	UT_VERIFY( r2.match("xxABBC") < 0 );
+	UT_VERIFY( r2.match("xxabbc") == 1 );
+
+	/* patterns used by objects must survive cache eviction */
+	Regex::cache_size(2);
+	r1.compile("[0-9]+x");
+	r2.compile("(foo|bar)");
+
+	Regex r3;
+	for(int i = 0; i < 5; i++) {
+		r3.compile("baz");
+		r3.compile("[a-z]q");
+	}
+
+	UT_VERIFY( r1.match("abc 123x") == 1 );
+	UT_VERIFY( r2.match("a bar") == 2 );
+	UT_VERIFY( r3.match("1 zq") == 1 );
+
+	Regex::cache_size(0);
+	UT_VERIFY( r1.match("abc 123x") == 1 );
+	UT_VERIFY( r1.compile("[0-9]+x") == true );
+	UT_VERIFY( r1.match("abc 123x") == 1 );
+
+	UT_VERIFY( r1.compile("(unbalanced") == false );
+	UT_VERIFY( r1 == false );
+
+	Regex::cache_size(64);
+}
+
+static bool collect_matches(const char* str, const RegexMatch* m, int n, void* data) {
+	String* s = (String*)data;
+
+	s->append(str + m[0].offset, m[0].length);
+	if(n > 1) {
+		s->append(":");
+		s->append(str + m[1].offset, m[1].length);
+	}
+
+	s->append(",");
+	return true;
+}
+
+static bool stop_at_second(const char* str, const RegexMatch* m, int n, void* data) {
+	return ++(*(int*)data) < 2;
+}
+
+UT_FUNC(RegexMatchAllTest, "Test regex match_all")
+{
+	Regex rx;
+	String s;
+
+	rx.compile("(\\d)\\w+");
+	UT_VERIFY( rx.match_all("1ab foo 2cd 3 4e", collect_matches, &s) == 3 );
+	UT_VERIFY( s == "1ab:1,2cd:2,4e:4," );
+
+	/* empty matches must not loop */
+	s.clear();
+	rx.compile("x*");
+	UT_VERIFY( rx.match_all("axxb", collect_matches, &s) == 4 );
+	UT_VERIFY( s == ",xx,,," );
+
+	int n = 0;
+	rx.compile("\\w+");
+	UT_VERIFY( rx.match_all("a b c d", stop_at_second, &n) == 2 );
+
+	RegexMatch m[2];
+	UT_VERIFY( rx.match("  word", 0, 0, -1, m, 2) == 1 );
+	UT_VERIFY( m[0].offset == 2 && m[0].length == 4 );
+}
+
+UT_FUNC(RegexSplitSpansTest, "Test regex split to spans")
+{
+	Regex rx;
+	RegexMatch spans[4];
+
+	rx.compile("[ \t]+");
+	UT_VERIFY( rx.split("this is 1234 sample", spans, 4) == 4 );
+	UT_VERIFY( spans[0].offset == 0  && spans[0].length == 4 );
+	UT_VERIFY( spans[1].offset == 5  && spans[1].length == 2 );
+	UT_VERIFY( spans[2].offset == 8  && spans[2].length == 4 );
+	UT_VERIFY( spans[3].offset == 13 && spans[3].length == 6 );
+
+	/* too small array still counts all items */
+	UT_VERIFY( rx.split("a b c d e f", spans, 2) == 6 );
+	UT_VERIFY( spans[1].offset == 2 && spans[1].length == 1 );
+
+	UT_VERIFY( rx.split("nothing", spans, 4) == 0 );
+
+	rx.compile("[a-z]*");
+	UT_VERIFY( rx.split("some random text without meaning", spans, 4) == 2 );
+}
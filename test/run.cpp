@@ -1,7 +1,14 @@
 #include <sys/param.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <edelib/Run.h>
+#include <edelib/String.h>
+#include <edelib/Missing.h>
 
 #include "UnitTest.h"
 
@@ -48,3 +55,165 @@ UT_FUNC(RunAsync, "Test run_async()")
 
 	UT_VERIFY( run_async("./Jamfile") == RUN_NO_ACCESS );
 }
+
+UT_FUNC(RunPathCache, "Test run_sync() PATH lookup")
+{
+	String old_path = getenv("PATH");
+
+	UT_VERIFY( run_sync("pwd") == 0 );
+
+	/* remembered location must not be used when PATH is changed */
+	edelib_setenv("PATH", "/this/path/should/not/exists", 1);
+	UT_VERIFY( run_sync("pwd") == RUN_NOT_FOUND );
+	UT_VERIFY( run_async("pwd") == RUN_NOT_FOUND );
+
+	edelib_setenv("PATH", old_path.c_str(), 1);
+	UT_VERIFY( run_sync("pwd") == 0 );
+	UT_VERIFY( run_sync("pwd") == 0 );
+}
+
+UT_FUNC(RunProcessPipes, "Test RunProcess pipes")
+{
+	const char *args1[] = { "sh", "-c", "echo out; echo err >&2; exit 4", NULL };
+	RunProcess p1;
+
+	p1.args(args1);
+	p1.pipes(RUN_PIPE_STDOUT | RUN_PIPE_STDERR);
+	UT_VERIFY( p1.start() == 0 );
+	UT_VERIFY( p1.running() == true );
+	UT_VERIFY( p1.wait() == 4 );
+	UT_VERIFY( p1.running() == false );
+	UT_VERIFY( strcmp(p1.output(RUN_PIPE_STDOUT), "out\n") == 0 );
+	UT_VERIFY( strcmp(p1.output(RUN_PIPE_STDERR), "err\n") == 0 );
+
+	const char *args2[] = { "cat", NULL };
+	RunProcess p2;
+
+	p2.args(args2);
+	p2.pipes(RUN_PIPE_STDIN | RUN_PIPE_STDOUT);
+	UT_VERIFY( p2.write("foo", 3) == false );
+	UT_VERIFY( p2.start() == 0 );
+	UT_VERIFY( p2.write("hello ", 6) == true );
+	UT_VERIFY( p2.write("world\n", 6) == true );
+	p2.close_stdin();
+	UT_VERIFY( p2.wait() == 0 );
+	UT_VERIFY( strcmp(p2.output(RUN_PIPE_STDOUT), "hello world\n") == 0 );
+
+	const char *args3[] = { "sh", "-c", "echo $RUN_TEST_VAR; pwd", NULL };
+	const char *env3[]  = { "RUN_TEST_VAR=value", NULL };
+	RunProcess p3;
+
+	p3.args(args3);
+	p3.env(env3);
+	p3.cwd("/");
+	p3.pipes(RUN_PIPE_STDOUT);
+	UT_VERIFY( p3.start() == 0 );
+	UT_VERIFY( p3.wait() == 0 );
+	UT_VERIFY( strcmp(p3.output(RUN_PIPE_STDOUT), "value\n/\n") == 0 );
+
+	/* no pipes */
+	const char *args4[] = { "sh", "-c", "exit 2", NULL };
+	RunProcess p4;
+
+	p4.args(args4);
+	UT_VERIFY( p4.start() == 0 );
+	UT_VERIFY( p4.wait() == 2 );
+
+	const char *args5[] = { "this-file-is-local-and-does-not-exists", NULL };
+	RunProcess p5;
+
+	p5.args(args5);
+	UT_VERIFY( p5.start() == RUN_NOT_FOUND );
+
+	p5.args(args1);
+	p5.cwd("/this/directory/should/not/exists");
+	UT_VERIFY( p5.start() == RUN_NOT_FOUND );
+}
+
+UT_FUNC(RunProcessDestroy, "Test RunProcess destroyed while running")
+{
+	const char *args[] = { "sleep", "10", NULL };
+	int pid;
+
+	{
+		RunProcess p;
+		p.args(args);
+		UT_VERIFY( p.start() == 0 );
+		pid = p.pid();
+		UT_VERIFY( pid > 0 );
+	}
+
+	/* program is stopped and reaped, so it is neither running nor a zombie */
+	for(int i = 0; i < 100 && kill(pid, 0) == 0; i++)
+		usleep(10000);
+
+	UT_VERIFY( kill(pid, 0) == -1 && errno == ESRCH );
+
+	/* output written right before exit is not lost, even if program is noticed first */
+	const char *args2[] = { "sh", "-c", "echo done", NULL };
+	RunProcess p2;
+
+	p2.args(args2);
+	p2.pipes(RUN_PIPE_STDOUT);
+	UT_VERIFY( p2.start() == 0 );
+	UT_VERIFY( p2.wait() == 0 );
+	UT_VERIFY( strcmp(p2.output(RUN_PIPE_STDOUT), "done\n") == 0 );
+}
+
+struct RunQueueState {
+	RunQueue *queue;
+	int       statuses[8];
+	int       done;
+	bool      overflow;
+};
+
+static void queue_exit_cb(RunProcess *p, int status, void *arg) {
+	RunQueueState *st = (RunQueueState*)arg;
+
+	if(st->queue->running() > 2)
+		st->overflow = true;
+
+	st->statuses[st->done++] = status;
+}
+
+UT_FUNC(RunQueueTest, "Test RunQueue")
+{
+	RunQueue q(2);
+	RunQueueState st;
+	RunProcess jobs[6];
+	int i;
+
+	const char *ok_args[] = { "sh", "-c", "sleep 0.05; exit 5", NULL };
+	const char *bad_args[] = { "this-file-is-local-and-does-not-exists", NULL };
+
+	st.queue = &q;
+	st.done = 0;
+	st.overflow = false;
+
+	for(i = 0; i < 6; i++) {
+		jobs[i].args(i == 3 ? bad_args : ok_args);
+		jobs[i].callback(NULL, queue_exit_cb, &st);
+		q.add(&jobs[i]);
+	}
+
+	UT_VERIFY( q.running() == 2 );
+	UT_VERIFY( q.pending() == 4 );
+
+	q.wait();
+
+	UT_VERIFY( q.running() == 0 );
+	UT_VERIFY( q.pending() == 0 );
+	UT_VERIFY( st.done == 6 );
+	UT_VERIFY( st.overflow == false );
+
+	int n_ok = 0, n_bad = 0;
+	for(i = 0; i < 6; i++) {
+		if(st.statuses[i] == 5)
+			n_ok++;
+		else if(st.statuses[i] == RUN_NOT_FOUND)
+			n_bad++;
+	}
+
+	UT_VERIFY( n_ok == 5 );
+	UT_VERIFY( n_bad == 1 );
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <edelib/Sipc.h>
+#include <edelib/Listener.h>
+#include <edelib/String.h>
+
+#include "UnitTest.h"
+
+EDELIB_NS_USE
+
+#define MESSAGE_MAX 8
+
+static String messages[MESSAGE_MAX];
+static int    nmessages = 0;
+
+static void message_cb(const char *msg, void *arg) {
+	if(nmessages < MESSAGE_MAX)
+		messages[nmessages] = msg;
+	nmessages++;
+}
+
+static void wait_messages(int n) {
+	for(int i = 0; i < 100 && nmessages < n; i++)
+		listener_wait(0.1);
+}
+
+static const char *server_name(void) {
+	static char buf[64];
+	snprintf(buf, sizeof(buf), "edelib-sipc-test-%i", (int)getpid());
+	return buf;
+}
+
+UT_FUNC(SipcTestMessages, "Test Sipc messages")
+{
+	SipcServer s;
+	UT_VERIFY( s.request_name(server_name()) == true );
+	s.callback(message_cb, 0);
+
+	SipcClient c;
+	UT_VERIFY( c.connect(server_name()) == true );
+	c.set_framed(true);
+
+	nmessages = 0;
+	c.send("first");
+	c.send("");
+	c.send("third\nwith new line");
+
+	wait_messages(3);
+	UT_VERIFY( nmessages == 3 );
+	UT_VERIFY( messages[0] == "first" );
+	UT_VERIFY( messages[1] == "" );
+	UT_VERIFY( messages[2] == "third\nwith new line" );
+
+	/* old style, text line messages */
+	nmessages = 0;
+	c.set_framed(false);
+	c.send("line 1");
+	c.send("line 2");
+	c.set_framed(true);
+	c.send("framed again");
+
+	wait_messages(3);
+	UT_VERIFY( nmessages == 3 );
+	UT_VERIFY( messages[0] == "line 1" );
+	UT_VERIFY( messages[1] == "line 2" );
+	UT_VERIFY( messages[2] == "framed again" );
+}
+
+UT_FUNC(SipcTestLargeMessage, "Test Sipc large message")
+{
+	SipcServer s;
+	UT_VERIFY( s.request_name(server_name()) == true );
+	s.callback(message_cb, 0);
+
+	SipcClient c;
+	UT_VERIFY( c.connect(server_name()) == true );
+
+	String big;
+	for(int i = 0; i < 5000; i++)
+		big += "0123456789";
+
+	nmessages = 0;
+	c.send(big.c_str());
+	c.send("after big");
+
+	wait_messages(2);
+	UT_VERIFY( nmessages == 2 );
+	UT_VERIFY( messages[0].length() == 50000 );
+	UT_VERIFY( messages[0] == big );
+	UT_VERIFY( messages[1] == "after big" );
+}
+
+UT_FUNC(SipcTestManyClients, "Test Sipc with many clients")
+{
+	SipcServer s;
+	UT_VERIFY( s.request_name(server_name()) == true );
+	s.callback(message_cb, 0);
+
+	SipcClient c[20];
+	for(int i = 0; i < 20; i++)
+		UT_VERIFY( c[i].connect(server_name()) == true );
+
+	nmessages = 0;
+	for(int i = 0; i < 20; i++)
+		c[i].send("hello");
+
+	wait_messages(20);
+	UT_VERIFY( nmessages == 20 );
+	UT_VERIFY( messages[0] == "hello" );
+}
+
+static SipcServer *quit_server;
+
+static void quit_cb(const char *msg, void *arg) {
+	nmessages++;
+	if(strcmp(msg, "quit") == 0) {
+		delete quit_server;
+		quit_server = 0;
+	}
+}
+
+UT_FUNC(SipcTestQuitFromCallback, "Test Sipc server destroyed in callback")
+{
+	quit_server = new SipcServer;
+	UT_VERIFY( quit_server->request_name(server_name()) == true );
+	quit_server->callback(quit_cb, 0);
+
+	SipcClient c;
+	UT_VERIFY( c.connect(server_name()) == true );
+
+	/* all three arrive with one read; server must stop after 'quit' */
+	nmessages = 0;
+	c.send("hello");
+	c.send("quit");
+	c.send("after quit");
+
+	for(int i = 0; i < 10 && quit_server; i++)
+		listener_wait(0.1);
+
+	UT_VERIFY( quit_server == 0 );
+	UT_VERIFY( nmessages == 2 );
+}
+
+UT_FUNC(SipcTestOversizedFrame, "Test Sipc oversized frame")
+{
+	SipcServer s;
+	UT_VERIFY( s.request_name(server_name()) == true );
+	s.callback(message_cb, 0);
+
+	const char *user = getenv("USER");
+	if(!user) {
+		struct passwd *pw = getpwuid(getuid());
+		user = pw ? pw->pw_name : "__unknown__";
+	}
+
+	struct sockaddr_un addr;
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/.%s.%s.socket", server_name(), user);
+
+	int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+	UT_VERIFY( connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 );
+
+	/* frame claiming ~4GB of data; server must drop the connection */
+	unsigned char header[5] = { 0, 0xff, 0xff, 0xff, 0xf0 };
+	UT_VERIFY( write(fd, header, sizeof(header)) == (ssize_t)sizeof(header) );
+
+	char c;
+	ssize_t n = -1;
+	for(int i = 0; i < 10 && n != 0; i++) {
+		listener_wait(0.1);
+		n = recv(fd, &c, 1, MSG_DONTWAIT);
+	}
+
+	UT_VERIFY( n == 0 );
+	close(fd);
+}
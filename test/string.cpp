@@ -210,7 +210,7 @@ UT_FUNC(StringPrintf, "Test string printf")
 	UT_VERIFY( s.length() == 0 );
 	UT_VERIFY( s.capacity() == 20 );
 	s.clear();
-	UT_VERIFY( s.capacity() == 0 );
+	UT_VERIFY( s.capacity() == String().capacity() );
 }
 
 UT_FUNC(StringReplace, "Test string replace1")
@@ -310,6 +310,98 @@ UT_FUNC(StringComparison, "Test std::string comparison")
 }
 #endif
 
+UT_FUNC(StringShort, "Test short and long string transitions")
+{
+	String s = "abc";
+	UT_VERIFY( s.length() == 3 );
+
+	/* from inline to allocated buffer and back */
+	s += "defghijklmnopqrstuvwxyz";
+	UT_VERIFY( s == "abcdefghijklmnopqrstuvwxyz" );
+	UT_VERIFY( s.length() == 26 );
+
+	s = "xyz";
+	UT_VERIFY( s == "xyz" );
+	UT_VERIFY( s.length() == 3 );
+
+	/* append to itself */
+	s = "0123456789";
+	s.append(s);
+	UT_VERIFY( s == "01234567890123456789" );
+	s.append(s.c_str() + 10, 5);
+	UT_VERIFY( s == "0123456789012345678901234" );
+
+	/* assign from own buffer */
+	s.assign(s.c_str() + 20, 5);
+	UT_VERIFY( s == "01234" );
+
+	String s1 = "short", s2 = "this one is long enough to be allocated";
+	s1.swap(s2);
+	UT_VERIFY( s1 == "this one is long enough to be allocated" );
+	UT_VERIFY( s2 == "short" );
+	s2.swap(s1);
+	UT_VERIFY( s1 == "short" );
+	UT_VERIFY( s2 == "this one is long enough to be allocated" );
+
+	String s3(s1), s4(s2);
+	UT_VERIFY( s3 == s1 );
+	UT_VERIFY( s4 == s2 );
+
+	s3 = s4;
+	UT_VERIFY( s3 == "this one is long enough to be allocated" );
+	s4 = s1;
+	UT_VERIFY( s4 == "short" );
+}
+
+UT_FUNC(StringShared, "Test string copy-on-write")
+{
+	String s1 = "this string is long enough to be allocated";
+	String s2(s1), s3;
+
+	s3 = s2;
+	UT_VERIFY( s1.c_str() == s2.c_str() );
+	UT_VERIFY( s2.c_str() == s3.c_str() );
+
+	s2 += " and changed";
+	UT_VERIFY( s1.c_str() != s2.c_str() );
+	UT_VERIFY( s1 == "this string is long enough to be allocated" );
+	UT_VERIFY( s2 == "this string is long enough to be allocated and changed" );
+	UT_VERIFY( s3 == s1 );
+
+	s3.replace(' ', '_');
+	UT_VERIFY( s3 == "this_string_is_long_enough_to_be_allocated" );
+	UT_VERIFY( s1 == "this string is long enough to be allocated" );
+
+	s3 = s1;
+	s3.trim_left();
+	s3.append(3, '!');
+	UT_VERIFY( s3 == "this string is long enough to be allocated!!!" );
+	UT_VERIFY( s1 == "this string is long enough to be allocated" );
+
+	/* assigning short content must not touch shared buffer */
+	s3 = s1;
+	s3.assign("short");
+	UT_VERIFY( s3 == "short" );
+	UT_VERIFY( s1 == "this string is long enough to be allocated" );
+
+	/* append shared string to itself */
+	s3 = s1;
+	s3.append(s1.c_str(), 4);
+	UT_VERIFY( s3 == "this string is long enough to be allocatedthis" );
+
+	/* content changed via reference must not leak to copies made after */
+	s3 = s1;
+	char& ch = s3[0];
+	String s4 = s3;
+	ch = 'T';
+	UT_VERIFY( s3 == "This string is long enough to be allocated" );
+	UT_VERIFY( s4 == "this string is long enough to be allocated" );
+	UT_VERIFY( s1 == "this string is long enough to be allocated" );
+
+	s1.clear();
+	UT_VERIFY( s4 == "this string is long enough to be allocated" );
+}
+
 UT_FUNC(StringEmptyAppend, "Test string empty append")
 {
 	String s;
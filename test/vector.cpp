@@ -0,0 +1,148 @@
+#include <edelib/Vector.h>
+#include <edelib/String.h>
+#include "UnitTest.h"
+#include <stdlib.h>
+
+EDELIB_NS_USE
+
+UT_FUNC(VectorBasicTest, "Test basic vector functions")
+{
+	vector<int> v;
+
+	UT_VERIFY( v.begin() == v.end() );
+	UT_VERIFY( v.size() == 0 );
+	UT_VERIFY( v.empty() == true );
+
+	for(int i = 0; i < 100; i++)
+		v.push_back(i);
+
+	UT_VERIFY( v.size() == 100 );
+	UT_VERIFY( v.capacity() >= 100 );
+	UT_VERIFY( v.front() == 0 );
+	UT_VERIFY( v.back() == 99 );
+	UT_VERIFY( v[50] == 50 );
+
+	int n = 0;
+	for(vector<int>::iterator it = v.begin(); it != v.end(); ++it, n++)
+		UT_VERIFY( *it == n );
+
+	v.pop_back();
+	UT_VERIFY( v.size() == 99 );
+	UT_VERIFY( v.back() == 98 );
+
+	unsigned int c = v.capacity();
+	v.clear();
+	UT_VERIFY( v.size() == 0 );
+	UT_VERIFY( v.capacity() == c );
+	UT_VERIFY( v.begin() == v.end() );
+}
+
+UT_FUNC(VectorTestReserve, "Test vector reserve")
+{
+	vector<String> v;
+	v.reserve(10);
+	UT_VERIFY( v.capacity() == 10 );
+
+	v.push_back("first");
+	v.push_back("second element, long enough not to be stored inline");
+
+	vector<String>::iterator it = v.begin();
+	for(int i = 0; i < 8; i++)
+		v.push_back("item");
+
+	/* no reallocation happened */
+	UT_VERIFY( it == v.begin() );
+	UT_VERIFY( v.capacity() == 10 );
+
+	v.reserve(5);
+	UT_VERIFY( v.capacity() == 10 );
+
+	v.push_back(v[1]);
+	UT_VERIFY( v.size() == 11 );
+	UT_VERIFY( v.back() == "second element, long enough not to be stored inline" );
+	UT_VERIFY( v[0] == "first" );
+}
+
+UT_FUNC(VectorTestInsertErase, "Test vector insert/erase")
+{
+	vector<String> v;
+	vector<String>::iterator it;
+
+	v.push_back("a");
+	v.push_back("c");
+
+	it = v.insert(v.begin() + 1, "b");
+	UT_VERIFY( *it == "b" );
+	it = v.insert(v.end(), "d");
+	UT_VERIFY( *it == "d" );
+	it = v.insert(v.begin(), "0");
+	UT_VERIFY( *it == "0" );
+
+	UT_VERIFY( v.size() == 5 );
+	UT_VERIFY( v[0] == "0" );
+	UT_VERIFY( v[1] == "a" );
+	UT_VERIFY( v[2] == "b" );
+	UT_VERIFY( v[3] == "c" );
+	UT_VERIFY( v[4] == "d" );
+
+	it = v.erase(v.begin());
+	UT_VERIFY( *it == "a" );
+	it = v.erase(v.begin() + 1);
+	UT_VERIFY( *it == "c" );
+	it = v.erase(v.end() - 1);
+	UT_VERIFY( it == v.end() );
+
+	UT_VERIFY( v.size() == 2 );
+	UT_VERIFY( v[0] == "a" );
+	UT_VERIFY( v[1] == "c" );
+}
+
+static bool reverse_cmp(const int& a, const int& b) {
+	return b < a;
+}
+
+UT_FUNC(VectorTestSort, "Test vector sort and binary search")
+{
+	vector<int> v;
+	int array[] = {10, 3, 43, 34, 455, 455, 0, 0, 0, 1, 1, 1, 23, 120, 5, 234, 34, 78, 10, 12, 55, 123};
+	unsigned int i;
+
+	v.sort();
+	UT_VERIFY( v.binary_search(3) == false );
+
+	for(i = 0; i < sizeof(array)/sizeof(int); i++)
+		v.push_back(array[i]);
+
+	v.sort();
+	UT_VERIFY( v.size() == sizeof(array)/sizeof(int) );
+
+	for(i = 1; i < v.size(); i++)
+		UT_VERIFY( v[i - 1] <= v[i] );
+
+	for(i = 0; i < sizeof(array)/sizeof(int); i++)
+		UT_VERIFY( v.binary_search(array[i]) == true );
+
+	UT_VERIFY( v.binary_search(2) == false );
+	UT_VERIFY( v.binary_search(1000) == false );
+	UT_VERIFY( v.binary_search(-1) == false );
+
+	UT_VERIFY( *v.lower_bound(0) == 0 );
+	UT_VERIFY( v.lower_bound(0) == v.begin() );
+	UT_VERIFY( *v.lower_bound(2) == 3 );
+	UT_VERIFY( v.lower_bound(1000) == v.end() );
+
+	v.sort(reverse_cmp);
+	for(i = 1; i < v.size(); i++)
+		UT_VERIFY( v[i - 1] >= v[i] );
+
+	UT_VERIFY( v.binary_search(455, reverse_cmp) == true );
+	UT_VERIFY( v.binary_search(2, reverse_cmp) == false );
+
+	v.clear();
+	for(i = 0; i < 1000; i++)
+		v.push_back(rand() % 100);
+
+	v.sort();
+	for(i = 1; i < v.size(); i++)
+		UT_VERIFY( v[i - 1] <= v[i] );
+}
@@ -31,3 +31,138 @@ UT_FUNC(XmlTest, "Test XML")
 		}
 	}
 }
+
+UT_FUNC(XmlTestDoctype, "Test XML DOCTYPE with internal subset")
+{
+	const char* src =
+		"<?xml version=\"1.0\"?>\n"
+		"<!DOCTYPE mime-info [\n"
+		"  <!ELEMENT mime-info (mime-type)+>\n"
+		"  <!ATTLIST mime-type type CDATA #REQUIRED>\n"
+		"]>\n"
+		"<mime-info><mime-type type=\"text/plain\"><comment>plain text</comment></mime-type></mime-info>\n";
+
+	TiXmlDocument doc;
+	doc.Parse(src);
+	UT_VERIFY( !doc.Error() );
+
+	TiXmlElement* el = doc.FirstChildElement("mime-info");
+	UT_VERIFY( el != NULL );
+	if(!el) return;
+
+	el = el->FirstChildElement("mime-type");
+	UT_VERIFY( el != NULL );
+	if(!el) return;
+
+	UT_VERIFY( STR_EQUAL(el->Attribute("type"), "text/plain") );
+	UT_VERIFY( STR_EQUAL(el->FirstChildElement("comment")->GetText(), "plain text") );
+}
+
+class SaxRecorder : public TiXmlSaxHandler {
+public:
+	String events;
+	int    elements;
+
+	SaxRecorder() : elements(0) { }
+
+	bool StartElement(const char* name, const char** attrs) {
+		elements++;
+		events += "<";
+		events += name;
+		for(; *attrs; attrs += 2) {
+			events += " ";
+			events += attrs[0];
+			events += "=";
+			events += attrs[1];
+		}
+		events += ">";
+		return true;
+	}
+
+	bool EndElement(const char* name) {
+		events += "</";
+		events += name;
+		events += ">";
+		return true;
+	}
+
+	bool Text(const char* text, bool cdata) {
+		events += cdata ? "[" : "";
+		events += text;
+		events += cdata ? "]" : "";
+		return true;
+	}
+};
+
+UT_FUNC(XmlTestSax, "Test XML streaming parser")
+{
+	SaxRecorder r;
+	TiXmlSaxParser parser(&r);
+
+	UT_VERIFY( parser.ParseFile("test.xml") == true );
+	UT_VERIFY( r.events == "<start><node1 param=value1></node1><node2 param=value2></node2>"
+						   "<sub><s1 p1=2 p2=3></s1><s2 p1=2 p2=3></s2></sub>"
+						   "<text>this is some text</text></start>" );
+
+	r.events.clear();
+	UT_VERIFY( parser.Parse("<a x='1 &amp; 2'><!-- c --><b><![CDATA[<raw>]]></b>x &lt; y</a>") == true );
+	UT_VERIFY( r.events == "<a x=1 & 2><b>[<raw>]</b>x < y</a>" );
+
+	UT_VERIFY( parser.Parse("<a>\n<b>\n</a>") == false );
+	UT_VERIFY( parser.ErrorId() == TiXmlBase::TIXML_ERROR_READING_END_TAG );
+	UT_VERIFY( parser.ErrorRow() == 3 );
+
+	UT_VERIFY( parser.Parse("  ") == false );
+	UT_VERIFY( parser.ErrorId() == TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY );
+
+	UT_VERIFY( parser.ParseFile("does-not-exists.xml") == false );
+	UT_VERIFY( parser.ErrorId() == TiXmlBase::TIXML_ERROR_OPENING_FILE );
+
+	/* larger than internal buffer, so tokens are split between reads */
+	FILE* f = tmpfile();
+	UT_VERIFY( f != NULL );
+	if(!f) return;
+
+	fputs("<?xml version=\"1.0\"?>\r\n<root>\r\n", f);
+	for(int i = 0; i < 5000; i++)
+		fprintf(f, "<item id=\"%i\"><!-- comment %i --><name>item %i</name></item>\r\n", i, i, i);
+	fputs("</root>\r\n", f);
+	rewind(f);
+
+	r.events.clear();
+	r.elements = 0;
+	UT_VERIFY( parser.ParseFile(f) == true );
+	UT_VERIFY( r.elements == 10001 );
+	fclose(f);
+}
+
+UT_FUNC(XmlTestArena, "Test XML arena allocation")
+{
+	TiXmlDocument doc;
+	doc.SetArenaAllocation(true);
+	UT_VERIFY( doc.ArenaAllocation() == true );
+
+	/* load twice, so arena is reused */
+	for(int i = 0; i < 2; i++) {
+		UT_VERIFY( doc.LoadFile("test.xml") == true );
+
+		TiXmlElement* el = doc.FirstChildElement("start");
+		UT_VERIFY( el != NULL );
+		if(!el) return;
+
+		UT_VERIFY( STR_EQUAL(el->FirstChildElement("node1")->Attribute("param"), "value1") );
+		UT_VERIFY( STR_EQUAL(el->FirstChildElement("text")->GetText(), "this is some text") );
+
+		/* arena and heap nodes can be mixed and removed */
+		UT_VERIFY( el->RemoveChild(el->FirstChildElement("sub")) == true );
+		UT_VERIFY( el->FirstChildElement("sub") == NULL );
+
+		el->SetAttribute("added", "yes");
+		el->LinkEndChild(new TiXmlElement("heap"));
+		UT_VERIFY( STR_EQUAL(el->Attribute("added"), "yes") );
+		UT_VERIFY( el->FirstChildElement("heap") != NULL );
+	}
+
+	TiXmlDocument copy(doc);
+	UT_VERIFY( copy.FirstChildElement("start")->FirstChildElement("heap") != NULL );
+}